@@ -1,11 +1,16 @@
 #pragma once
+#include "RhythmGrid.h"
+#include "Shard.h"
+
 #include <args.hxx>
 
 class Arguments {
     public:
         enum XmlSourceType {
             FILE,   // a music xml file on the local filesystem
-            URL,    // a music xml file obtainable via a url
+            URL,    // a music xml file obtainable via a url, plain or compressed (.mxl)
+            MXL,    // a compressed music xml file (.mxl) on the local filesystem
+            MIDI,   // a standard MIDI file (.mid) on the local filesystem
             TXT,    // a text file containing a list of music xml file names or urls
             UNKNOWN
         };
@@ -13,6 +18,8 @@ class Arguments {
     private:
         std::string inputSource_; // the string passed by the positional argument inputSourceParm_
         std::string outputFile_; // the string passed by the optional argument outputFileParm_
+        Shard shard_; // parsed from the optional argument shardParm_
+        RhythmGrid grid_; // parsed from the optional argument gridParm_
 
         args::ArgumentParser parser_{"This program extracts parts from a music xml file", ""};
         args::HelpFlag help_{parser_, "help", "Display this help menu", {'h', "help"}};
@@ -33,7 +40,19 @@ class Arguments {
         args::Flag oneTokenPerBeat_{parser_, "One token per beat", "Print one token per beat", {'c', "oneTokenPerBeat"}};
         args::Flag startingTokensOnly_{parser_, "Starting tokens only", "Print only the starting token of each beat", {'C', "startingTokensOnly"}};
         args::Flag noHeader_{parser_, "No Header", "Don't generate header", {"noHeader"}};
+        args::Flag intervals_{parser_, "Intervals", "Print notes as intervals from the previous note, and chords as intervals from the bass", {"intervals"}};
+        args::Flag voices_{parser_, "Voices", "Print each note or chord as one token per voice followed by a duration token (ignores -c)", {"voices"}};
+        args::Flag index_{parser_, "Index", "Write a byte-offset index alongside the output file", {"index"}};
+        args::Flag parallelParts_{parser_, "Parallel parts", "Encode the parts of each chorale in parallel", {"parallelParts"}};
         args::ValueFlag<std::string> outputFileParm_{parser_, "output", "Output file path", {'f', "file"}};
+        args::ValueFlag<std::string> shardParm_{parser_, "i/N", "Process only shard i of N (origin 0)", {"shard"}};
+        args::ValueFlag<std::string> gridParm_{parser_, "auto|N", 
+            "Sub-beats per beat to encode on, or 'auto' for the smallest exact grid of each chorale", {"grid"}};
+        args::ValueFlag<std::string> mergesFileParm_{parser_, "merges", "Apply the merges in this file (from trainBpe) to the tokens written", {"merges"}};
+        args::ValueFlag<std::string> pianoRollFileParm_{parser_, "pianoRoll", "Piano roll output file path", {"pianoRoll"}};
+        args::ValueFlag<std::string> positionsFileParm_{parser_, "positions", "Write the position of each token written to this file", {"positions"}};
+        args::ValueFlag<std::string> harmonyFileParm_{parser_, "harmony", "Write the chord symbol of each chord combined to this file", {"harmony"}};
+        args::ValueFlag<std::string> snapshotFileParm_{parser_, "snapshot", "Write a binary snapshot of the parts encoded to this file, for inputEncodings", {"snapshot"}};
 
         // Store references to flags in vector
         std::vector<std::reference_wrapper<args::Flag>> flags_ { 
@@ -53,6 +72,21 @@ class Arguments {
         }
 
     public:
+        // the flags choosing the parts to encode, for tools with a parser of their own that read either musicXml or a
+        //  file of encodings
+        struct PartFlags {
+            args::Flag soprano;
+            args::Flag soprano1;
+            args::Flag soprano2;
+            args::Flag alto;
+            args::Flag tenor;
+            args::Flag bass;
+
+            explicit PartFlags( args::ArgumentParser& parser );
+            // the names of the parts flagged, or the four standard voices if none are
+            std::vector<std::string> get_parts_to_parse() const;
+        };
+
         Arguments() {}
         bool parse_command_line(int argc, char** argv);
 
@@ -67,6 +101,12 @@ class Arguments {
             else  if (xmlSource.find(".xml") != std::string::npos) {
                 return Arguments::FILE;
             }
+            else if (xmlSource.find(".mxl") != std::string::npos) {
+                return Arguments::MXL;
+            }
+            else if (xmlSource.find(".mid") != std::string::npos) {
+                return Arguments::MIDI;
+            }
             else {
                 return Arguments::UNKNOWN;
             }
@@ -79,13 +119,33 @@ class Arguments {
         bool has_output_file() const { return outputFileParm_.Matched(); }
         std::string get_output_file() const { return outputFile_; };
 
+        /// True if a piano roll file has been specified
+        bool has_piano_roll_file() const { return pianoRollFileParm_.Matched(); }
+        std::string get_piano_roll_file() const { return trim_leading_whitespace( args::get( pianoRollFileParm_ ) ); }
+
+        /// True if a token positions file has been specified
+        bool has_positions_file() const { return positionsFileParm_.Matched(); }
+        std::string get_positions_file() const { return trim_leading_whitespace( args::get( positionsFileParm_ ) ); }
+
+        /// True if a chord symbol file has been specified
+        bool has_harmony_file() const { return harmonyFileParm_.Matched(); }
+        std::string get_harmony_file() const { return trim_leading_whitespace( args::get( harmonyFileParm_ ) ); }
+
+        /// True if a part snapshot file has been specified
+        bool has_snapshot_file() const { return snapshotFileParm_.Matched(); }
+        std::string get_snapshot_file() const { return trim_leading_whitespace( args::get( snapshotFileParm_ ) ); }
+
+        /// True if a merges file has been specified
+        bool has_merges_file() const { return mergesFileParm_.Matched(); }
+        std::string get_merges_file() const { return trim_leading_whitespace( args::get( mergesFileParm_ ) ); }
+
         bool verbose() const { return verbose_.Get(); }
 
         // Don't print <EOM> markers
         bool noEOM() const { return noEOM_.Get(); }
 
         // Consolidate all tokens within a beat
-        bool consolidateBeat() const { return oneTokenPerBeat_.Get() && !startingTokensOnly_.Get(); }
+        bool consolidateBeat() const { return oneTokenPerBeat_.Get() && !startingTokensOnly_.Get() && !voices_.Get(); }
 
         // Print only the starting token of each beat
         bool startingTokensOnly() const { return startingTokensOnly_.Get(); }
@@ -95,4 +155,23 @@ class Arguments {
 
         // True if the header should not be printed
         bool noHeader() const { return noHeader_.Get(); }
+
+        // Print notes and chords as intervals rather than pitches
+        bool intervals() const { return intervals_.Get(); }
+
+        // Print each pitch of a note or chord as a token of its own, and its duration as another
+        bool voices() const { return voices_.Get(); }
+
+        // The shard of the input sources to process (all of them if --shard was not given)
+        const Shard& get_shard() const { return shard_; }
+
+        // True if a sidecar index should be written alongside the output file
+        bool writeIndex() const { return index_.Get(); }
+
+        // True if --grid was given, to choose the sub-beats per beat of each chorale
+        bool has_grid() const { return gridParm_.Matched(); }
+        const RhythmGrid& get_grid() const { return grid_; }
+
+        // True if the parts of each chorale should be encoded concurrently
+        bool parallelParts() const { return parallelParts_.Get(); }
 };
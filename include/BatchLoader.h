@@ -0,0 +1,62 @@
+#pragma once
+#include "Part.h"
+#include "ThreadPool.h"
+#include "Vocabulary.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// turns a corpus of encodings into fixed-length batches of token IDs for training
+//  every line of the corpus (a part, or a combined part) is a sample; each epoch visits the samples in a new
+//   shuffled order, and each row of a batch may be transposed to a random key and cropped at a random barline
+//  a batch depends only on the seed, the epoch and its number, so batches can be built concurrently and in any order
+class BatchLoader {
+    public:
+        struct Options {
+            size_t batchSize{32};       // rows per batch
+            size_t sequenceLength{512}; // token IDs per row, padded with Vocabulary::PAD_ID
+            int transpose{0};           // transpose each row by up to this many sharps or flats
+            bool crop{false};           // start each row at a random barline instead of at the start
+            uint64_t seed{0};
+        };
+
+    private:
+        Options options_;
+        std::vector<std::unique_ptr<Part>> samples_;
+        Vocabulary vocabulary_;
+
+    public:
+        explicit BatchLoader( const Options& options ) : options_{options} {}
+
+        // read the samples from a file of encodings (gzip-compressed if its name ends in .gz)
+        // prints an error to cerr and returns false if it cannot be read
+        bool load( const std::string& path );
+
+        // build the vocabulary from every token of every sample, in every key transposition can reach
+        void build_vocabulary( ThreadPool& pool );
+        // or read it from a file
+        bool load_vocabulary( const std::string& path ) { return vocabulary_.load( path ); }
+        const Vocabulary& get_vocabulary() const { return vocabulary_; }
+
+        const Options& get_options() const { return options_; }
+        size_t sample_count() const { return samples_.size(); }
+        // full batches per epoch (a final partial batch is dropped, unless it is the only one)
+        size_t batches_per_epoch() const;
+        size_t batch_ids() const { return options_.batchSize * options_.sequenceLength; }
+
+        // the order the samples are visited in during an epoch
+        std::vector<size_t> epoch_order( uint64_t epoch ) const;
+
+        // fill ids (batch_ids() of them, row by row) with the given batch of an epoch, whose order is given
+        //  safe to call concurrently
+        void make_batch( const std::vector<size_t>& order, uint64_t epoch, size_t batch, int32_t* ids ) const;
+
+    private:
+        void make_row( const Part& sample, std::mt19937_64& random, int32_t* ids ) const;
+
+        // the tokens of a part, as printed without a header
+        static std::vector<std::string> tokenize( const Part& part );
+};
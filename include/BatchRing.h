@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// a ring of fixed-size batches of token IDs in POSIX shared memory, filled by one producer process and read in
+//  place by one consumer process (e.g. a trainer mapping /dev/shm/<name> with numpy)
+//
+//  layout (native byte order):
+//      0   uint32 magic ("CHB1")       4   uint32 version
+//      8   uint32 slots                12  uint32 batch size (rows)
+//      16  uint32 sequence length      20  uint32 vocabulary size
+//      24  uint64 bytes per slot       32  uint64 offset of slot 0
+//      64  uint64 batches produced     128 uint64 batches consumed
+//      192 uint32 finished (1 once the producer has published its last batch)
+//      then the slots: batch n is in slot n % slots, as rows of int32 token IDs
+//  the producer publishes a batch by raising the produced count, and the consumer frees its slot by raising the
+//   consumed count; each count is written by one side only
+class BatchRing {
+    public:
+        static constexpr uint32_t MAGIC = 0x31424843;  // "CHB1"
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t slots;
+            uint32_t batchSize;
+            uint32_t sequenceLength;
+            uint32_t vocabularySize;
+            uint64_t slotBytes;
+            uint64_t dataOffset;
+            alignas(64) std::atomic<uint64_t> produced;
+            alignas(64) std::atomic<uint64_t> consumed;
+            alignas(64) std::atomic<uint32_t> finished;
+        };
+        static constexpr size_t DATA_OFFSET = 256;
+
+    private:
+        std::string name_;
+        Header* header_{nullptr};
+        size_t size_{0};
+        bool owner_{false};     // the producer removes the shared memory when it closes
+
+    public:
+        BatchRing() = default;
+        ~BatchRing() { close(); }
+        BatchRing( const BatchRing& ) = delete;
+        BatchRing& operator=( const BatchRing& ) = delete;
+
+        // producer: create the shared memory, replacing any left by an earlier run
+        // prints an error to cerr and returns false if it cannot be created
+        bool create( const std::string& name, uint32_t slots, uint32_t batchSize, uint32_t sequenceLength,
+            uint32_t vocabularySize );
+        // consumer: map shared memory created by a producer
+        // prints an error to cerr and returns false if it does not exist or is not a batch ring
+        bool attach( const std::string& name );
+        void close();
+
+        const Header& get_header() const { return *header_; }
+
+        // --- producer ---
+
+        // wait until batch n has a free slot, and return the slot to fill
+        int32_t* wait_for_slot( uint64_t n );
+        // publish every batch before n
+        void publish( uint64_t n ) { header_->produced.store( n, std::memory_order_release ); }
+        // publish no more batches, and wait until the consumer has read every batch
+        void finish();
+
+        // --- consumer ---
+
+        // wait for the next batch and return its slot, or nullptr once the producer has finished and every batch
+        //  has been read; the slot stays valid until release()
+        const int32_t* next_batch();
+        // free the slot of the batch returned by next_batch()
+        void release() { header_->consumed.fetch_add( 1, std::memory_order_release ); }
+
+    private:
+        int32_t* slot( uint64_t n ) const {
+            return reinterpret_cast<int32_t*>( reinterpret_cast<char*>( header_ ) + header_->dataOffset
+                + (n % header_->slots) * header_->slotBytes );
+        }
+        // wait briefly between polls of the other side's count
+        static void pause();
+};
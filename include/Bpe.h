@@ -0,0 +1,129 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// byte-pair-encoding style merges over the tokens of an encoding
+//  the base symbols are the note and chord tokens as printed; markers ([EOM], [EOP], ...) and the '.' written for
+//   <SOC> and <EOC> are never merged, so merges stay within the run of tokens between two markers (a "word")
+//  a merged token is written as its parts joined by JOIN, e.g. "C.4.4_D.4.4", and is split back on JOIN
+class BpeMerges {
+    public:
+        static inline const std::string JOIN = "_";
+        static inline const std::string FILE_HEADER = "#version: choraleGPT-bpe 1";
+
+    private:
+        std::vector<std::pair<std::string, std::string>> merges_;  // in the order they were learned
+        std::unordered_map<std::string, size_t> ranks_;             // "left right" -> position in merges_
+
+    public:
+        // read a merges file written by write()
+        // prints an error to cerr and returns false if it cannot be read
+        bool load( const std::string& path );
+        void write( std::ostream& os ) const;
+
+        void add( const std::string& left, const std::string& right );
+        size_t size() const { return merges_.size(); }
+        bool empty() const { return merges_.empty(); }
+
+        // apply the merges to a line of tokens, keeping its header; safe to call concurrently
+        std::string apply( const std::string& line ) const;
+
+        // true for a token that is never merged
+        static bool is_boundary( std::string_view token ) {
+            return token.starts_with( '[' ) || token == ".";
+        }
+
+    private:
+        // merge the symbols of one word, lowest rank first
+        void apply_to_word( std::vector<std::string>& symbols ) const;
+};
+
+// an indexed max-priority queue of symbol pairs by count, so that counts can be raised or lowered in place as
+//  merges change the words; ties go to the lower pair key, which keeps training deterministic
+class PairQueue {
+    private:
+        struct Entry {
+            int64_t count{0};
+            size_t position{0};     // in heap_
+        };
+        std::unordered_map<uint64_t, Entry> entries_;
+        std::vector<uint64_t> heap_;
+
+    public:
+        bool empty() const { return heap_.empty(); }
+        uint64_t top() const { return heap_.front(); }
+        int64_t count( uint64_t pair ) const;
+
+        // add delta to the count of a pair; a pair whose count drops to 0 or below is removed
+        void add( uint64_t pair, int64_t delta );
+
+    private:
+        bool before( uint64_t a, uint64_t b ) const;
+        void swap( size_t i, size_t j );
+        void sift_up( size_t i );
+        void sift_down( size_t i );
+        void remove( size_t i );
+};
+
+// learns merges from a corpus of encodings
+//  words are counted by count_words(), which may run concurrently on separate WordCounts, and added with
+//   add_words(); train() then counts the pairs on a thread pool and merges the most frequent pair repeatedly,
+//   updating only the words that contain it
+class BpeTrainer {
+    public:
+        struct Options {
+            size_t merges{1000};    // maximum number of merges to learn
+            size_t minCount{2};     // stop when the most frequent pair occurs less often than this
+        };
+
+        // word (tokens separated by spaces) -> number of occurrences
+        using WordCounts = std::unordered_map<std::string, size_t>;
+
+    private:
+        struct Word {
+            std::vector<uint32_t> symbols;
+            size_t count{0};
+        };
+
+        Options options_;
+        std::vector<std::string> symbols_;
+        std::unordered_map<std::string, uint32_t> symbolIds_;
+        std::vector<Word> words_;
+
+        PairQueue queue_;
+        std::unordered_map<uint64_t, std::vector<size_t>> pairWords_;   // pair -> words it may occur in
+
+        size_t tokensBefore_{0};
+        size_t tokensAfter_{0};
+
+    public:
+        explicit BpeTrainer( const Options& options ) : options_{options} {}
+
+        // split a line of tokens (with or without a header) into words and count them
+        static void count_words( std::string_view line, WordCounts& counts );
+        // add counted words to the training set
+        void add_words( const WordCounts& counts );
+
+        // learn the merges
+        BpeMerges train( ThreadPool& pool );
+
+        size_t get_word_count() const { return words_.size(); }
+        size_t get_tokens_before() const { return tokensBefore_; }
+        size_t get_tokens_after() const { return tokensAfter_; }
+
+    private:
+        uint32_t intern( const std::string& symbol );
+        void count_pairs( ThreadPool& pool );
+        void merge( uint64_t pair, uint32_t merged );
+
+        static uint64_t pair_key( uint32_t left, uint32_t right ) {
+            return (static_cast<uint64_t>( left ) << 32) | right;
+        }
+};
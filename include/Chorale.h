@@ -1,5 +1,8 @@
 #pragma once
 #include "CombinedPart.h"
+#include "MidiFile.h"
+#include "RhythmGrid.h"
+#include "ThreadPool.h"
 #include "XmlUtils.h"
 
 #include <map>
@@ -12,7 +15,7 @@ class Chorale {
         //  we append a modifier (e.g. 'a', 'b', etc.) to this chorale's BWV
         static unsigned int lastBWV_;
         static char lastModifier_;
-         // if sub_beats in the musicXml is less than this, we will multiply all durations to increase it to this value
+         // unless a RhythmGrid is given, all durations are rescaled to this many sub-beats per beat
         static inline const unsigned int MIN_SUBBEATS = 8;  
         // nullptr to return when a part is not found
         static std::unique_ptr<Part> nullPart_;
@@ -21,6 +24,9 @@ class Chorale {
         std::string xmlSource_;
         tinyxml2::XMLDocument doc_;
         bool isXmlLoaded_ = false;
+        // or the MIDI input, if the source is a MIDI file (isXmlLoaded_ then means it was read)
+        MidiFile midi_;
+        bool isMidi_ = false;
 
         // metadata
         std::string bwv_;       // BWV number
@@ -40,6 +46,15 @@ class Chorale {
         std::vector<std::string> partIdList_;
 
     public:
+        // libcurl's global state, which must be set up before urls are loaded on more than one thread: create one
+        //  in main before the pool is started, so it is released after the pool's threads have finished
+        struct CurlGlobal {
+            CurlGlobal();
+            ~CurlGlobal();
+            CurlGlobal( const CurlGlobal& ) = delete;
+            CurlGlobal& operator=( const CurlGlobal& ) = delete;
+        };
+
         // if bwv is empty, we will generate it from the xmlSource
         Chorale( const std::string& xmlSource, const std::string& bwv = "") : 
             xmlSource_{xmlSource}, 
@@ -59,7 +74,10 @@ class Chorale {
         // --- process functions ---
 
         // encode the xml in partXmls_ into the associated Part objects in parts_
-        bool encode_parts();  
+        //  if a pool is given, the parts are encoded concurrently on it
+        //  if a grid is given, it chooses the sub-beats per beat instead of MIN_SUBBEATS
+        //  if verbose, a rescaling to MIN_SUBBEATS that rounds a duration is reported
+        bool encode_parts( ThreadPool* pool = nullptr, RhythmGrid* grid = nullptr, bool verbose = false );  
 
         // combine individual parts into a new combined Part object with Chords instead of Notes 
         bool combine_parts( std::vector<std::string> partsToParse, bool verbose = false );   
@@ -68,13 +86,17 @@ class Chorale {
         std::string get_BWV() const { return bwv_; }
         std::string get_title() const { return title_; }
         tinyxml2::XMLElement* get_part_xml( const std::string& partName ) const;
+        const MidiFile::Voice* get_midi_voice( const std::string& partName ) const;
         std::unique_ptr<Part>& get_part( const std::string& partName );
         std::unique_ptr<CombinedPart>& get_combined_part() { return combinedPart_; }
  
     private:
         // --- helper function from load_xml() ---
         bool load_xml_from_file( const std::string& xmlSource ); 
+        bool load_xml_from_mxl_file( const std::string& xmlSource );
         bool load_xml_from_url( const std::string& xmlSource );
+        // inflate the score of an .mxl archive held in memory and parse it
+        bool load_xml_from_mxl( const std::string& archive );
 
         // --- helper functions for encode_parts() ---
 
@@ -82,6 +104,12 @@ class Chorale {
         bool load_part_ids();  
         // build partXmls_, mappting part names to their XML Elements
         bool load_part_xmls(); 
+        // parse and transpose a single part
+        static bool encode_part( Part& part, tinyxml2::XMLElement* partXml );
+        // parse and transpose the parts from the voices of a MIDI file
+        bool encode_midi_parts( RhythmGrid* grid, bool verbose );
+        // put the encoded parts on a common grid
+        bool normalize_meter( RhythmGrid* grid, bool verbose );
 
         // used by load_xml_from_url()
         static size_t curl_callback(void* contents, size_t size, size_t nmemb, void* userp);
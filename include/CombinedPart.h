@@ -4,29 +4,33 @@
 #include <array>
 #include <iostream>
 
-// contains a copy of a given part to allow us to pop tokens and combine them with other parts
-struct PartWrapper {
-    std::unique_ptr<Part> part;
-    std::unique_ptr<Encoding> currentToken;
-    bool needNewToken;
-
-    PartWrapper(Part& inputPart) : needNewToken(true) {
-        part = std::make_unique<Part>(inputPart);
-    }
-
-    std::string part_name() const {
-        return part->get_part_name();
-    }
-    bool get_next_token() {
-        currentToken = part->pop_encoding();
-        return currentToken != nullptr;
-    }
+// a single voice's encodings laid out on an absolute tick timeline, so voices can be merged by onset time
+struct VoiceTimeline {
+    // a note or marker of the voice
+    struct Event {
+        size_t onset;       // absolute tick at which the event starts
+        size_t end;         // absolute tick at which the event ends (same as onset for a marker)
+        int markerType;     // Marker::MarkerType, or NO_MARKER for a note
+        Note note;          // copy of the note (unused for a marker)
+    };
+    static constexpr int NO_MARKER = -1;
+
+    std::string partName;
+    std::vector<Event> events;
+
+    // build the timeline from a part, scaling durations by the given factor to reach a common grid
+    VoiceTimeline( const Part& part, size_t scale );
 };
 
 class CombinedPart : public Part {
     private:
-        // the parts that make up this combined part: Soprano, Alto, Tenor, Bass
-        std::vector<std::unique_ptr<PartWrapper>> parts_; 
+        // the voices that make up this combined part: Soprano, Alto, Tenor, Bass
+        std::vector<VoiceTimeline> voices_;
+
+        // merge state: the current event of each voice and whether it has already contributed to a chord
+        std::vector<size_t> cursors_;
+        std::vector<bool> sliced_;
+        size_t currentTick_{0};
 
     public:
         CombinedPart( const std::vector<std::unique_ptr<Part>>& parts );
@@ -36,22 +40,18 @@ class CombinedPart : public Part {
     private:
         std::ostream& show_current_tokens( std::ostream& os ) const;
 
-        // get the next token for each part if one is needed
+        // check that every voice has a current event and that they are compatible
         // possible errors:
-        //     a part has no more tokens
-        //     one part has a marker whereas another part has a rest or note
+        //     a voice has no more events
+        //     one voice has a marker whereas another voice has a rest or note
+        //     voices have different markers
         // a message is printed and the function returns false if an error occur
-        bool get_next_tokens();
-
-        // reduce the duration of a token by the given number of ticks
-        // returns true if we thereby exhaust the duration of this token and will need a new one next time
-        bool reduce_duration( Note& note, const unsigned int reduction );
+        bool check_current_events() const;
 
-        // add marker to the combined parts
-        // takes ownership of the token
+        // add marker to the combined parts and advance every voice past it
         // returns true if the marker was EOC
-        bool process_marker( std::unique_ptr<Encoding>& token,  bool verbose );
+        bool process_marker( bool verbose );
 
-        // build chord from the current tokens
+        // build chord from the current events, ending at the earliest end among the voices
         void add_chord( bool verbose );
-};
\ No newline at end of file
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include "Part.h"
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// one line of a token corpus, as recorded in the sidecar index
+struct IndexEntry {
+    size_t offset{0};       // byte offset of the line within the corpus
+    size_t length{0};       // length of the line in bytes, excluding the newline
+    size_t tokenCount{0};   // number of tokens on the line, excluding the header
+    std::string id;         // e.g. "BWV 10.1"
+    std::string partName;   // e.g. "Soprano" or "Combined"
+    std::string key;        // e.g. "C-Major"
+    size_t beatsPerMeasure{0};
+    size_t subBeatsPerBeat{0};
+};
+
+// writes a sidecar index (one tab-separated line per corpus line) alongside a token corpus
+class CorpusIndexWriter {
+    public:
+        static inline const std::string EXTENSION = ".idx";
+        static inline const std::string COLUMNS = "# offset\tlength\ttokens\tid\tpart\tkey\tbeats\tsub-beats";
+
+    private:
+        std::ofstream indexFile_;
+
+    public:
+        CorpusIndexWriter() = default;
+
+        // open the index file, writing the column header
+        bool open( const std::string& indexPath );
+        bool is_open() const { return indexFile_.is_open(); }
+        // prints an error to cerr and returns false if the index could not be written
+        bool close();
+
+        // record a line written to the corpus at the given offset
+        void add_entry( const IndexEntry& entry );
+        void add_entry( const Part& part, size_t offset, const std::string& line );
+
+        // the index path used for a given corpus path
+        static std::string index_path( const std::string& corpusPath ) { return corpusPath + EXTENSION; }
+
+        // number of tokens on a line, ignoring the header if there is one
+        static size_t count_tokens( std::string_view line );
+};
+
+// memory-maps a token corpus and uses its sidecar index to return any chorale in O(1)
+class CorpusReader {
+    private:
+        std::vector<IndexEntry> entries_;
+        std::vector<size_t> choraleStarts_; // index into entries_ of the first line of each chorale
+
+        const char* data_{nullptr};
+        size_t size_{0};
+
+    public:
+        CorpusReader() = default;
+        ~CorpusReader() { close(); }
+        CorpusReader( const CorpusReader& ) = delete;
+        CorpusReader& operator=( const CorpusReader& ) = delete;
+
+        // map the corpus and load its index (index_path( corpusPath ) if indexPath is empty)
+        bool open( const std::string& corpusPath, const std::string& indexPath = "" );
+        void close();
+
+        size_t chorale_count() const { return choraleStarts_.size(); }
+        size_t line_count() const { return entries_.size(); }
+
+        // entries for the lines (one per part) belonging to chorale k
+        std::vector<IndexEntry> get_entries( size_t chorale ) const;
+        // the lines (one per part) belonging to chorale k, pointing into the mapped corpus
+        std::vector<std::string_view> get_chorale( size_t chorale ) const;
+        // a single line of the corpus
+        std::string_view get_line( const IndexEntry& entry ) const {
+            return std::string_view{ data_ + entry.offset, entry.length };
+        }
+
+    private:
+        bool load_index( const std::string& indexPath );
+        bool parse_entry( const std::string& line, IndexEntry& entry ) const;
+};
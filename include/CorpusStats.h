@@ -0,0 +1,61 @@
+#pragma once
+#include "Part.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// histograms over a corpus of chorales: pitch ranges and durations per voice, chord types, and tokens per chorale
+//  counts are plain sums, so partial counts built on separate threads can be merged at the end
+class CorpusStats {
+    public:
+        using Histogram = std::map<int, uint64_t>;  // value -> number of occurrences
+
+        // width of the buckets of the tokens-per-chorale histogram
+        static constexpr int TOKEN_BUCKET = 50;
+
+        struct VoiceStats {
+            uint64_t notes{0};      // notes struck (ties from the previous note are not counted)
+            uint64_t rests{0};
+            Histogram pitches;      // MIDI pitch of each note struck
+            Histogram durations;    // duration in sub-beats of each note or rest token
+        };
+
+    private:
+        uint64_t chorales_{0};
+        uint64_t parts_{0};
+        std::map<std::string, VoiceStats> voices_;      // keyed by part name
+        uint64_t chords_{0};
+        Histogram chordDurations_;
+        std::map<std::string, uint64_t> chordTypes_;    // pitch classes above the bass, e.g. "0.4.7"
+        Histogram tokensPerChorale_;                    // keyed by the start of a TOKEN_BUCKET-wide bucket
+        uint64_t tokens_{0};
+        uint64_t minTokens_{UINT64_MAX};
+        uint64_t maxTokens_{0};
+
+    public:
+        CorpusStats() = default;
+
+        // count the parts of one chorale
+        //  separate parts are also merged into chords, so chord types are counted for either kind of input
+        void add_chorale( const std::vector<std::unique_ptr<Part>>& parts );
+
+        // add the counts of another partial result to this one
+        void merge( const CorpusStats& other );
+
+        uint64_t get_chorale_count() const { return chorales_; }
+
+        void write_json( std::ostream& os ) const;
+
+    private:
+        void add_note( VoiceStats& voice, const Note& note );
+        void add_chord( const Chord& chord );
+
+        // the pitch classes of a chord's sounding notes relative to its lowest note, or "" if all are rests
+        static std::string chord_type( const Chord& chord );
+
+        static void write_histogram( std::ostream& os, const Histogram& histogram );
+};
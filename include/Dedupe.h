@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// finds duplicate and near-duplicate chorales in a corpus of encodings
+//
+//  exact duplicates have the same token stream in every part (the streams are already transposed to C major or
+//   A minor, so a repeated harmonization in another key is still an exact duplicate)
+//  near duplicates are found by MinHash over n-grams of tokens within each part: chorales whose signatures agree
+//   in every row of at least one band are candidates (LSH), and candidates whose estimated Jaccard similarity
+//   reaches the threshold are clustered with union-find
+//  the first chorale of each cluster, in corpus order, is kept and the rest are dropped
+class Deduplicator {
+    public:
+        struct Options {
+            size_t ngram{4};        // tokens per shingle
+            size_t bands{16};       // LSH bands
+            size_t rows{4};         // signature rows per band; the signature has bands * rows hashes
+            double threshold{0.8};  // minimum estimated Jaccard similarity for a near duplicate
+        };
+
+        // what happened to a chorale
+        struct Decision {
+            bool keep{true};
+            size_t keptAs{0};       // index of the chorale kept in its place (itself if kept)
+            bool exact{false};      // dropped as an exact duplicate
+            double similarity{1.0}; // estimated similarity to the kept chorale
+        };
+
+    private:
+        Options options_;
+        std::vector<std::string> ids_;
+        std::vector<uint64_t> exactHashes_;     // one per chorale
+        std::vector<uint64_t> signatures_;      // bands * rows per chorale
+        std::vector<uint64_t> seeds_;           // one per signature row
+
+        std::vector<size_t> parents_;           // union-find forest; a root is the earliest chorale of its cluster
+        std::vector<Decision> decisions_;
+
+    public:
+        explicit Deduplicator( const Options& options );
+
+        size_t signature_size() const { return options_.bands * options_.rows; }
+        size_t size() const { return ids_.size(); }
+
+        // reserve room for a chorale and return its position; its fingerprint is filled in by fingerprint()
+        size_t add( const std::string& id );
+
+        // compute the fingerprint of chorale k from its lines (one per part, with or without headers)
+        //  fingerprints of different chorales may be computed concurrently
+        void fingerprint( size_t k, const std::vector<std::string_view>& lines );
+
+        // cluster the chorales and decide which to keep
+        void cluster();
+
+        const Decision& get_decision( size_t k ) const { return decisions_[k]; }
+        const std::string& get_id( size_t k ) const { return ids_[k]; }
+
+        // write one tab-separated line per chorale: id, keep/drop, id of the kept chorale, reason, similarity
+        void write_manifest( std::ostream& os ) const;
+
+    private:
+        size_t find( size_t k );
+        void unite( size_t a, size_t b );
+        double estimate_similarity( size_t a, size_t b ) const;
+
+        static uint64_t hash( std::string_view text, uint64_t seed );
+        static uint64_t mix( uint64_t value );
+};
@@ -118,8 +118,6 @@ class Note : public Encoding {
         int accidental_{0};
         bool tied_{false}; // tied from previous note
 
-        static inline bool tie_started_{false}; // the next note we save should be marked tied_=true
-
     public:
         Note() : Encoding{0, NOTE} {}    
         Note(char pitch, unsigned int octave, unsigned int duration, int accidental=0, bool tied=false) : 
@@ -134,9 +132,10 @@ class Note : public Encoding {
             Encoding{duration, NOTE, measureNumber, subBeatNumber} {}
 
         // Constructor to take xml
-        Note(tinyxml2::XMLElement* note, size_t measureNumber=0, size_t subBeatNumber=0) : 
+        //  tieStarted is the tie state of the part being parsed: true if the next note should be marked tied
+        Note(tinyxml2::XMLElement* note, bool& tieStarted, size_t measureNumber=0, size_t subBeatNumber=0) : 
                 Encoding{0, NOTE, measureNumber, subBeatNumber} { 
-            parse_xml( note ); 
+            parse_xml( note, tieStarted ); 
         }
 
         // Constructor to take encoding in format "pitch.octave.duration"
@@ -156,6 +155,10 @@ class Note : public Encoding {
         unsigned int get_octave() const { return octave_; }
         int get_accidental() const { return accidental_; }
         bool get_tied() const { return tied_; }
+        bool is_rest() const { return pitch_ == 'R'; }
+        int get_midi_pitch() const; // 0 for a rest
+        // the note for a MIDI note number, spelled for a key with the given number of sharps (plus) or flats (minus)
+        static Note from_midi_pitch( int midiPitch, int key, bool minor, unsigned int duration, bool tied = false );
 
         // setters
         void set_tied( bool tie ) { tied_ = tie; }
@@ -168,7 +171,11 @@ class Note : public Encoding {
         }  
         std::string pitch_to_string() const;
 
-        bool parse_xml( tinyxml2::XMLElement* note ); 
+        // write the same text as to_string() and pitch_to_string() directly to a stream
+        void write( std::ostream& os, bool ignoreDuration = false ) const;
+        void write_pitch( std::ostream& os ) const;
+
+        bool parse_xml( tinyxml2::XMLElement* note, bool& tieStarted ); 
         void transpose( const std::map<char, TranspositionRule>& rules );  
 
     private:
@@ -188,9 +195,36 @@ class Chord : public Encoding {
         Chord(const std::vector<Note>& notes, unsigned int duration) :
             Encoding{duration, CHORD},
             notes_{notes.begin(), notes.end()} {}
+        Chord(std::vector<Note>&& notes, unsigned int duration) :
+            Encoding{duration, CHORD},
+            notes_{std::move( notes )} {}
+
+        // Constructor to take encoding in format "pitch.octave.pitch.octave. ... .duration"
+        Chord(const std::string& encoding, size_t measureNumber=0, size_t subBeatNumber=0) : 
+                Encoding{0, CHORD, measureNumber, subBeatNumber} { 
+            try {
+                parse_encoding( encoding );
+            }
+            catch (std::exception& e) {
+                std::cerr << "Error parsing chord: " << encoding << std::endl;
+                isValid_ = false;
+            }       
+        }
+
+        const std::vector<Note>& get_notes() const { return notes_; }
+        // transpose every note of the chord
+        void transpose( const std::map<char, TranspositionRule>& rules );
 
         std::unique_ptr<Encoding> clone() const override {
             return std::make_unique<Chord>(*this);
         }
         std::string to_string(  bool ignoreDuration = false  ) const;
+
+        // write the same text as to_string() directly to a stream
+        void write( std::ostream& os, bool ignoreDuration = false ) const;
+
+    private:
+        // helper function for Chord( encoding ) constructor
+        //  expects encoding in format "pitch.octave.pitch.octave. ... .duration"
+        void parse_encoding( const std::string& encoding );
 };
@@ -0,0 +1,39 @@
+#pragma once
+#include "Part.h"
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// reads part encodings (one line per part, as written by inputXml) and groups consecutive lines
+//  with the same ID into chorales, so chorales may have any number of voices
+class EncodingReader {
+    private:
+        std::istream& is_;
+        std::unique_ptr<Part> nextPart_;   // first part of the next chorale, read ahead
+        size_t lineNumber_{0};
+
+    public:
+        // the lines of one chorale in a file of encodings
+        using ChoraleLines = std::vector<std::string>;
+
+        EncodingReader( std::istream& is ) : is_{is} {}
+
+        // true if the source is a file of encodings (its first line has a header) rather than musicXml or a list
+        //  of musicXml sources
+        static bool is_encodings_file( const std::string& source );
+        // read a file of encodings and group its lines into chorales by ID, parsing only their headers, so the
+        //  encodings can be parsed later on worker threads
+        static bool read_chorale_lines( const std::string& source, std::vector<ChoraleLines>& chorales );
+
+        // replace parts with the parts of the next chorale
+        // returns false when there are no more chorales
+        bool read_chorale( std::vector<std::unique_ptr<Part>>& parts );
+
+        size_t get_line_number() const { return lineNumber_; }
+
+    private:
+        // read the next non-empty line into a Part; returns nullptr at end of input
+        std::unique_ptr<Part> read_part();
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "Encoding.h"
+#include "Part.h"
+
+#include <ostream>
+
+// checks that the encoding of a part survives being printed and parsed back, and that its measures are consistent
+//  each method writes a description of the first problem found, located with Part::location_to_string(), to errors
+class EncodingVerifier {
+    public:
+        // print the part, parse the text back and compare the result with the part
+        //  both the part and the parsed copy must also pass check_measures()
+        static bool verify( const Part& part, std::ostream& errors );
+
+        // compare two parts field by field: header, then every encoding with its measure and tick
+        static bool compare( const Part& expected, const Part& actual, std::ostream& errors );
+
+        // check the bookkeeping push_encoding() and ticks_remaining() maintain:
+        //  the part starts with <SOC> and ends with <EOC>
+        //  ticks run on without gaps within a measure and restart at 1 with each <EOM>
+        //  no measure holds more than beats * sub-beats ticks, and an upbeat measure ends on the barline
+        //  every note and chord lasts at least one tick (a rescaling by set_sub_beats() may have lost it)
+        static bool check_measures( const Part& part, std::ostream& errors );
+
+    private:
+        static bool same_note( const Note& expected, const Note& actual );
+        static bool same_encoding( const Encoding& expected, const Encoding& actual );
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdio>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// a stream buffer that compresses what is written to it into a gzip file, one block at a time
+//  flushing the stream (e.g. with std::endl) hands the buffered text to zlib but does not end a deflate block,
+//  so line-by-line writers compress as well as block writers; the gzip trailer is written by close()
+class GzipOutputBuffer : public std::streambuf {
+    public:
+        static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    private:
+        FILE* file_{nullptr};
+        z_stream zs_{};
+        std::vector<char> in_;
+        std::vector<unsigned char> out_;
+        std::streamoff written_{0};    // uncompressed bytes handed to zlib so far
+        bool failed_{false};
+
+    public:
+        GzipOutputBuffer() = default;
+        GzipOutputBuffer( const GzipOutputBuffer& ) = delete;
+        GzipOutputBuffer& operator=( const GzipOutputBuffer& ) = delete;
+        ~GzipOutputBuffer() override { close(); }
+
+        // prints an error to cerr and returns false if the file cannot be opened
+        bool open( const std::string& path, int level = Z_DEFAULT_COMPRESSION );
+        // finish the gzip stream and close the file; returns false if anything failed to be written
+        bool close();
+        bool is_open() const { return file_ != nullptr; }
+
+    protected:
+        int_type overflow( int_type ch ) override;
+        int sync() override;
+        // only reports the position (in uncompressed bytes), so that tellp() works; seeking is not supported
+        pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which ) override;
+
+    private:
+        // compress the buffered text with the given zlib flush mode and write what zlib produces
+        bool deflate_buffer( int flush );
+};
+
+// a stream buffer that reads a gzip file (or a file of several concatenated gzip members, as written by cat-ing
+//  compressed shards), decompressing one block at a time
+//  corrupt data, or a file that ends within a member, is reported and throws from underflow(), which puts the
+//   stream reading it in the bad state, so it can be told from the end of the file
+class GzipInputBuffer : public std::streambuf {
+    public:
+        static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    private:
+        FILE* file_{nullptr};
+        z_stream zs_{};
+        std::vector<unsigned char> in_;
+        std::vector<char> out_;
+        bool endOfFile_{false};
+        bool inMember_{false};      // a gzip member has started and has not ended
+
+    public:
+        GzipInputBuffer() = default;
+        GzipInputBuffer( const GzipInputBuffer& ) = delete;
+        GzipInputBuffer& operator=( const GzipInputBuffer& ) = delete;
+        ~GzipInputBuffer() override { close(); }
+
+        // prints an error to cerr and returns false if the file cannot be opened
+        bool open( const std::string& path );
+        void close();
+        bool is_open() const { return file_ != nullptr; }
+
+    protected:
+        int_type underflow() override;
+
+    private:
+        // print an error and stop reading; throws std::ios_base::failure
+        [[noreturn]] void fail( const std::string& message );
+};
+
+// an output file stream that is gzip-compressed
+class GzipOfstream : public std::ostream {
+    private:
+        GzipOutputBuffer buffer_;
+
+    public:
+        GzipOfstream() : std::ostream{nullptr} { rdbuf( &buffer_ ); }
+        explicit GzipOfstream( const std::string& path ) : GzipOfstream() { open( path ); }
+
+        void open( const std::string& path );
+        void close();
+        bool is_open() const { return buffer_.is_open(); }
+};
+
+// an input file stream that is gzip-compressed
+class GzipIfstream : public std::istream {
+    private:
+        GzipInputBuffer buffer_;
+
+    public:
+        GzipIfstream() : std::istream{nullptr} { rdbuf( &buffer_ ); }
+        explicit GzipIfstream( const std::string& path ) : GzipIfstream() { open( path ); }
+
+        void open( const std::string& path );
+        void close() { buffer_.close(); }
+        bool is_open() const { return buffer_.is_open(); }
+};
+
+namespace GzipStream {
+    inline const std::string EXTENSION = ".gz";
+
+    // true if the path names a gzip file
+    inline bool is_compressed( const std::string& path ) { return path.ends_with( EXTENSION ); }
+
+    // open a file for writing or reading, compressed or decompressed on the fly if its name ends in ".gz"
+    //  check the stream (not the pointer) to see whether it was opened
+    std::unique_ptr<std::ostream> open_output( const std::string& path );
+    std::unique_ptr<std::istream> open_input( const std::string& path );
+    // close a stream from open_output, which for a gzip file writes the last block and the trailer
+    // prints an error to cerr and returns false if anything written to the file failed
+    bool close_output( std::ostream& os, const std::string& path );
+
+    // read a whole file, decompressing it if its name ends in ".gz"
+    // prints an error to cerr and returns false if it cannot be read
+    bool read_file( const std::string& path, std::string& contents );
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Encoding.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+class Part;
+
+// labels the chords of a combined part with a root, quality and inversion, e.g. "G7/B"
+//
+//  a chord is reduced to the set of pitch classes its voices sound (bit p for pitch class p, C = 0, rests ignored)
+//   and its bass (the lowest pitch sounding); the set is looked up in a table of all 4096 sets, built at compile
+//   time, that gives the root and quality of every set that spells a triad or seventh chord, or one with its
+//   perfect fifth omitted; the inversion follows from the bass
+//  the augmented triad and diminished seventh divide the octave equally, so the table cannot name their root: they
+//   are labeled in root position on the bass
+class Harmony {
+    public:
+        enum Quality : uint8_t {
+            NONE,               // not a triad or seventh chord (e.g. with a passing note), or fewer than two pitch classes
+            MAJOR,
+            MINOR,
+            DIMINISHED,
+            AUGMENTED,
+            DOMINANT_7,
+            MAJOR_7,
+            MINOR_7,
+            HALF_DIMINISHED_7,
+            DIMINISHED_7,
+            QUALITY_COUNT
+        };
+        // appended to the root in a chord symbol
+        static constexpr const char* QUALITY_SUFFIXES[QUALITY_COUNT] = {
+            "", "", "m", "dim", "aug", "7", "maj7", "m7", "m7b5", "dim7"
+        };
+        // the chord symbol of a chord with no label
+        static inline const std::string NONE_STR = "N";
+
+        struct Label {
+            uint8_t root{0};            // pitch class
+            Quality quality{NONE};
+            uint8_t inversion{0};       // 0 for the root in the bass, 1 the third, 2 the fifth, 3 the seventh
+        };
+
+        static constexpr size_t TABLE_SIZE = 4096;
+
+    private:
+        struct Entry {
+            uint8_t root{0};
+            Quality quality{NONE};
+        };
+        static const std::array<Entry, TABLE_SIZE> table_;
+
+    public:
+        // the pitch classes a chord sounds, and the pitch class of its bass (-1 if every voice rests)
+        static uint16_t pitch_classes( const Chord& chord, int& bass );
+        // label a set of pitch classes over a bass
+        static Label label( uint16_t pitchClasses, int bass );
+        static Label label( const Chord& chord );
+
+        // the chord symbol of a chord, with its root (and bass) spelled as a voice of the chord spells it, e.g.
+        //  "F#dim", "Bb/D" or "N"
+        static std::string to_string( const Chord& chord );
+        // one line for a part: its header, then the chord symbol of each chord and each marker as it is written,
+        //  so with the default print options the line has a symbol for each token of the part
+        static std::string to_string( const Part& part );
+
+    private:
+        static consteval std::array<Entry, TABLE_SIZE> make_table();
+        // a pitch class as a voice of the chord spells it (e.g. "F#" or "Bb")
+        static std::string spell( const Chord& chord, int pitchClass );
+};
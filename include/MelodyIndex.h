@@ -0,0 +1,153 @@
+#pragma once
+#include "Part.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// an inverted index from melodic n-grams to the places in a corpus where they occur, for finding passages of
+//  generated chorales copied from the training corpus
+//
+//  a melody is the sequence of notes struck in one voice (ties are merged into the note they continue); each note
+//   is a symbol holding its interval from the previous note in semitones and its duration in 96ths of a beat, so
+//   melodies match whatever their key or grid; a rest breaks the melody, and the note after it has no interval
+//  the index keeps every melody, so a shared n-gram can be extended to the longest span the melodies share
+//
+//  file layout (native byte order), each section 64-byte aligned:
+//      FileHeader
+//      PartEntry for each melody
+//      uint32 symbol for each note of every melody, melody after melody
+//      Location of each note
+//      uint64 key of each distinct n-gram, ascending
+//      uint32 start of each key's postings, plus one past the last
+//      uint32 postings: the note (index into the symbols) each n-gram starts at, by key, then in corpus order
+class MelodyIndex {
+    public:
+        static constexpr char MAGIC[4] = { 'C', 'M', 'I', 'X' };
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t ALIGNMENT = 64;
+        static constexpr uint32_t TICKS_PER_BEAT = 96;
+        static constexpr uint32_t NO_INTERVAL = 0;  // interval byte of the first note of a melody or after a rest
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t ngram;         // symbols (intervals) per n-gram, which spans one more note
+            uint32_t partCount;
+            uint64_t noteCount;
+            uint64_t keyCount;
+            uint64_t postingCount;
+            uint64_t partsOffset;
+            uint64_t symbolsOffset;
+            uint64_t locationsOffset;
+            uint64_t keysOffset;
+            uint64_t startsOffset;
+            uint64_t postingsOffset;
+            uint64_t reserved;
+        };
+
+        struct PartEntry {
+            uint64_t firstNote;     // index of the melody's first note
+            uint32_t notes;
+            uint16_t subBeats;      // sub-beats per beat of the encoding, for locations
+            uint16_t reserved;
+            char id[24];            // null-terminated, truncated if necessary
+            char part[24];
+        };
+
+        struct Location {
+            uint16_t measure;       // origin 1 (0 for an upbeat)
+            uint16_t tick;          // origin 1
+        };
+
+        // the notes of one voice of a part
+        struct Melody {
+            std::string id;
+            std::string partName;
+            size_t subBeats{1};
+            std::vector<uint32_t> symbols;
+            std::vector<Location> locations;
+        };
+
+        // the longest span of a query melody found in the index
+        struct Match {
+            size_t notes{0};        // 0 if no n-gram matched
+            size_t part{0};         // the melody of the index it was found in
+            size_t start{0};        // its first note, within that melody
+            size_t queryStart{0};   // its first note, within the query
+        };
+
+    private:
+        const char* data_{nullptr};
+        size_t size_{0};
+        const FileHeader* header_{nullptr};
+        const PartEntry* parts_{nullptr};
+        const uint32_t* symbols_{nullptr};
+        const Location* locations_{nullptr};
+        const uint64_t* keys_{nullptr};
+        const uint32_t* starts_{nullptr};
+        const uint32_t* postings_{nullptr};
+
+    public:
+        MelodyIndex() = default;
+        ~MelodyIndex() { close(); }
+        MelodyIndex( const MelodyIndex& ) = delete;
+        MelodyIndex& operator=( const MelodyIndex& ) = delete;
+
+        // map an index file; prints an error to cerr and returns false if it cannot be mapped or is not an index
+        bool open( const std::string& path );
+        void close();
+
+        size_t get_ngram() const { return header_->ngram; }
+        size_t part_count() const { return header_->partCount; }
+        size_t note_count() const { return header_->noteCount; }
+        size_t key_count() const { return header_->keyCount; }
+        const PartEntry& get_part( size_t part ) const { return parts_[part]; }
+        const Location& get_location( size_t part, size_t note ) const {
+            return locations_[parts_[part].firstNote + note];
+        }
+
+        // the longest span of the query found in the index (in a melody of another chorale if excludeSameId)
+        //  safe to call concurrently
+        Match longest_match( const Melody& query, bool excludeSameId ) const;
+
+        // the melodies of a part: one for a part of notes, one per voice for a part of chords
+        static void extract_melodies( const Part& part, std::vector<Melody>& melodies );
+        // read a file of encodings (gzip-compressed if its name ends in .gz) and extract its melodies, parsing
+        //  contiguous ranges of lines on the pool
+        // prints an error to cerr and returns false if it cannot be read
+        static bool read_melodies( const std::string& path, ThreadPool& pool, std::vector<Melody>& melodies );
+
+        // the key of the n-gram starting at symbols, or false if it spans the start of a melody or a rest
+        static bool gram_key( const uint32_t* symbols, size_t ngram, uint64_t& key );
+        static bool is_comparable( uint32_t symbol ) { return (symbol >> 24) != NO_INTERVAL; }
+
+    private:
+        // the melody holding a note of the index
+        size_t part_of( uint64_t note ) const;
+};
+
+// writes melodies to an index file
+class MelodyIndexWriter {
+    private:
+        std::vector<MelodyIndex::Melody> melodies_;
+
+    public:
+        MelodyIndexWriter() = default;
+
+        void add( MelodyIndex::Melody&& melody ) { melodies_.push_back( std::move( melody ) ); }
+        size_t part_count() const { return melodies_.size(); }
+
+        // collect the n-grams of every melody on the pool, sort them and write the index
+        // prints an error to cerr and returns false if the file cannot be written
+        bool write( const std::string& path, size_t ngram, ThreadPool& pool );
+
+    private:
+        static void pad_to_alignment( std::ofstream& file );
+};
+
+static_assert( sizeof(MelodyIndex::FileHeader) == 96 );
+static_assert( sizeof(MelodyIndex::PartEntry) == 64 );
+static_assert( sizeof(MelodyIndex::Location) == 4 );
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a Standard MIDI File (format 0 or 1), memory-mapped and read into the notes of each voice
+//  a voice is a track with notes, or a channel with notes if all the notes are in one track (as in format 0)
+//  times are in the file's ticks; Part::parse_midi() quantizes them onto its grid
+class MidiFile {
+    public:
+        static inline const std::string EXTENSION = ".mid";
+        // the grid notes are quantized onto: fine enough for thirty-second notes and for triplets
+        static constexpr size_t QUANTIZE_SUB_BEATS = 24;
+
+        struct Note {
+            uint64_t start{0};
+            uint64_t end{0};
+            int pitch{0};           // MIDI note number, middle C is 60
+        };
+
+        struct Voice {
+            std::string name;       // the track name, e.g. "Soprano"
+            std::vector<Note> notes;    // ordered by start, highest pitch first
+        };
+
+        struct TimeSignature {
+            uint64_t tick{0};
+            size_t beats{4};
+            size_t beatType{4};
+        };
+
+    private:
+        size_t ticksPerQuarter_{0};
+        std::vector<TimeSignature> timeSignatures_;    // ordered by tick, never empty once loaded
+        int key_{0};            // sharps (plus) or flats (minus) of the first key signature
+        bool minor_{false};
+        uint64_t keyTick_{UINT64_MAX};  // tick of the key signature read so far
+        std::string title_;     // the name of the first track, if it has no notes
+        std::vector<Voice> voices_;
+
+    public:
+        // map the file and read its events
+        // prints an error to cerr and returns false if it cannot be read or is not a supported MIDI file
+        bool open( const std::string& path );
+
+        size_t get_ticks_per_quarter() const { return ticksPerQuarter_; }
+        const std::vector<TimeSignature>& get_time_signatures() const { return timeSignatures_; }
+        int get_key() const { return key_; }
+        bool is_minor() const { return minor_; }
+        std::string get_title() const { return title_; }
+        const std::vector<Voice>& get_voices() const { return voices_; }
+
+        // the first onset and the last release of any voice, so that every part starts and ends together
+        uint64_t get_first_onset() const;
+        uint64_t get_last_release() const;
+
+    private:
+        bool parse( const unsigned char* data, size_t size );
+
+        // read the events of one track, adding its notes to one voice per channel
+        bool parse_track( const unsigned char* data, size_t size, std::string& name, std::vector<Voice>& channels );
+
+        // read a variable-length quantity, advancing the position; returns false if it runs past the end
+        static bool read_variable_length( const unsigned char* data, size_t size, size_t& position, uint64_t& value );
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "Part.h"
+#include "XmlWriter.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// turns the encodings of a chorale back into a MusicXML score, the inverse of Part::parse_xml()
+//  separate parts become one MusicXML part each
+//  the chords of a combined part are split into one MusicXML part per voice, and a voice's tied continuations
+//   within a measure are merged back into a single note
+//  the score is written to the stream as it is produced; no document is built in memory
+class MusicXmlRenderer {
+    public:
+        static inline const std::string DOCTYPE = "<!DOCTYPE score-partwise PUBLIC "
+            "\"-//Recordare//DTD MusicXML 3.1 Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">";
+
+    private:
+        // a note or rest of one voice, ready to be written
+        struct VoiceNote {
+            Note note;
+            bool tieStart{false};   // tied to the next note
+            bool fermata{false};    // followed by <EOP>
+        };
+
+        struct Voice {
+            std::string name;
+            std::vector<std::vector<VoiceNote>> measures;
+        };
+
+        std::string id_;
+        int key_{0};
+        Part::Mode mode_{Part::Mode::MAJOR};
+        size_t beatsPerMeasure_{4};
+        size_t subBeatsPerBeat_{8};
+        std::vector<Voice> voices_;
+
+    public:
+        // lay out the parts of one chorale
+        // prints an error to cerr and returns false if they cannot be rendered
+        bool load( const std::vector<std::unique_ptr<Part>>& parts );
+
+        // write the score
+        void write( std::ostream& os ) const;
+
+    private:
+        // add one voice per separate part, or one per chord voice of a combined part
+        void add_part( const Part& part );
+        // cut voices that have no <EOM> markers into measures of beatsPerMeasure_, tying notes across barlines
+        void split_measures( Voice& voice ) const;
+        // mark the notes that are tied to the next note
+        static void mark_ties( Voice& voice );
+
+        void write_part( XmlWriter& writer, const Voice& voice, size_t number ) const;
+        void write_note( XmlWriter& writer, const VoiceNote& voiceNote ) const;
+
+        // the MusicXML note type and number of dots for a duration in sub-beats, or "" if there is none
+        std::string note_type( unsigned int duration, int& dots ) const;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a compressed MusicXML (.mxl) file: a zip archive whose META-INF/container.xml names the root score
+//  the archive is read from memory, so a downloaded .mxl never touches the disk; only the central directory and
+//  the entries needed are parsed, and each is inflated straight into a string
+class MxlContainer {
+    public:
+        static inline const std::string EXTENSION = ".mxl";
+        static inline const std::string CONTAINER_PATH = "META-INF/container.xml";
+        // the largest entry inflated, far above any score; the sizes in the directory are not trusted
+        static constexpr size_t MAX_ENTRY_SIZE = size_t{1} << 28;
+        // the most deflate can compress: 258 bytes per 2-bit code, plus the end of the block
+        static constexpr size_t MAX_DEFLATE_RATIO = 1032;
+
+    private:
+        // an entry of the zip central directory
+        struct Entry {
+            std::string name;
+            uint16_t method{0};             // 0 = stored, 8 = deflated
+            uint32_t crc{0};
+            uint32_t compressedSize{0};
+            uint32_t size{0};
+            uint32_t localHeaderOffset{0};
+        };
+
+    public:
+        // true if the data starts like a zip archive
+        static bool is_container( std::string_view data ) { return data.starts_with( "PK\x03\x04" ); }
+
+        // inflate the root score of an .mxl archive into xml
+        // prints an error to cerr and returns false if the archive is malformed or has no score
+        static bool extract_score( std::string_view data, std::string& xml );
+
+    private:
+        static bool read_directory( std::string_view data, std::vector<Entry>& entries );
+        static bool extract( std::string_view data, const Entry& entry, std::string& contents );
+        // the path of the root score, from container.xml, or else the first .xml entry outside META-INF
+        static std::string find_root_path( std::string_view data, const std::vector<Entry>& entries );
+
+        // little-endian fields; the caller checks that they lie within the data
+        static uint16_t read_u16( std::string_view data, size_t offset ) {
+            return static_cast<uint16_t>( static_cast<unsigned char>( data[offset] )
+                | static_cast<unsigned char>( data[offset + 1] ) << 8 );
+        }
+        static uint32_t read_u32( std::string_view data, size_t offset ) {
+            return read_u16( data, offset ) | static_cast<uint32_t>( read_u16( data, offset + 2 ) ) << 16;
+        }
+};
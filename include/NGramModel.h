@@ -0,0 +1,82 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// an n-gram language model over the tokens of encodings, with interpolated Kneser-Ney smoothing, as a baseline for
+//  comparing tokenizations
+//  each line is a sequence, padded on the left with order-1 start tokens and ended with an end token
+//  an n-gram is packed into a 64-bit key, its first token in the highest bits, so a key's context and suffix are a
+//   shift and a mask away; counts are kept in hash tables sharded by key, so they can be counted, merged and
+//   adjusted on separate threads
+class NGramModel {
+    public:
+        static constexpr uint32_t BOS = 0;     // start of sequence (context only)
+        static constexpr uint32_t EOS = 1;     // end of sequence
+        static constexpr uint32_t UNK = 2;     // a token not seen in training
+
+        using Sequence = std::vector<uint32_t>;
+
+        // the log-probability of a set of sequences
+        struct Score {
+            double bits{0};         // -log2 of the probability
+            uint64_t tokens{0};     // tokens predicted, including the end token of each sequence
+            uint64_t unknown{0};    // tokens not seen in training
+        };
+
+    private:
+        using Table = std::unordered_map<uint64_t, uint64_t>;
+
+        // the totals of the counts that follow a context
+        struct Context {
+            uint64_t total{0};      // sum of the counts
+            uint64_t types{0};      // number of distinct tokens
+        };
+
+        size_t order_;
+        std::unordered_map<std::string, uint32_t> ids_;
+        size_t vocabularySize_{3};
+        unsigned int bits_{1};                          // bits per token in a key
+        std::vector<std::vector<Table>> counts_;        // [order - 1][shard]; Kneser-Ney adjusted below the top order
+        std::vector<std::unordered_map<uint64_t, Context>> contexts_;  // [order - 1], keyed by context
+        std::vector<double> discounts_;                 // [order - 1]
+
+    public:
+        explicit NGramModel( size_t order ) : order_{order} {}
+
+        // the tokens of a line, without its header; tokens not in the vocabulary are added if grow is set, or are
+        //  UNK otherwise
+        Sequence encode( std::string_view line, bool grow );
+
+        // count the n-grams of the training sequences and compute the smoothed model
+        // prints an error to cerr and returns false if order n-grams of the vocabulary do not fit in a key
+        bool train( const std::vector<Sequence>& sequences, ThreadPool& pool );
+
+        // the log-probability the model gives a set of sequences
+        Score score( const std::vector<Sequence>& sequences, ThreadPool& pool ) const;
+
+        size_t get_order() const { return order_; }
+        // tokens, including the end and unknown tokens (the start token is never predicted)
+        size_t vocabulary_size() const { return vocabularySize_ - 1; }
+        // distinct n-grams of an order
+        size_t ngram_count( size_t order ) const;
+
+    private:
+        // -log2 of the probability of the token at position i of a padded sequence, given the tokens before it
+        double cost( const uint32_t* padded, size_t i ) const;
+
+        uint64_t lookup( size_t order, uint64_t key ) const;
+        size_t shard_of( uint64_t key ) const { return mix( key ) % counts_[0].size(); }
+        uint32_t first_token( size_t order, uint64_t key ) const {
+            return static_cast<uint32_t>( key >> ((order - 1) * bits_) );
+        }
+        uint64_t suffix( size_t order, uint64_t key ) const {
+            return key & ((uint64_t{1} << ((order - 1) * bits_)) - 1);
+        }
+
+        static uint64_t mix( uint64_t value );
+};
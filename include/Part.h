@@ -2,12 +2,17 @@
 
 #include "Arguments.h"
 #include "Encoding.h"
+#include "MidiFile.h"
+#include "PartSnapshot.h"
+#include "TokenPositions.h"
 #include "XmlUtils.h"
 
+#include <array>
 #include <map>
 #include <memory>
 #include <string>
 #include <tinyxml2.h>
+#include <utility>
 #include <vector>
 
 struct PartPrintOptions {
@@ -16,6 +21,8 @@ struct PartPrintOptions {
     bool printEndTokensAsPeriod = false;
     bool consolidateBeat = false;
     bool printOnlyStartingTokenforEachBeat = false;
+    bool printIntervals = false;
+    bool printVoices = false;
 
     PartPrintOptions() = default;
     PartPrintOptions( const Arguments& args ) :
@@ -23,7 +30,26 @@ struct PartPrintOptions {
         printEOM{!args.noEOM()},
         printEndTokensAsPeriod{args.endTokens()},
         consolidateBeat{args.consolidateBeat()},
-        printOnlyStartingTokenforEachBeat{args.startingTokensOnly()} {}
+        printOnlyStartingTokenforEachBeat{args.startingTokensOnly()},
+        printIntervals{args.intervals()},
+        printVoices{args.voices()} {}
+
+    // selects one of the specialized emit kernels in Part (printHeader is handled outside the kernels)
+    size_t kernel_index() const {
+        return normalize_kernel_index( (printEOM ? 1 : 0)
+            | (printEndTokensAsPeriod ? 2 : 0)
+            | (consolidateBeat ? 4 : 0)
+            | (printOnlyStartingTokenforEachBeat ? 8 : 0)
+            | (printIntervals ? 16 : 0)
+            | (printVoices ? 32 : 0) );
+    }
+    static constexpr size_t KERNEL_COUNT = 64;
+
+    // consolidateBeat is ignored with printOnlyStartingTokenforEachBeat or printVoices, as Arguments resolves them, so
+    //  such an index is that of the same options without it and no kernel is compiled for the combination
+    static constexpr size_t normalize_kernel_index( size_t index ) {
+        return (index & (8 | 32)) ? (index & ~size_t{4}) : index;
+    }
 };
 
 
@@ -42,6 +68,11 @@ class Part {
         static inline const std::string KEY = "KEY: ";
         static inline const std::string BEATS = "BEATS: ";
         static inline const std::string SUB_BEATS = "SUB-BEATS: ";
+        static inline const std::string ENCODING = "ENCODING: ";   // only written for intervals or voices
+        static inline const std::string INTERVALS_STR = "Intervals";
+        static inline const std::string VOICES_STR = "Voices";
+        // with voices, the token ending each note or chord, followed by its duration
+        static constexpr char VOICES_DURATION = ':';
         static inline const std::string EOH = "]";
         static inline const std::string DELIM = ", ";
         static inline const std::string MAJOR_STR = "Major";
@@ -141,8 +172,14 @@ class Part {
 
         // parse the MusicXML 'Part' element  
         bool parse_xml( tinyxml2::XMLElement* part );
+        // parse one voice of a MIDI file, quantized to MidiFile::QUANTIZE_SUB_BEATS sub-beats per beat
+        bool parse_midi( const MidiFile& midi, const MidiFile::Voice& voice );
         // parse the encoding (performed on the musicXml in a previous run) 
         bool parse_encoding( const std::string& part );
+        // parse only the header of an encoding, leaving encodings_ empty
+        bool parse_header( const std::string& part );
+        // rebuild a part written to a snapshot (see PartSnapshot), from its entry and its records
+        bool parse_snapshot( const PartSnapshot::PartEntry& entry, const PartSnapshot::Record* records );
         // transpose part to the key with given number of sharps (if plus) or flats (if minus)
         bool transpose( int key = 0 );       
 
@@ -150,17 +187,22 @@ class Part {
         std::string get_id() const { return id_; }
         std::string get_title() const { return title_; }
         std::string get_part_name() const { return partName_; }
-        std::string get_header() const;
+        // with intervals or voices, the header says how the encodings are written
+        std::string get_header( bool intervals = false, bool voices = false ) const;
         int get_beats_per_measure() const { return beatsPerMeasure_; }
         int get_sub_beats() const { return subBeatsPerBeat_; }
         int get_key() const { return key_; }
         Mode get_mode() const { return mode_; }
+        // the smallest number of sub-beats per beat the part can be rescaled onto exactly
+        size_t min_sub_beats() const;
 
         // setters
         void set_beats_per_measure( size_t beatsPerMeasure ) {
             beatsPerMeasure_ = beatsPerMeasure;
         }
-        void set_sub_beats( size_t subBeats );
+        // rescale durations and ticks to the given grid; returns false if any of them are rounded, and if report is
+        //  true prints the first one rounded to cerr
+        bool set_sub_beats( size_t subBeats, bool report = false );
 
         // access encodings_
         std::unique_ptr<Encoding> pop_encoding();
@@ -168,6 +210,7 @@ class Part {
         std::unique_ptr<Encoding>& get_last_encoding() {
             return encodings_.back();
         }
+        const std::vector<std::unique_ptr<Encoding>>& get_encodings() const { return encodings_; }
 
         // conversions to facillitate printing
         std::string key_to_string() const {
@@ -181,6 +224,8 @@ class Part {
         std::string location_to_string( const Encoding* encoding ) const;
         std::string to_string() const;
         std::string to_string( const PartPrintOptions& options ) const;
+        // also record the position of each token written after the header
+        std::string to_string( const PartPrintOptions& options, TokenPositions& positions ) const;
 
         friend std::ostream& operator <<( std::ostream& os, const Part& part );
 
@@ -190,7 +235,8 @@ class Part {
         // parse the MusicXML 'attributes' element, set variables accordingly
         bool parse_attributes( tinyxml2::XMLElement* attributes );
         // parse the MusicXML 'measure' element, append words to encodings_ accordingly
-        bool parse_measure( tinyxml2::XMLElement* measure );
+        //  tieStarted carries the part's tie state from note to note
+        bool parse_measure( tinyxml2::XMLElement* measure, bool& tieStarted );
 
         // returns the specified child of a given XML element or nullptr
         tinyxml2::XMLElement* try_get_child( tinyxml2::XMLElement* parent, const char* childName, bool verbose = true );
@@ -202,12 +248,19 @@ class Part {
         std::string find_header_value( const std::string& header, const std::string& key ) const;
         bool import_encodings( const std::string& line );
         std::unique_ptr<Encoding> make_encoding( const std::string& encoding ) const;
+        bool import_interval_encodings( const std::string& line );
+        // rejoin the voice tokens of each note or chord (see write_voice_tokens()) into one token
+        static std::string join_voices( const std::string& line );
+        // a note or chord written as intervals; reference is the pitch the intervals are from, updated as in
+        //  write_interval_token()
+        std::unique_ptr<Encoding> make_interval_encoding( const std::string& encoding, int& reference ) const;
         bool import_key( const std::string& keyString );
 
         // helper functions for transpose()
 
-        // transpose to a key one level higher in the circle of fifths
-        void transpose_up( Note& note, bool byFifth ) {
+        // transpose a note or chord to a key one level higher in the circle of fifths
+        template <typename NoteOrChord>
+        void transpose_up( NoteOrChord& note, bool byFifth ) {
             if (byFifth) {
                 note.transpose( transposeUpAFifthRules );
             }
@@ -215,8 +268,9 @@ class Part {
                 note.transpose( transposeDownAFourthRules );
             }
         }
-        // transpose to a key one level lower in the circle of fifths
-        void transpose_down( Note& note, bool byFifth ) {
+        // transpose a note or chord to a key one level lower in the circle of fifths
+        template <typename NoteOrChord>
+        void transpose_down( NoteOrChord& note, bool byFifth ) {
             if (byFifth) {
                 note.transpose( transposeDownAFifthRules );
             }
@@ -227,8 +281,33 @@ class Part {
 
         // helper functions for to_string()
         void print_header( std::ostream& os, const PartPrintOptions& opts ) const;
-        void print_marker( std::ostream& os, const PartPrintOptions& opts, const Encoding& marker ) const;
-        void print_note( std::ostream& os, const PartPrintOptions& opts, const Encoding& note, 
-            bool startsBeat, bool endsBeat ) const;
+
+        // each combination of print options has its own emit loop, with the options fixed at compile time
+        template <bool PrintEOM, bool EndTokensAsPeriod, bool ConsolidateBeat, bool StartingTokensOnly, bool Intervals,
+            bool Voices>
+        void emit_encodings( std::ostream& os, TokenPositions* positions ) const;
+        using EmitKernel = void (Part::*)( std::ostream& os, TokenPositions* positions ) const;
+        static const std::array<EmitKernel, PartPrintOptions::KERNEL_COUNT> emitKernels_;
+        // the kernel for each index, with the template arguments taken from the bits of the index
+        template <size_t... Index>
+        static constexpr std::array<EmitKernel, sizeof...(Index)> make_emit_kernels( std::index_sequence<Index...> );
+
+        // record the positions of the tokens written for an encoding: one token, or one per voice and a duration
+        //  token if voices
+        void add_positions( TokenPositions& positions, const Encoding& encoding, bool voices ) const;
+
+        // write a note or chord without going through its virtual to_string()
+        static void write_token( std::ostream& os, const Encoding& encoding, bool ignoreDuration );
+
+        // the MIDI pitch (middle C) the first interval of a part is measured from
+        static constexpr int INTERVAL_REFERENCE = 60;
+        // write a note as its interval in semitones from the reference (the previous note), or a chord as the
+        //  intervals of its upper voices above its bass and of its bass from the reference (the previous bass);
+        //  the reference becomes the note, or the bass, unless it is a rest
+        //  with voices, each interval is a token of its own, as in write_voice_tokens()
+        static void write_interval_token( std::ostream& os, const Encoding& encoding, bool ignoreDuration,
+            int& reference, bool voices );
+        // write each pitch of a note or chord as a token, then VOICES_DURATION and the duration as a token
+        static void write_voice_tokens( std::ostream& os, const Encoding& encoding, bool ignoreDuration );
 
 };
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Part;
+
+// a binary snapshot of the parts inputXml encodes, which inputEncodings loads with one mapping of the file and no
+//  parsing of headers or tokens: the header fields of each part, then one fixed-size record per note or marker
+//  with its location, as Part holds them
+//
+//  file layout (native byte order):
+//      FileHeader
+//      for each part: its records, 64-byte aligned
+//      PartEntry for each part, in the order written
+struct PartSnapshot {
+    static constexpr char MAGIC[4] = { 'C', 'P', 'S', 'N' };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr uint8_t MAX_OCTAVE = 9;    // the highest octave with a MIDI pitch
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t partCount;
+        uint64_t tableOffset;   // byte offset of the first PartEntry
+        uint64_t reserved;
+    };
+
+    struct PartEntry {
+        uint64_t offset;            // byte offset of the part's first record
+        uint32_t records;
+        uint16_t beatsPerMeasure;
+        uint16_t subBeatsPerBeat;
+        int8_t key;                 // sharps (plus) or flats (minus)
+        uint8_t mode;               // Part::Mode
+        uint8_t reserved[6];
+        char id[64];                // null-terminated (a longer ID cannot be written)
+        char part[40];
+    };
+
+    struct Record {
+        uint16_t measure;           // origin 1 (0 for an upbeat)
+        uint16_t tick;              // origin 1, within the measure
+        uint16_t duration;          // in sub-beats (0 for a marker)
+        uint8_t type;               // Encoding::TokenType: NOTE or MARKER
+        uint8_t value;              // a note's pitch letter ('R' for a rest), or a Marker::MarkerType
+        int8_t accidental;          // half-steps above (plus) or below (minus) the letter
+        uint8_t octave;
+        uint8_t tied;               // 1 if the note is tied from the previous note
+        uint8_t reserved;
+    };
+
+    // true if the file starts with MAGIC, so it can be told apart from a file of encodings
+    static bool is_snapshot( const std::string& path );
+};
+
+static_assert( sizeof(PartSnapshot::FileHeader) == 32 );
+static_assert( sizeof(PartSnapshot::PartEntry) == 128 );
+static_assert( sizeof(PartSnapshot::Record) == 12 );
+
+// writes the parts of each chorale, in the order they are added
+class PartSnapshotWriter {
+    private:
+        std::ofstream file_;
+        std::vector<PartSnapshot::PartEntry> table_;
+        std::vector<PartSnapshot::Record> records_;     // scratch, reused for each part
+
+    public:
+        PartSnapshotWriter() = default;
+        ~PartSnapshotWriter() { close(); }
+
+        // open the file, reserving space for the header
+        bool open( const std::string& path );
+        bool is_open() const { return file_.is_open(); }
+
+        // append a part of notes and markers
+        // prints an error to cerr and returns false if the part has a chord, or a field too large for its record,
+        //  or if it could not be written
+        bool add( const Part& part );
+
+        // write the table and the header
+        // prints an error to cerr and returns false if the file could not be completed
+        bool close();
+
+    private:
+        void pad_to_alignment();
+};
+
+// maps a snapshot and rebuilds its parts, grouped into chorales as EncodingReader groups lines
+class PartSnapshotReader {
+    private:
+        const char* data_{nullptr};
+        size_t size_{0};
+        const PartSnapshot::PartEntry* table_{nullptr};
+        size_t partCount_{0};
+        size_t nextPart_{0};
+
+    public:
+        PartSnapshotReader() = default;
+        ~PartSnapshotReader() { close(); }
+        PartSnapshotReader( const PartSnapshotReader& ) = delete;
+        PartSnapshotReader& operator=( const PartSnapshotReader& ) = delete;
+
+        // map the file and check that its table and records lie within it
+        bool open( const std::string& path );
+        void close();
+        bool is_open() const { return data_ != nullptr; }
+
+        size_t part_count() const { return partCount_; }
+
+        // replace parts with the parts of the next chorale: consecutive parts with the same ID
+        // returns false when there are no more chorales
+        bool read_chorale( std::vector<std::unique_ptr<Part>>& parts );
+
+    private:
+        // rebuild the next part that loads into a Part; returns nullptr after the last part
+        std::unique_ptr<Part> read_part();
+};
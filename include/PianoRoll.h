@@ -0,0 +1,111 @@
+#pragma once
+#include "Part.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// a dense voices x ticks grid of MIDI pitches built from the encodings of a chorale's parts
+//  each cell holds the MIDI pitch sounding in that voice at that tick (0 for a rest)
+//  the ONSET bit is set on the first tick of a note that is not tied from the previous note
+class PianoRoll {
+    public:
+        static constexpr uint8_t REST = 0;
+        static constexpr uint8_t ONSET = 0x80;
+        static constexpr uint8_t PITCH_MASK = 0x7f;
+
+    private:
+        std::string id_;
+        Part::Mode mode_{Part::Mode::MAJOR};
+        size_t beatsPerMeasure_{0};
+        size_t subBeatsPerBeat_{0};
+        size_t startTick_{0};   // ticks of the first measure missing because of an upbeat (origin 0)
+        size_t voices_{0};
+        size_t ticks_{0};
+
+        // voices_ rows of ticks_ cells, one row per voice in the order the parts were given
+        std::vector<uint8_t> cells_;
+
+    public:
+        PianoRoll() = default;
+
+        // build the grid from the given parts, which must all have the same number of sub-beats per beat
+        // prints an error to cerr and returns false if it fails
+        bool build( const std::vector<const Part*>& parts );
+
+        // getters
+        std::string get_id() const { return id_; }
+        Part::Mode get_mode() const { return mode_; }
+        size_t get_beats_per_measure() const { return beatsPerMeasure_; }
+        size_t get_sub_beats() const { return subBeatsPerBeat_; }
+        size_t get_start_tick() const { return startTick_; }
+        size_t get_voices() const { return voices_; }
+        size_t get_ticks() const { return ticks_; }
+        uint8_t at( size_t voice, size_t tick ) const { return cells_[voice * ticks_ + tick]; }
+        const std::vector<uint8_t>& get_cells() const { return cells_; }
+
+    private:
+        // the number of ticks in a part
+        static size_t count_ticks( const Part& part );
+        // fill one row of cells_ from a part
+        void fill_voice( size_t voice, const Part& part );
+};
+
+// writes piano rolls to a single file that can be memory-mapped and used without parsing
+//
+//  file layout (native byte order):
+//      FileHeader
+//      cell data for each chorale (voices x ticks uint8_t, voice-major), each block 64-byte aligned
+//      TableEntry for each chorale
+class PianoRollWriter {
+    public:
+        static constexpr char MAGIC[4] = { 'C', 'P', 'R', 'L' };
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t ALIGNMENT = 64;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint64_t choraleCount;
+            uint64_t tableOffset;   // byte offset of the first TableEntry
+            uint64_t reserved;
+        };
+
+        struct TableEntry {
+            uint64_t offset;        // byte offset of the chorale's cells
+            uint32_t ticks;
+            uint16_t voices;
+            uint16_t beatsPerMeasure;
+            uint16_t subBeatsPerBeat;
+            uint16_t startTick;
+            uint8_t mode;           // 0 for major, 1 for minor
+            uint8_t reserved[3];
+            char id[24];            // null-terminated, truncated if necessary
+        };
+
+    private:
+        std::ofstream file_;
+        std::vector<TableEntry> table_;
+
+    public:
+        PianoRollWriter() = default;
+        ~PianoRollWriter() { close(); }
+
+        // open the file, reserving space for the header
+        bool open( const std::string& path );
+        bool is_open() const { return file_.is_open(); }
+
+        // append a chorale's cells
+        bool add( const PianoRoll& roll );
+
+        // write the offset table and the header
+        // prints an error to cerr and returns false if the file could not be completed
+        bool close();
+
+    private:
+        void pad_to_alignment();
+};
+
+static_assert( sizeof(PianoRollWriter::FileHeader) == 32 );
+static_assert( sizeof(PianoRollWriter::TableEntry) == 48 );
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Part;
+
+// chooses the rhythmic grid (sub-beats per beat) the parts of a chorale are encoded on, and counts the piano-roll
+//  columns this saves
+//  a fixed grid is used for every chorale; AUTO picks the smallest grid each chorale fits on exactly
+class RhythmGrid {
+    public:
+        static constexpr size_t AUTO = 0;
+
+    private:
+        size_t subBeats_{AUTO};
+
+        // statistics over the chorales the grid has been applied to
+        size_t chorales_{0};
+        size_t columnsBefore_{0};       // at the reference grid passed to apply()
+        size_t columnsAfter_{0};
+        size_t referenceSubBeats_{0};   // the last reference grid, for the report
+        size_t corpusSubBeats_{1};      // the smallest grid every chorale so far fits on exactly
+        std::map<size_t, size_t> subBeatsUsed_;
+
+    public:
+        RhythmGrid() = default;
+        explicit RhythmGrid( size_t subBeats ) : subBeats_{subBeats} {}
+
+        // parse a specification: "auto" or a number of sub-beats per beat
+        // prints an error to cerr and returns false if it is invalid
+        bool parse( const std::string& spec );
+
+        bool is_auto() const { return subBeats_ == AUTO; }
+        size_t get_sub_beats() const { return subBeats_; }
+
+        // the smallest grid all the parts can be rescaled onto without losing a tick
+        static size_t min_sub_beats( const std::vector<Part*>& parts );
+
+        // rescale the parts onto the grid, counting their columns before (at referenceSubBeats) and after
+        // prints an error to cerr and returns false, leaving the parts unchanged, if a fixed grid would be lossy
+        bool apply( const std::vector<Part*>& parts, size_t referenceSubBeats );
+
+        // write a summary of the columns saved
+        void write_report( std::ostream& os ) const;
+
+    private:
+        // the number of ticks in a part; the piano roll of a chorale has as many columns as its longest part
+        static size_t count_ticks( const Part& part );
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// deterministically assigns chorales to one of N shards by hashing their BWV number
+//  the modifier appended to a repeated BWV (e.g. the 'a' in "BWV 18.5a") is ignored,
+//  so all settings of a BWV land in the same shard
+class Shard {
+    private:
+        size_t index_{0};   // origin 0
+        size_t count_{1};
+
+    public:
+        Shard() = default;
+        Shard( size_t index, size_t count ) : index_{index}, count_{count} {}
+
+        // parse a specification in the format "i/N", with 0 <= i < N
+        // prints an error to cerr and returns false if it is invalid
+        bool parse( const std::string& spec );
+
+        size_t get_index() const { return index_; }
+        size_t get_count() const { return count_; }
+        bool is_sharded() const { return count_ > 1; }
+
+        // true if the chorale with the given BWV (e.g. "BWV 8.6") belongs to this shard
+        bool owns( std::string_view bwv ) const { return shard_of( bwv, count_ ) == index_; }
+
+        static size_t shard_of( std::string_view bwv, size_t count ) { return hash( bwv ) % count; }
+
+        // 64-bit FNV-1a hash of the BWV without its modifier
+        static uint64_t hash( std::string_view bwv );
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// a fixed set of worker threads that run submitted tasks in the order they were submitted
+//  the pool is meant to be created once and shared, so threads are not started for every chorale
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers_;
+        std::queue<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable available_;
+        bool stopping_{false};
+
+    public:
+        // threads defaults to the number of hardware threads
+        explicit ThreadPool( size_t threads = 0 ) {
+            if (threads == 0) {
+                threads = std::max( 1u, std::thread::hardware_concurrency() );
+            }
+            for (size_t _i = 0; _i < threads; _i++) {
+                workers_.emplace_back( [this] { run(); } );
+            }
+        }
+
+        // finishes the queued tasks, then joins the workers
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> _lock{ mutex_ };
+                stopping_ = true;
+            }
+            available_.notify_all();
+            for (auto& _worker : workers_) {
+                _worker.join();
+            }
+        }
+
+        ThreadPool( const ThreadPool& ) = delete;
+        ThreadPool& operator=( const ThreadPool& ) = delete;
+
+        size_t size() const { return workers_.size(); }
+
+        // queue a task; the future returns its result, or rethrows its exception
+        template <typename F>
+        std::future<std::invoke_result_t<F>> submit( F&& task ) {
+            using Result = std::invoke_result_t<F>;
+            auto _task = std::make_shared<std::packaged_task<Result()>>( std::forward<F>( task ) );
+            std::future<Result> _result = _task->get_future();
+            {
+                std::lock_guard<std::mutex> _lock{ mutex_ };
+                tasks_.emplace( [_task] { (*_task)(); } );
+            }
+            available_.notify_one();
+            return _result;
+        }
+
+        // split [0, n) into one contiguous range per thread (a single empty range if n is 0, so there is always a
+        //  result to merge), run fn( first, last ) for each range as a task and wait for them all; returns the
+        //  results in the order of their ranges (nothing if fn returns void), or rethrows the first exception once
+        //  every task has finished with fn
+        template <typename F>
+        auto map_ranges( size_t n, F&& fn ) {
+            using Result = std::invoke_result_t<F&, size_t, size_t>;
+            size_t _tasks = std::max<size_t>( 1, std::min( n, size() ) );
+            std::vector<std::future<Result>> _futures;
+            for (size_t _t = 0; _t < _tasks; _t++) {
+                size_t _first = n * _t / _tasks;
+                size_t _last = n * (_t + 1) / _tasks;
+                _futures.push_back( submit( [&fn, _first, _last] { return fn( _first, _last ); } ) );
+            }
+            for (auto& _future : _futures) {
+                _future.wait();
+            }
+
+            if constexpr (std::is_void_v<Result>) {
+                for (auto& _future : _futures) {
+                    _future.get();
+                }
+            }
+            else {
+                std::vector<Result> _results;
+                _results.reserve( _futures.size() );
+                for (auto& _future : _futures) {
+                    _results.push_back( _future.get() );
+                }
+                return _results;
+            }
+        }
+
+    private:
+        void run() {
+            while (true) {
+                std::function<void()> _task;
+                {
+                    std::unique_lock<std::mutex> _lock{ mutex_ };
+                    available_.wait( _lock, [this] { return stopping_ || !tasks_.empty(); } );
+                    if (tasks_.empty()) {
+                        return;
+                    }
+                    _task = std::move( tasks_.front() );
+                    tasks_.pop();
+                }
+                _task();
+            }
+        }
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include "Vocabulary.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a deterministic automaton over the token IDs of a vocabulary that accepts only well-formed chorales, for masking
+//  the logits of a sampler so that every sample it draws parses
+//
+//  the tokens are those printed with the default options (see Vocabulary), or with [SOC] and [EOC] printed as '.'
+//   (-e); the grammar is
+//      [SOC] measure ( [EOM] measure )* [EOC]
+//  where a measure is a run of notes or chords, each optionally followed by [EOP], whose durations fill at most
+//   beatsPerMeasure * subBeatsPerBeat ticks; as in Part, any measure may be shorter, but not empty
+//  optionally, a voice may only be tied to the same pitch (or rest) in the previous note or chord, across [EOM]
+//   and [EOP]; a combined part ties voices across chord changes, so this holds only for single voices
+//
+//  the automaton is the product of two, each with its allowed tokens precomputed as bitmasks:
+//   the measure automaton, whose state is the position in the measure, with a transition table over token IDs
+//   the tie automaton, whose state is the pitches of the last note or chord
+//  so the tokens allowed in a state are the AND of one mask from each, vocabulary size / 64 words
+class TokenGrammar {
+    public:
+        struct State {
+            uint32_t measure{START};
+            uint32_t pitches{NO_PITCHES};
+        };
+
+        static constexpr uint32_t START = 0;        // before [SOC]
+        static constexpr uint32_t END = 1;          // after [EOC]
+        static constexpr uint32_t NO_PITCHES = 0;   // no note or chord yet
+        static constexpr uint16_t REJECT = 0xffff;  // in the transition table, a token that is not allowed
+
+    private:
+        // what each token of the vocabulary is
+        enum TokenClass : uint8_t {
+            INVALID,        // <PAD>, <UNK> and anything that does not parse: never allowed
+            SOC,
+            EOM,
+            EOP,
+            EOC,
+            PERIOD,         // '.', printed for [SOC] or [EOC] with -e
+            NOTE            // a note or chord
+        };
+
+        size_t vocabularySize_{0};
+        size_t words_{0};                   // uint64 words per mask
+        size_t ticksPerMeasure_{0};
+
+        std::vector<TokenClass> classes_;
+        std::vector<uint32_t> durations_;   // of a note or chord
+        std::vector<uint32_t> pitchSets_;   // the pitches of a note or chord, as a tie automaton state
+
+        // measure automaton: next state for each state and token, and the tokens each state allows
+        size_t measureStates_{0};
+        std::vector<uint16_t> transitions_;
+        std::vector<uint64_t> measureMasks_;
+
+        // tie automaton: the tokens each state allows (every untied token, and the tied tokens that match)
+        size_t pitchStates_{0};
+        std::vector<uint64_t> pitchMasks_;
+
+    public:
+        TokenGrammar() = default;
+
+        // compile the grammar for the tokens of a vocabulary in the given meter, with the tie rule if tiesKeepPitch
+        // prints an error to cerr and returns false if the meter is empty or too long, or if the vocabulary is not
+        //  of encodings in a format the grammar is written for (e.g. with --noEOM, -c, -C, --intervals or --voices)
+        bool build( const Vocabulary& vocabulary, size_t beatsPerMeasure, size_t subBeatsPerBeat,
+            bool tiesKeepPitch = true );
+
+        size_t vocabulary_size() const { return vocabularySize_; }
+        size_t mask_words() const { return words_; }
+        size_t measure_states() const { return measureStates_; }
+        size_t pitch_states() const { return pitchStates_; }
+
+        State start() const { return State{}; }
+        bool is_accepting( const State& state ) const { return state.measure == END; }
+
+        // true if the token may follow in the state
+        bool allows( const State& state, int32_t token ) const {
+            return token >= 0 && static_cast<size_t>( token ) < vocabularySize_
+                && test( measure_mask( state.measure ), token ) && test( pitch_mask( state.pitches ), token );
+        }
+        // the state after an allowed token
+        State next( const State& state, int32_t token ) const;
+        // write the tokens allowed in the state to mask_words() words, bit (id % 64) of word (id / 64) for each ID
+        void allowed( const State& state, uint64_t* mask ) const;
+
+        // the precomputed masks the allowed tokens are made from
+        const uint64_t* measure_mask( uint32_t measureState ) const { return &measureMasks_[measureState * words_]; }
+        const uint64_t* pitch_mask( uint32_t pitchState ) const { return &pitchMasks_[pitchState * words_]; }
+
+        // run a sequence of tokens from the start; returns the number accepted before the first one not allowed
+        //  (the whole sequence if it is a complete chorale and is_accepting( state ))
+        size_t accept( const std::vector<int32_t>& tokens, State& state ) const;
+
+    private:
+        static bool test( const uint64_t* mask, int32_t token ) { return (mask[token / 64] >> (token % 64)) & 1; }
+        static void set( uint64_t* mask, int32_t token ) { mask[token / 64] |= uint64_t{1} << (token % 64); }
+
+        // the measure state within a measure: whether it is the first, the ticks filled, and whether a note or chord
+        //  was the last token (so [EOP] may follow)
+        uint32_t in_measure( bool first, size_t ticks, bool afterNote ) const {
+            return 2 + static_cast<uint32_t>( ((first ? ticksPerMeasure_ + 1 : 0) + ticks) * 2 + (afterNote ? 1 : 0) );
+        }
+        // the measure state after a token, or REJECT
+        uint16_t measure_transition( uint32_t measureState, int32_t token ) const;
+
+        // classify the tokens of the vocabulary, and collect the pitches of each note or chord
+        //  pitches holds the MIDI pitches (0 for a rest) of each pitch set, and tied the tied voices of each token
+        // prints an error to cerr and returns false if a token is not a marker, note or chord, or there is no [EOM]
+        bool classify( const Vocabulary& vocabulary, std::vector<std::vector<int>>& pitches,
+            std::vector<uint32_t>& tied );
+        void build_measure_automaton();
+        void build_tie_automaton( const std::vector<std::vector<int>>& pitches, const std::vector<uint32_t>& tied );
+};
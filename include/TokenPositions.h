@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class Part;
+
+// the position of each token written for a part, in parallel arrays, for structured positional embeddings
+//  filled by Part::to_string() as it writes the tokens, so entry n describes the n-th token after the header
+//  markers carry the position they were written at (so [EOM] has the position of the next measure's first beat)
+class TokenPositions {
+    public:
+        static constexpr uint8_t NO_VOICE = 0xff;  // the voice of a marker, a whole chord or a duration token
+
+    private:
+        std::vector<uint16_t> measures_;    // origin 1 (0 for an upbeat)
+        std::vector<uint8_t> beats_;        // origin 1
+        std::vector<uint8_t> subBeats_;     // origin 1
+        std::vector<uint8_t> voices_;       // origin 0: 0 for a note, the voice of a chord's voice token
+                                            //  (--voices), NO_VOICE for anything else
+        std::vector<uint8_t> tied_;         // bit v set if voice v of the token is tied from the previous note
+                                            //  (bit 0 for a note or a voice token)
+
+    public:
+        TokenPositions() = default;
+
+        void add( size_t measure, size_t beat, size_t subBeat, uint8_t voice, uint8_t tied ) {
+            measures_.push_back( static_cast<uint16_t>( measure ) );
+            beats_.push_back( static_cast<uint8_t>( beat ) );
+            subBeats_.push_back( static_cast<uint8_t>( subBeat ) );
+            voices_.push_back( voice );
+            tied_.push_back( tied );
+        }
+        void clear() {
+            measures_.clear();
+            beats_.clear();
+            subBeats_.clear();
+            voices_.clear();
+            tied_.clear();
+        }
+
+        size_t size() const { return measures_.size(); }
+        const std::vector<uint16_t>& get_measures() const { return measures_; }
+        const std::vector<uint8_t>& get_beats() const { return beats_; }
+        const std::vector<uint8_t>& get_sub_beats() const { return subBeats_; }
+        const std::vector<uint8_t>& get_voices() const { return voices_; }
+        const std::vector<uint8_t>& get_tied() const { return tied_; }
+};
+
+// writes the token positions of each line of an output file to a single file that can be memory-mapped and used
+//  without parsing
+//
+//  file layout (native byte order):
+//      FileHeader
+//      for each line: the arrays of its tokens, each 64-byte aligned
+//          uint16 measure, uint8 beat, uint8 sub-beat, uint8 voice, uint8 tied
+//      TableEntry for each line
+class TokenPositionsWriter {
+    public:
+        static constexpr char MAGIC[4] = { 'C', 'T', 'P', 'S' };
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t ALIGNMENT = 64;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint64_t lineCount;
+            uint64_t tableOffset;   // byte offset of the first TableEntry
+            uint64_t reserved;
+        };
+
+        struct TableEntry {
+            uint64_t offset;        // byte offset of the line's measure array
+            uint32_t tokens;        // entries in each array
+            uint16_t subBeatsPerBeat;
+            uint16_t reserved;
+            char id[24];            // null-terminated, truncated if necessary
+            char part[24];
+        };
+
+    private:
+        std::ofstream file_;
+        std::vector<TableEntry> table_;
+
+    public:
+        TokenPositionsWriter() = default;
+        ~TokenPositionsWriter() { close(); }
+
+        // open the file, reserving space for the header
+        bool open( const std::string& path );
+        bool is_open() const { return file_.is_open(); }
+
+        // append the positions of the tokens of one line, written for the given part
+        // prints an error to cerr and returns false if they could not be written
+        bool add( const Part& part, const TokenPositions& positions );
+
+        // write the offset table and the header
+        // prints an error to cerr and returns false if the file could not be completed
+        bool close();
+
+    private:
+        void write_array( const void* data, size_t bytes );
+        void pad_to_alignment();
+};
+
+static_assert( sizeof(TokenPositionsWriter::FileHeader) == 32 );
+static_assert( sizeof(TokenPositionsWriter::TableEntry) == 64 );
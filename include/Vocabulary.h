@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// maps the tokens of an encoding (as printed, without a header) to integer IDs for training
+//  IDs 0 and 1 are reserved for padding and for tokens that are not in the vocabulary
+//  the file form has one token per line, the token on line n (origin 0) having ID n
+class Vocabulary {
+    public:
+        static inline const std::string PAD = "<PAD>";
+        static inline const std::string UNK = "<UNK>";
+        static constexpr int32_t PAD_ID = 0;
+        static constexpr int32_t UNK_ID = 1;
+
+    private:
+        std::vector<std::string> tokens_;
+        std::unordered_map<std::string, int32_t> ids_;
+
+    public:
+        Vocabulary() { clear(); }
+
+        // reset to the reserved tokens
+        void clear();
+
+        // add a token if it is new; returns its ID
+        int32_t add( const std::string& token );
+
+        // the ID of a token, or UNK_ID
+        int32_t get_id( const std::string& token ) const {
+            auto _it = ids_.find( token );
+            return _it != ids_.end() ? _it->second : UNK_ID;
+        }
+        const std::string& get_token( int32_t id ) const {
+            return (id >= 0 && static_cast<size_t>( id ) < tokens_.size()) ? tokens_[id] : UNK;
+        }
+        size_t size() const { return tokens_.size(); }
+
+        // prints an error to cerr and returns false if the file cannot be read or written
+        bool load( const std::string& path );
+        bool write( const std::string& path ) const;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include "Part.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// checks the chords of a combined part for the voice-leading faults counted when scoring generated chorales:
+//  parallel fifths and octaves between any two voices, crossing of adjacent voices, and notes outside the range
+//  of a voice
+//
+//  the chords are first packed into one array of MIDI pitches per voice (0 for a rest) and one of onsets (a note
+//   struck rather than tied or rested), so each check is a branch-free loop over consecutive chords of one or two
+//   voices that the compiler can vectorize; the rare faults found are collected afterwards
+class VoiceLeading {
+    public:
+        enum Rule {
+            PARALLEL_FIFTHS,
+            PARALLEL_OCTAVES,   // including unisons
+            VOICE_CROSSING,     // a voice below the voice under it
+            RANGE,              // a note struck outside the voice's range
+            RULE_COUNT
+        };
+        static constexpr const char* RULE_NAMES[RULE_COUNT] = {
+            "parallel fifths", "parallel octaves", "voice crossing", "range"
+        };
+
+        struct Violation {
+            Rule rule;
+            uint8_t upper;      // the voices involved (upper == lower for RANGE)
+            uint8_t lower;
+            uint32_t chord;     // the chord it occurs in (the second chord of a parallel)
+        };
+
+        // the lowest and highest MIDI pitch of a voice, from the corpus as transposed to C major or A minor
+        //  (ignoring its highest and lowest 0.1%)
+        struct Range {
+            uint8_t low;
+            uint8_t high;
+        };
+        static constexpr Range SOPRANO_RANGE{ 57, 84 };   // A3 to C6
+        static constexpr Range ALTO_RANGE{ 52, 77 };      // E3 to F5
+        static constexpr Range TENOR_RANGE{ 47, 72 };     // B2 to C5
+        static constexpr Range BASS_RANGE{ 33, 67 };      // A1 to G4
+
+    private:
+        const Part* part_{nullptr};
+        size_t voices_{0};
+        size_t chords_{0};
+
+        std::vector<uint8_t> pitches_;              // voices_ rows of chords_ MIDI pitches, voice-major
+        std::vector<uint8_t> onsets_;               // 1 where a voice strikes a note, same layout
+        std::vector<const Encoding*> encodings_;    // the chord of each column, for its location
+        std::vector<uint8_t> flags_;                // scratch, one per chord
+        std::vector<Violation> violations_;
+
+    public:
+        VoiceLeading() = default;
+
+        // check the chords of a combined part, which must outlive the results
+        // prints an error to cerr and returns false if the part has no chords or its chords have different voices
+        bool check( const Part& part );
+
+        size_t voice_count() const { return voices_; }
+        size_t chord_count() const { return chords_; }
+        // in the order of their chords
+        const std::vector<Violation>& get_violations() const { return violations_; }
+        size_t count( Rule rule ) const;
+
+        // e.g. "parallel fifths, Soprano and Bass [BWV 1.6, m. 3, b. 2]"
+        std::string to_string( const Violation& violation ) const;
+        // Soprano, Alto, Tenor and Bass for four voices, with Soprano 1 and Soprano 2 for five, else "Voice n"
+        static std::string voice_name( size_t voices, size_t voice );
+
+    private:
+        bool pack( const Part& part );
+
+        // each check sets flags_ for the chords at fault, then collects them as violations
+        void check_parallels( size_t upper, size_t lower );
+        void check_crossing( size_t upper, size_t lower );
+        void check_range( size_t voice, Range range );
+        void collect( Rule rule, size_t upper, size_t lower, uint8_t flag );
+
+        // the range of a voice, or false if the voices are not the usual four or five
+        static bool get_range( size_t voices, size_t voice, Range& range );
+        // d % 12 without a division, exact for 0 <= d < 128
+        static int mod12( int d ) { return d - 12 * ((d * 171) >> 11); }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// writes indented XML straight to a stream, one element at a time, without building a document in memory
+class XmlWriter {
+    public:
+        using Attributes = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+    private:
+        std::ostream& os_;
+        std::vector<std::string> openElements_;
+
+    public:
+        explicit XmlWriter( std::ostream& os ) : os_{os} {}
+
+        // write the xml declaration and, if given, a doctype line
+        void declaration( std::string_view doctype = "" );
+
+        // <name attributes>, to be closed with close()
+        void open( std::string_view name, Attributes attributes = {} );
+        // </name> for the most recently opened element
+        void close();
+        // <name attributes>text</name>
+        void element( std::string_view name, std::string_view text, Attributes attributes = {} );
+        void element( std::string_view name, long value, Attributes attributes = {} ) {
+            element( name, std::to_string( value ), attributes );
+        }
+        // <name attributes/>
+        void empty( std::string_view name, Attributes attributes = {} );
+
+        // close every open element
+        void finish();
+
+    private:
+        void indent();
+        void write_attributes( Attributes attributes );
+        void write_escaped( std::string_view text );
+};
@@ -6,6 +6,20 @@ bool Arguments::parse_command_line(int argc, char** argv)
         parser_.ParseCLI(argc, argv);
         inputSource_ = args::get( inputSourceParm_ );
         outputFile_ = trim_leading_whitespace( args::get( outputFileParm_ ) );
+        if (shardParm_.Matched() && !shard_.parse( args::get( shardParm_ ) )) {
+            return false;
+        }
+        if (gridParm_.Matched() && !grid_.parse( args::get( gridParm_ ) )) {
+            return false;
+        }
+        if (positionsFileParm_.Matched() && mergesFileParm_.Matched()) {
+            std::cerr << "Token positions cannot be written with merges, which join tokens" << std::endl;
+            return false;
+        }
+        if (shardParm_.Matched() && noHeader_.Get()) {
+            std::cerr << "A shard needs its headers, which mergeShards orders the chorales by" << std::endl;
+            return false;
+        }
     } 
     catch (args::Help&) {
         std::cout << parser_;
@@ -34,4 +48,30 @@ std::vector<std::string> Arguments::get_parts_to_parse() const
             _selectedParts.push_back( _flag.get().Name() );
     }
     return _selectedParts;
-}
\ No newline at end of file
+}
+
+Arguments::PartFlags::PartFlags( args::ArgumentParser& parser ) :
+    soprano{parser, "Soprano", "Parse the soprano part", {'s', "soprano"}},
+    soprano1{parser, "Soprano 1", "Parse the soprano 1 part", {'1', "soprano1"}},
+    soprano2{parser, "Soprano 2", "Parse the soprano 2 part", {'2', "soprano2"}},
+    alto{parser, "Alto", "Parse the alto part", {'a', "alto"}},
+    tenor{parser, "Tenor", "Parse the tenor part", {'t', "tenor"}},
+    bass{parser, "Bass", "Parse the bass part", {'b', "bass"}} {}
+
+/**
+ * Returns the names of the parts whose flags were given, in score order.
+ *
+ * @return The part names, or the four standard voices if no flag was given.
+ */
+std::vector<std::string> Arguments::PartFlags::get_parts_to_parse() const {
+    std::vector<std::string> _partsToParse;
+    for (const args::Flag* _flag : { &soprano, &soprano1, &soprano2, &alto, &tenor, &bass }) {
+        if (*_flag) {
+            _partsToParse.push_back( _flag->Name() );
+        }
+    }
+    if (_partsToParse.empty()) {
+        _partsToParse = { "Soprano", "Alto", "Tenor", "Bass" };
+    }
+    return _partsToParse;
+}
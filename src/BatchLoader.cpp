@@ -0,0 +1,172 @@
+#include "BatchLoader.h"
+#include "GzipStream.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <unordered_set>
+
+/**
+ * Reads every non-empty line of a file of encodings as a sample. Lines of separate parts and of combined parts may
+ *  be mixed; each line needs its header, since the key is needed to transpose it.
+ *
+ * @param path The path of the file of encodings.
+ * @return `true` if every line was read, `false` otherwise.
+ */
+bool BatchLoader::load( const std::string& path ) {
+    auto _file = GzipStream::open_input( path );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << path << std::endl;
+        return false;
+    }
+
+    samples_.clear();
+    size_t _lineNumber{0};
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        _lineNumber++;
+        if (_line.empty()) {
+            continue;
+        }
+        auto _sample = std::make_unique<Part>();
+        if (!_sample->parse_encoding( _line )) {
+            std::cerr << "Unable to read line " << _lineNumber << " of " << path << std::endl;
+            return false;
+        }
+        samples_.push_back( std::move( _sample ) );
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Builds the vocabulary from the tokens of every sample, transposed to every key the loader may transpose it to, so
+ *  that augmented rows never need the unknown token. The samples are tokenized on the pool, one contiguous range per
+ *  thread, and the tokens are added in corpus order, so the IDs do not depend on the number of threads.
+ *
+ * @param pool The pool to tokenize on.
+ */
+void BatchLoader::build_vocabulary( ThreadPool& pool ) {
+    auto _partials = pool.map_ranges( samples_.size(), [this]( size_t first, size_t last ) {
+        std::vector<std::string> _tokens;
+        std::unordered_set<std::string> _seen;
+        for (size_t _i = first; _i < last; _i++) {
+            for (int _shift = -options_.transpose; _shift <= options_.transpose; _shift++) {
+                Part _part{ *samples_[_i] };
+                _part.transpose( _part.get_key() + _shift );
+                for (std::string& _token : tokenize( _part )) {
+                    if (_seen.insert( _token ).second) {
+                        _tokens.push_back( std::move( _token ) );
+                    }
+                }
+            }
+        }
+        return _tokens;
+    } );
+
+    vocabulary_.clear();
+    for (const auto& _partial : _partials) {
+        for (const std::string& _token : _partial) {
+            vocabulary_.add( _token );
+        }
+    }
+}
+
+size_t BatchLoader::batches_per_epoch() const {
+    if (samples_.empty()) {
+        return 0;
+    }
+    return std::max<size_t>( 1, samples_.size() / options_.batchSize );
+}
+
+/**
+ * Shuffles the samples for an epoch, seeded by the loader's seed and the epoch.
+ *
+ * @param epoch The epoch (origin 0).
+ * @return The indices of the samples in the order they are visited.
+ */
+std::vector<size_t> BatchLoader::epoch_order( uint64_t epoch ) const {
+    std::vector<size_t> _order( samples_.size() );
+    std::iota( _order.begin(), _order.end(), 0 );
+    std::seed_seq _seed{ options_.seed, epoch };
+    std::mt19937_64 _random{ _seed };
+    std::shuffle( _order.begin(), _order.end(), _random );
+    return _order;
+}
+
+/**
+ * Builds one batch: row r holds the sample at position (batch * batchSize + r) of the epoch's order (wrapping
+ *  around if the corpus has fewer samples than a batch). Each row has its own random generator, seeded by the
+ *  loader's seed, the epoch, the batch and the row.
+ *
+ * @param order The order of the epoch, from epoch_order().
+ * @param epoch The epoch (origin 0).
+ * @param batch The batch within the epoch (origin 0).
+ * @param ids The batch to fill, batch_ids() IDs long.
+ */
+void BatchLoader::make_batch( const std::vector<size_t>& order, uint64_t epoch, size_t batch, int32_t* ids ) const {
+    for (size_t _row = 0; _row < options_.batchSize; _row++) {
+        int32_t* _rowIds = ids + _row * options_.sequenceLength;
+        if (order.empty()) {
+            std::fill( _rowIds, _rowIds + options_.sequenceLength, Vocabulary::PAD_ID );
+            continue;
+        }
+        std::seed_seq _seed{ options_.seed, epoch, static_cast<uint64_t>( batch ), static_cast<uint64_t>( _row ) };
+        std::mt19937_64 _random{ _seed };
+        make_row( *samples_[order[(batch * options_.batchSize + _row) % order.size()]], _random, _rowIds );
+    }
+}
+
+/**
+ * Builds one row: the sample, transposed by a random number of sharps or flats up to the transpose option, cut to
+ *  the sequence length, starting at a random barline (so that the row is full) if cropping, and padded.
+ *
+ * @param sample The sample.
+ * @param random The generator for the row.
+ * @param ids The row to fill, sequenceLength IDs long.
+ */
+void BatchLoader::make_row( const Part& sample, std::mt19937_64& random, int32_t* ids ) const {
+    std::vector<std::string> _tokens;
+    int _shift = options_.transpose > 0
+        ? std::uniform_int_distribution<int>{ -options_.transpose, options_.transpose }( random ) : 0;
+    if (_shift != 0) {
+        Part _transposed{ sample };
+        _transposed.transpose( sample.get_key() + _shift );
+        _tokens = tokenize( _transposed );
+    }
+    else {
+        _tokens = tokenize( sample );
+    }
+
+    size_t _start{0};
+    if (options_.crop && _tokens.size() > options_.sequenceLength) {
+        // the barlines a full row can start at: the start of the sample, and after every [EOM]
+        std::vector<size_t> _barlines{ 0 };
+        for (size_t _i = 0; _i + options_.sequenceLength < _tokens.size(); _i++) {
+            if (_tokens[_i] == Marker::EOM_STR) {
+                _barlines.push_back( _i + 1 );
+            }
+        }
+        _start = _barlines[std::uniform_int_distribution<size_t>{ 0, _barlines.size() - 1 }( random )];
+    }
+
+    size_t _length = std::min( options_.sequenceLength, _tokens.size() - _start );
+    for (size_t _i = 0; _i < _length; _i++) {
+        ids[_i] = vocabulary_.get_id( _tokens[_start + _i] );
+    }
+    std::fill( ids + _length, ids + options_.sequenceLength, Vocabulary::PAD_ID );
+}
+
+std::vector<std::string> BatchLoader::tokenize( const Part& part ) {
+    PartPrintOptions _options;
+    _options.printHeader = false;
+    std::istringstream _is{ part.to_string( _options ) };
+    std::vector<std::string> _tokens;
+    for (std::string _token; _is >> _token; ) {
+        _tokens.push_back( std::move( _token ) );
+    }
+    return _tokens;
+}
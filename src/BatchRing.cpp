@@ -0,0 +1,158 @@
+#include "BatchRing.h"
+
+#include <chrono>
+#include <cstddef>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static_assert( std::atomic<uint64_t>::is_always_lock_free, "the ring needs lock-free 64-bit atomics" );
+static_assert( offsetof( BatchRing::Header, produced ) == 64 && offsetof( BatchRing::Header, consumed ) == 128
+    && offsetof( BatchRing::Header, finished ) == 192, "the ring header must match its documented layout" );
+static_assert( sizeof( BatchRing::Header ) <= BatchRing::DATA_OFFSET, "the ring header must fit before the slots" );
+
+/**
+ * Creates the shared memory for the ring and writes its header. Any shared memory of the same name left by a run
+ *  that did not finish is removed first.
+ *
+ * @param name The name of the shared memory, e.g. "/choraleGPT-batches".
+ * @param slots The number of batches the ring holds.
+ * @param batchSize The rows per batch.
+ * @param sequenceLength The token IDs per row.
+ * @param vocabularySize The number of token IDs, recorded for the consumer.
+ * @return `true` if the ring was created, `false` otherwise.
+ */
+bool BatchRing::create( const std::string& name, uint32_t slots, uint32_t batchSize, uint32_t sequenceLength,
+        uint32_t vocabularySize ) {
+    close();
+    if (slots == 0) {
+        std::cerr << "A batch ring needs at least one slot" << std::endl;
+        return false;
+    }
+
+    shm_unlink( name.c_str() );
+    int _fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+    if (_fd < 0) {
+        std::cerr << "Failed to create shared memory: " << name << std::endl;
+        return false;
+    }
+
+    // slots start on a cache line
+    uint64_t _slotBytes = (static_cast<uint64_t>( batchSize ) * sequenceLength * sizeof( int32_t ) + 63) / 64 * 64;
+    size_t _size = DATA_OFFSET + slots * _slotBytes;
+    void* _data = MAP_FAILED;
+    if (ftruncate( _fd, _size ) == 0) {
+        _data = mmap( nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+    }
+    ::close( _fd );
+    if (_data == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory: " << name << std::endl;
+        shm_unlink( name.c_str() );
+        return false;
+    }
+
+    name_ = name;
+    size_ = _size;
+    owner_ = true;
+    header_ = new (_data) Header{};
+    header_->version = VERSION;
+    header_->slots = slots;
+    header_->batchSize = batchSize;
+    header_->sequenceLength = sequenceLength;
+    header_->vocabularySize = vocabularySize;
+    header_->slotBytes = _slotBytes;
+    header_->dataOffset = DATA_OFFSET;
+
+    // the magic number goes last, so a consumer never sees a half-written header
+    std::atomic_thread_fence( std::memory_order_release );
+    header_->magic = MAGIC;
+    return true;
+}
+
+/**
+ * Maps the shared memory of a ring created by a producer.
+ *
+ * @param name The name of the shared memory.
+ * @return `true` if the ring was mapped, `false` otherwise.
+ */
+bool BatchRing::attach( const std::string& name ) {
+    close();
+    int _fd = shm_open( name.c_str(), O_RDWR, 0 );
+    if (_fd < 0) {
+        std::cerr << "No batches are being served as " << name << std::endl;
+        return false;
+    }
+
+    struct stat _stat;
+    void* _data = MAP_FAILED;
+    if (fstat( _fd, &_stat ) == 0 && static_cast<size_t>( _stat.st_size ) >= DATA_OFFSET) {
+        _data = mmap( nullptr, _stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+    }
+    ::close( _fd );
+    if (_data == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory: " << name << std::endl;
+        return false;
+    }
+
+    name_ = name;
+    size_ = _stat.st_size;
+    header_ = static_cast<Header*>( _data );
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if (header_->magic != MAGIC || header_->version != VERSION
+            || header_->dataOffset + header_->slots * header_->slotBytes > size_) {
+        std::cerr << "Shared memory is not a batch ring: " << name << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Unmaps the ring; the producer also removes the shared memory, which stays readable by a consumer that has it
+ *  mapped.
+ */
+void BatchRing::close() {
+    if (header_) {
+        munmap( header_, size_ );
+        if (owner_) {
+            shm_unlink( name_.c_str() );
+        }
+    }
+    header_ = nullptr;
+    size_ = 0;
+    owner_ = false;
+}
+
+int32_t* BatchRing::wait_for_slot( uint64_t n ) {
+    while (n >= header_->consumed.load( std::memory_order_acquire ) + header_->slots) {
+        pause();
+    }
+    return slot( n );
+}
+
+void BatchRing::finish() {
+    header_->finished.store( 1, std::memory_order_release );
+    while (header_->consumed.load( std::memory_order_acquire ) < header_->produced.load( std::memory_order_relaxed )) {
+        pause();
+    }
+}
+
+const int32_t* BatchRing::next_batch() {
+    uint64_t _next = header_->consumed.load( std::memory_order_relaxed );
+    while (_next >= header_->produced.load( std::memory_order_acquire )) {
+        if (header_->finished.load( std::memory_order_acquire )
+                && _next >= header_->produced.load( std::memory_order_acquire )) {
+            return nullptr;
+        }
+        pause();
+    }
+    return slot( _next );
+}
+
+void BatchRing::pause() {
+    std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+}
@@ -0,0 +1,432 @@
+#include "Bpe.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+/**
+ * Reads the merges from a file written by write(): one merge per line, its two symbols separated by a space, in the
+ *  order they were learned. Empty lines and lines starting with '#' are skipped.
+ *
+ * @param path The path of the merges file.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool BpeMerges::load( const std::string& path ) {
+    std::ifstream _file{ path };
+    if (!_file) {
+        std::cerr << "Error opening merges file: " << path << std::endl;
+        return false;
+    }
+
+    size_t _lineNumber{0};
+    for (std::string _line; std::getline( _file, _line ); ) {
+        _lineNumber++;
+        if (_line.empty() || _line.starts_with( '#' )) {
+            continue;
+        }
+
+        auto _space = _line.find( ' ' );
+        if (_space == std::string::npos || _space == 0 || _space + 1 == _line.length()) {
+            std::cerr << "Invalid merge on line " << _lineNumber << " of " << path << ": " << _line << std::endl;
+            return false;
+        }
+        add( _line.substr( 0, _space ), _line.substr( _space + 1 ) );
+    }
+    return true;
+}
+
+void BpeMerges::write( std::ostream& os ) const {
+    os << FILE_HEADER << '\n';
+    for (const auto& [_left, _right] : merges_) {
+        os << _left << ' ' << _right << '\n';
+    }
+}
+
+void BpeMerges::add( const std::string& left, const std::string& right ) {
+    ranks_.emplace( left + ' ' + right, merges_.size() );
+    merges_.emplace_back( left, right );
+}
+
+/**
+ * Applies the merges to a line of tokens as written by Part::to_string(). The header, if there is one, is kept as
+ *  it is; each run of tokens between markers is merged as a word.
+ *
+ * @param line The line of tokens.
+ * @return The line with merged tokens.
+ */
+std::string BpeMerges::apply( const std::string& line ) const {
+    if (merges_.empty()) {
+        return line;
+    }
+
+    std::string_view _tokens{ line };
+    std::string _result;
+    if (line.starts_with( Part::SOH + Part::ID )) {
+        auto _eoh = line.find( Part::EOH );
+        size_t _headerLength = (_eoh == std::string::npos) ? line.length() : _eoh + Part::EOH.length();
+        _result = line.substr( 0, _headerLength );
+        _tokens.remove_prefix( _headerLength );
+    }
+
+    std::vector<std::string> _word;
+    auto _append = [&_result]( std::string_view token ) {
+        if (!_result.empty()) {
+            _result += ' ';
+        }
+        _result += token;
+    };
+    auto _flush = [&]() {
+        apply_to_word( _word );
+        for (const std::string& _symbol : _word) {
+            _append( _symbol );
+        }
+        _word.clear();
+    };
+
+    while (!_tokens.empty()) {
+        auto _start = _tokens.find_first_not_of( ' ' );
+        if (_start == std::string_view::npos) {
+            break;
+        }
+        _tokens.remove_prefix( _start );
+        auto _end = std::min( _tokens.find( ' ' ), _tokens.length() );
+        std::string_view _token = _tokens.substr( 0, _end );
+        _tokens.remove_prefix( _end );
+
+        if (is_boundary( _token )) {
+            _flush();
+            _append( _token );
+        }
+        else {
+            _word.emplace_back( _token );
+        }
+    }
+    _flush();
+    return _result;
+}
+
+/**
+ * Merges the symbols of one word: the adjacent pair with the lowest rank is merged everywhere in the word, and this
+ *  is repeated until no adjacent pair has a merge. This applies the merges in the order they were learned.
+ *
+ * @param symbols The symbols of the word, merged in place.
+ */
+void BpeMerges::apply_to_word( std::vector<std::string>& symbols ) const {
+    std::vector<std::string> _merged;
+    while (symbols.size() > 1) {
+        size_t _bestRank{ merges_.size() };
+        for (size_t _i = 0; _i + 1 < symbols.size(); _i++) {
+            auto _it = ranks_.find( symbols[_i] + ' ' + symbols[_i + 1] );
+            if (_it != ranks_.end() && _it->second < _bestRank) {
+                _bestRank = _it->second;
+            }
+        }
+        if (_bestRank == merges_.size()) {
+            return;
+        }
+
+        const auto& [_left, _right] = merges_[_bestRank];
+        _merged.clear();
+        for (size_t _i = 0; _i < symbols.size(); _i++) {
+            if (_i + 1 < symbols.size() && symbols[_i] == _left && symbols[_i + 1] == _right) {
+                _merged.push_back( symbols[_i] + JOIN + symbols[_i + 1] );
+                _i++;
+            }
+            else {
+                _merged.push_back( std::move( symbols[_i] ) );
+            }
+        }
+        symbols.swap( _merged );
+    }
+}
+
+int64_t PairQueue::count( uint64_t pair ) const {
+    auto _it = entries_.find( pair );
+    return (_it == entries_.end()) ? 0 : _it->second.count;
+}
+
+/**
+ * Changes the count of a pair and restores the heap order around it. A pair that is not in the queue is added if
+ *  the change is positive; a pair whose count reaches 0 is removed.
+ *
+ * @param pair The pair key.
+ * @param delta The change in its count.
+ */
+void PairQueue::add( uint64_t pair, int64_t delta ) {
+    auto _it = entries_.find( pair );
+    if (_it == entries_.end()) {
+        if (delta > 0) {
+            entries_.emplace( pair, Entry{ delta, heap_.size() } );
+            heap_.push_back( pair );
+            sift_up( heap_.size() - 1 );
+        }
+        return;
+    }
+
+    _it->second.count += delta;
+    if (_it->second.count <= 0) {
+        remove( _it->second.position );
+    }
+    else if (delta > 0) {
+        sift_up( _it->second.position );
+    }
+    else {
+        sift_down( _it->second.position );
+    }
+}
+
+bool PairQueue::before( uint64_t a, uint64_t b ) const {
+    int64_t _countA = entries_.at( a ).count;
+    int64_t _countB = entries_.at( b ).count;
+    return (_countA != _countB) ? _countA > _countB : a < b;
+}
+
+void PairQueue::swap( size_t i, size_t j ) {
+    std::swap( heap_[i], heap_[j] );
+    entries_[heap_[i]].position = i;
+    entries_[heap_[j]].position = j;
+}
+
+void PairQueue::sift_up( size_t i ) {
+    while (i > 0 && before( heap_[i], heap_[(i - 1) / 2] )) {
+        swap( i, (i - 1) / 2 );
+        i = (i - 1) / 2;
+    }
+}
+
+void PairQueue::sift_down( size_t i ) {
+    while (true) {
+        size_t _first{ i };
+        for (size_t _child : { 2 * i + 1, 2 * i + 2 }) {
+            if (_child < heap_.size() && before( heap_[_child], heap_[_first] )) {
+                _first = _child;
+            }
+        }
+        if (_first == i) {
+            return;
+        }
+        swap( i, _first );
+        i = _first;
+    }
+}
+
+void PairQueue::remove( size_t i ) {
+    uint64_t _pair = heap_[i];
+    swap( i, heap_.size() - 1 );
+    heap_.pop_back();
+    entries_.erase( _pair );
+    if (i < heap_.size()) {
+        sift_up( i );
+        sift_down( i );
+    }
+}
+
+/**
+ * Splits a line of tokens into words, the runs of tokens between markers, and counts each word. A header at the
+ *  start of the line is skipped.
+ *
+ * @param line The line of tokens.
+ * @param counts The counts to add the words to.
+ */
+void BpeTrainer::count_words( std::string_view line, WordCounts& counts ) {
+    if (line.starts_with( Part::SOH + Part::ID )) {
+        auto _eoh = line.find( Part::EOH );
+        line.remove_prefix( (_eoh == std::string_view::npos) ? line.length() : _eoh + Part::EOH.length() );
+    }
+
+    std::string _word;
+    while (!line.empty()) {
+        auto _start = line.find_first_not_of( ' ' );
+        if (_start == std::string_view::npos) {
+            break;
+        }
+        line.remove_prefix( _start );
+        auto _end = std::min( line.find( ' ' ), line.length() );
+        std::string_view _token = line.substr( 0, _end );
+        line.remove_prefix( _end );
+
+        if (BpeMerges::is_boundary( _token )) {
+            if (!_word.empty()) {
+                counts[_word]++;
+                _word.clear();
+            }
+        }
+        else {
+            if (!_word.empty()) {
+                _word += ' ';
+            }
+            _word += _token;
+        }
+    }
+    if (!_word.empty()) {
+        counts[_word]++;
+    }
+}
+
+/**
+ * Adds counted words to the training set. The words are added in sorted order, so that symbol ids, and with them
+ *  the order in which tied pairs are merged, do not depend on how the counting was split between threads.
+ *
+ * @param counts The words and their counts.
+ */
+void BpeTrainer::add_words( const WordCounts& counts ) {
+    std::vector<const WordCounts::value_type*> _sorted;
+    _sorted.reserve( counts.size() );
+    for (const auto& _entry : counts) {
+        _sorted.push_back( &_entry );
+    }
+    std::sort( _sorted.begin(), _sorted.end(), []( auto a, auto b ) { return a->first < b->first; } );
+
+    for (const auto* _entry : _sorted) {
+        Word _word;
+        _word.count = _entry->second;
+        std::string_view _tokens{ _entry->first };
+        while (!_tokens.empty()) {
+            auto _end = std::min( _tokens.find( ' ' ), _tokens.length() );
+            _word.symbols.push_back( intern( std::string{ _tokens.substr( 0, _end ) } ) );
+            _tokens.remove_prefix( std::min( _end + 1, _tokens.length() ) );
+        }
+        tokensBefore_ += _word.count * _word.symbols.size();
+        words_.push_back( std::move( _word ) );
+    }
+    tokensAfter_ = tokensBefore_;
+}
+
+/**
+ * Learns merges: the most frequent adjacent pair of symbols is merged into a new symbol, the counts of the pairs
+ *  around each merged occurrence are updated in the queue, and this is repeated until enough merges have been
+ *  learned or no pair occurs often enough.
+ *
+ * @param pool The pool to count the pairs on.
+ * @return The merges, in the order they were learned.
+ */
+BpeMerges BpeTrainer::train( ThreadPool& pool ) {
+    count_pairs( pool );
+
+    BpeMerges _merges;
+    while (_merges.size() < options_.merges && !queue_.empty()) {
+        uint64_t _pair = queue_.top();
+        if (queue_.count( _pair ) < static_cast<int64_t>( options_.minCount )) {
+            break;
+        }
+
+        std::string _left = symbols_[_pair >> 32];
+        std::string _right = symbols_[_pair & 0xffffffff];
+        _merges.add( _left, _right );
+        merge( _pair, intern( _left + BpeMerges::JOIN + _right ) );
+    }
+
+    tokensAfter_ = 0;
+    for (const Word& _word : words_) {
+        tokensAfter_ += _word.count * _word.symbols.size();
+    }
+    return _merges;
+}
+
+uint32_t BpeTrainer::intern( const std::string& symbol ) {
+    auto [_it, _inserted] = symbolIds_.emplace( symbol, static_cast<uint32_t>( symbols_.size() ) );
+    if (_inserted) {
+        symbols_.push_back( symbol );
+    }
+    return _it->second;
+}
+
+/**
+ * Counts every adjacent pair of symbols, weighted by the count of its word, and records which words each pair occurs
+ *  in. The words are split into one contiguous range per thread and the partial counts are merged in order.
+ *
+ * @param pool The pool to count on.
+ */
+void BpeTrainer::count_pairs( ThreadPool& pool ) {
+    struct PartialCounts {
+        std::unordered_map<uint64_t, int64_t> counts;
+        std::unordered_map<uint64_t, std::vector<size_t>> words;
+    };
+
+    auto _partials = pool.map_ranges( words_.size(), [this]( size_t first, size_t last ) {
+        PartialCounts _partial;
+        for (size_t _w = first; _w < last; _w++) {
+            const Word& _word = words_[_w];
+            for (size_t _i = 0; _i + 1 < _word.symbols.size(); _i++) {
+                uint64_t _key = pair_key( _word.symbols[_i], _word.symbols[_i + 1] );
+                _partial.counts[_key] += _word.count;
+                auto& _words = _partial.words[_key];
+                if (_words.empty() || _words.back() != _w) {
+                    _words.push_back( _w );
+                }
+            }
+        }
+        return _partial;
+    } );
+
+    for (PartialCounts& _partial : _partials) {
+        for (const auto& [_key, _count] : _partial.counts) {
+            queue_.add( _key, _count );
+        }
+        for (auto& [_key, _words] : _partial.words) {
+            auto& _all = pairWords_[_key];
+            _all.insert( _all.end(), _words.begin(), _words.end() );
+        }
+    }
+}
+
+/**
+ * Replaces every occurrence of a pair with its merged symbol, in the words the pair occurs in. The counts of the
+ *  pairs that disappear and appear in those words are changed in the queue; nothing else is recounted.
+ *
+ * @param pair The pair to merge.
+ * @param merged The id of the merged symbol.
+ */
+void BpeTrainer::merge( uint64_t pair, uint32_t merged ) {
+    uint32_t _left = pair >> 32;
+    uint32_t _right = pair & 0xffffffff;
+
+    std::vector<size_t> _words;
+    if (auto _it = pairWords_.find( pair ); _it != pairWords_.end()) {
+        _words = std::move( _it->second );
+        pairWords_.erase( _it );
+    }
+    std::sort( _words.begin(), _words.end() );
+    _words.erase( std::unique( _words.begin(), _words.end() ), _words.end() );
+
+    std::unordered_map<uint64_t, int64_t> _deltas;
+    std::vector<uint32_t> _symbols;
+    for (size_t _w : _words) {
+        Word& _word = words_[_w];
+        _symbols.clear();
+        for (size_t _i = 0; _i < _word.symbols.size(); _i++) {
+            if (_i + 1 < _word.symbols.size() && _word.symbols[_i] == _left && _word.symbols[_i + 1] == _right) {
+                _symbols.push_back( merged );
+                _i++;
+            }
+            else {
+                _symbols.push_back( _word.symbols[_i] );
+            }
+        }
+        if (_symbols.size() == _word.symbols.size()) {
+            continue;
+        }
+
+        int64_t _count = static_cast<int64_t>( _word.count );
+        for (size_t _i = 0; _i + 1 < _word.symbols.size(); _i++) {
+            _deltas[pair_key( _word.symbols[_i], _word.symbols[_i + 1] )] -= _count;
+        }
+        for (size_t _i = 0; _i + 1 < _symbols.size(); _i++) {
+            uint64_t _key = pair_key( _symbols[_i], _symbols[_i + 1] );
+            _deltas[_key] += _count;
+            if (_symbols[_i] == merged || _symbols[_i + 1] == merged) {
+                pairWords_[_key].push_back( _w );
+            }
+        }
+        _word.symbols.swap( _symbols );
+    }
+
+    for (const auto& [_key, _delta] : _deltas) {
+        if (_delta != 0) {
+            queue_.add( _key, _delta );
+        }
+    }
+    // every occurrence has been merged; drop anything left of the pair
+    queue_.add( pair, -queue_.count( pair ) );
+}
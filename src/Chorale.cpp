@@ -1,9 +1,12 @@
 #include "Arguments.h"
 #include "Chorale.h"
 #include "CombinedPart.h"
+#include "GzipStream.h"
+#include "MxlContainer.h"
 
 #include <cmath>
 #include <curl/curl.h>
+#include <fstream>
 #include <iostream>
 #include <ranges>
 #include <sstream>
@@ -38,9 +41,10 @@ std::string Chorale::get_title_from_xml() {
 /**
  * Loads the XML data from the specified source, either a file or a URL.
  * 
- * This function first determines the type of the XML source (file or URL) using the `Arguments::get_input_source_type` 
- *  function.
- * It then calls the appropriate function (`load_xml_from_file` or `load_xml_from_url`) to load the XML data.
+ * This function first determines the type of the XML source (file, compressed file, URL or MIDI file) using the
+ *  `Arguments::get_input_source_type` function.
+ * It then calls the appropriate function (`load_xml_from_file`, `load_xml_from_mxl_file` or `load_xml_from_url`) to load
+ *  the XML data, or reads the MIDI file into `midi_`.
  * If the XML data is successfully loaded, the title of the chorale is extracted using the `get_title_from_xml` 
  *  function and stored in the `title_` member variable.
  *
@@ -55,13 +59,19 @@ bool Chorale::load_xml() {
         case Arguments::URL:
             isXmlLoaded_ = load_xml_from_url( xmlSource_ );
             break;
+        case Arguments::MXL:
+            isXmlLoaded_ = load_xml_from_mxl_file( xmlSource_ );
+            break;
+        case Arguments::MIDI:
+            isXmlLoaded_ = isMidi_ = midi_.open( xmlSource_ );
+            break;
         default:
             std::cerr << "Invalid xml source type: " << xmlSource_ << std::endl;
             break;
     }
 
     if (isXmlLoaded_) {
-        title_ = get_title_from_xml();
+        title_ = isMidi_ ? midi_.get_title() : get_title_from_xml();
     }
     return isXmlLoaded_;
 }
@@ -70,20 +80,54 @@ bool Chorale::load_xml() {
  * Loads the XML data from the specified file.
  *
  * This function uses the `XmlUtils::load_from_file` function to load the XML data
- * from the specified file path into the `doc_` member variable.
+ * from the specified file path into the `doc_` member variable. A file whose name ends in ".gz" is
+ * decompressed in memory and parsed with `XmlUtils::load_from_buffer`.
  *
  * @param xmlSource The file path of the XML source to load.
  * @return `true` if the XML data was successfully loaded, `false` otherwise.
  */
 bool Chorale::load_xml_from_file( const std::string& xmlSource ) { 
+    if (GzipStream::is_compressed( xmlSource )) {
+        std::string _xml;
+        return GzipStream::read_file( xmlSource, _xml ) && XmlUtils::load_from_buffer( doc_, _xml.c_str() );
+    }
     return XmlUtils::load_from_file( doc_, xmlSource.c_str() );
 }
 
+/**
+ * Loads the XML data from the specified compressed MusicXML (.mxl) file.
+ *
+ * The archive is read into memory and passed to `load_xml_from_mxl`.
+ *
+ * @param xmlSource The file path of the .mxl archive to load.
+ * @return `true` if the XML data was successfully loaded, `false` otherwise.
+ */
+bool Chorale::load_xml_from_mxl_file( const std::string& xmlSource ) {
+    std::ifstream _file{ xmlSource, std::ios::binary };
+    if (!_file) {
+        std::cerr << "Error opening file: " << xmlSource << std::endl;
+        return false;
+    }
+    std::string _archive{ std::istreambuf_iterator<char>{ _file }, std::istreambuf_iterator<char>{} };
+    return load_xml_from_mxl( _archive );
+}
+
+Chorale::CurlGlobal::CurlGlobal() {
+    if (curl_global_init( CURL_GLOBAL_DEFAULT ) != CURLE_OK) {
+        std::cerr << "Failed to initialize libcurl" << std::endl;
+    }
+}
+
+Chorale::CurlGlobal::~CurlGlobal() {
+    curl_global_cleanup();
+}
+
 /**
  * Loads the XML data from the specified URL.
  *
  * This function uses the cURL library to download the XML data from the specified URL and stores it in a buffer.
- * It then passes the buffer to the `XmlUtils::load_from_buffer` function to parse the XML data and store it in the 
+ * If the buffer holds a compressed MusicXML (.mxl) archive, it is passed to `load_xml_from_mxl`; otherwise
+ *  it is passed to the `XmlUtils::load_from_buffer` function to parse the XML data and store it in the 
  *  `doc_` member variable.
  *
  * @param xmlSource The URL of the XML source to load.
@@ -105,9 +149,26 @@ bool Chorale::load_xml_from_url( const std::string& xmlSource ) {
         return false;
     }
         
+    if (MxlContainer::is_container( buffer )) {
+        return load_xml_from_mxl( buffer );
+    }
     return XmlUtils::load_from_buffer( doc_, buffer.c_str() );
 }
 
+/**
+ * Loads the XML data from a compressed MusicXML (.mxl) archive held in memory.
+ *
+ * The root score named by the archive's META-INF/container.xml is inflated into a buffer and passed to the
+ *  `XmlUtils::load_from_buffer` function; nothing is written to disk.
+ *
+ * @param archive The bytes of the .mxl archive.
+ * @return `true` if the XML data was successfully loaded, `false` otherwise.
+ */
+bool Chorale::load_xml_from_mxl( const std::string& archive ) {
+    std::string _xml;
+    return MxlContainer::extract_score( archive, _xml ) && XmlUtils::load_from_buffer( doc_, _xml.c_str() );
+}
+
 /**
  * Callback function used by the cURL library to handle the response data.
  *
@@ -254,7 +315,9 @@ tinyxml2::XMLElement* Chorale::get_part_xml( const std::string& partName ) const
             // If four parts, assume non-standard part names
 
             // Get the name of the part in the appropriate position
-            std::string _assumedPartId{partIdList_[partNameIndices_[partName]]};
+            // (a name without a standard position takes the first; the map is only read, so lookups may run concurrently)
+            auto _index = partNameIndices_.find( partName );
+            std::string _assumedPartId{partIdList_[(_index != partNameIndices_.end()) ? _index->second : 0]};
             std::string _newPartName{partIds_.find(_assumedPartId)->second};
             std::cout << "Using part name " << _newPartName << " instead of " << partName 
                 << " in " << bwv_ << std::endl;
@@ -264,6 +327,32 @@ tinyxml2::XMLElement* Chorale::get_part_xml( const std::string& partName ) const
     return (it != partXmls_.end()) ? it->second : nullptr;
 }
 
+/**
+ * Retrieves the MIDI voice for the specified part name: the voice whose track has that name or, as in
+ *  get_part_xml(), the voice in the part's standard position if there are four voices.
+ *
+ * @param partName The name of the part to retrieve.
+ * @return The voice for the specified part, or `nullptr` if the part could not be found.
+ */
+const MidiFile::Voice* Chorale::get_midi_voice( const std::string& partName ) const {
+    const auto& _voices = midi_.get_voices();
+    for (const auto& _voice : _voices) {
+        if (_voice.name == partName) {
+            return &_voice;
+        }
+    }
+
+    auto _index = partNameIndices_.find( partName );
+    if (_voices.size() == 4 && _index != partNameIndices_.end()) {
+        const MidiFile::Voice& _voice = _voices[_index->second];
+        std::cout << "Using part name " << _voice.name << " instead of " << partName << " in " << bwv_ << std::endl;
+        return &_voice;
+    }
+
+    std::cerr << "Part " << partName << " not found in MIDI file for " << bwv_ << std::endl;
+    return nullptr;
+}
+
 /**
  * Builds the BWV (Bach-Werke-Verzeichnis) identifier for a given XML source.
  *
@@ -338,10 +427,27 @@ void Chorale::load_parts( std::vector<std::unique_ptr<Part>>& parts ) {
  *  parsing the XML for each part, transposing the part to C major or A minor, and normalizing the meter so that 
  *  each part contains the same number of sub-beats.
  *
+ * The parts are independent of each other, so if a pool is given, each part is encoded as a separate task on it and
+ *  the chorale takes about as long as its longest part. The XML element for every part is looked up before any
+ *  task starts, since the lookup may print a message.
+ *
+ * Once all parts are encoded, they are put on a common grid: MIN_SUBBEATS sub-beats per beat, or the grid chosen
+ *  by the given RhythmGrid.
+ *
+ * A chorale read from a MIDI file is encoded by `encode_midi_parts` instead.
+ *
+ * @param pool The thread pool to encode the parts on, or nullptr to encode them one after another.
+ * @param grid The grid to put the parts on, or nullptr for MIN_SUBBEATS.
+ * @param verbose If true, a rescaling to MIN_SUBBEATS that rounds a duration is reported.
  * @return true if the encoding was successful, false otherwise.
  */
-bool Chorale::encode_parts()
+bool Chorale::encode_parts( ThreadPool* pool, RhythmGrid* grid, bool verbose )
 {
+    // a MIDI file has no xml; its parts come from its voices
+    if (isMidi_) {
+        return encode_midi_parts( grid, verbose );
+    }
+
     // map part ids to part names
     if (partIds_.empty()) {
         if (!load_part_ids()) {
@@ -358,23 +464,101 @@ bool Chorale::encode_parts()
         }
     }  
 
+    // encode the parts one after another
+    if (!pool || parts_.size() < 2) {
+        for (auto& _it : parts_) {
+            if (!encode_part( *_it.second, get_part_xml( _it.first ) )) {
+                std::cerr << "Failed to parse part: " << _it.first << " for " << bwv_ << std::endl;
+                return false;
+            }
+        }
+        return normalize_meter( grid, verbose );
+    }
+
+    // or encode each part as a separate task, and wait for all of them
+    std::vector<std::pair<std::string, std::future<bool>>> _tasks;
     for (auto& _it : parts_) {
-        // retrieve xml for this part
-        auto& _part = _it.second;
-
-        // encode it 
-        if (_part->parse_xml( get_part_xml( _it.first ) )) {
-            // transpose it to C major or A minor
-            _part->transpose();
-            // normalize the meter, so that each part contains the same number of sub-beats
-            _part->set_sub_beats( MIN_SUBBEATS );
+        Part* _part = _it.second.get();
+        tinyxml2::XMLElement* _partXml = get_part_xml( _it.first );
+        _tasks.emplace_back( _it.first, pool->submit( [_part, _partXml] { 
+            return encode_part( *_part, _partXml ); 
+        } ) );
+    }
+
+    bool _success{true};
+    for (auto& _task : _tasks) {
+        if (!_task.second.get()) {
+            std::cerr << "Failed to parse part: " << _task.first << " for " << bwv_ << std::endl;
+            _success = false;
         }
-        else {
+    }
+    return _success && normalize_meter( grid, verbose );
+}
+
+/**
+ * Encodes the parts of a chorale read from a MIDI file: parses the voice of each part and transposes it to C major or
+ *  A minor, then puts the parts on a common grid like encode_parts(). Reading MIDI is cheap, so the parts are
+ *  encoded one after another.
+ *
+ * @param grid The grid to put the parts on, or nullptr for MIN_SUBBEATS.
+ * @param verbose If true, a rescaling to MIN_SUBBEATS that rounds a duration is reported.
+ * @return true if the encoding was successful, false otherwise.
+ */
+bool Chorale::encode_midi_parts( RhythmGrid* grid, bool verbose ) {
+    for (auto& _it : parts_) {
+        const MidiFile::Voice* _voice = get_midi_voice( _it.first );
+        if (!_voice || !_it.second->parse_midi( midi_, *_voice )) {
             std::cerr << "Failed to parse part: " << _it.first << " for " << bwv_ << std::endl;
             return false;
         }
+        _it.second->transpose();
     }
+    return normalize_meter( grid, verbose );
+}
 
+/**
+ * Puts the encoded parts on a common grid, so that each part contains the same number of sub-beats per beat.
+ *  Without a RhythmGrid every part is rescaled to MIN_SUBBEATS, even if that rounds some durations (as it always
+ *  has, so the rounding is only reported if verbose); a RhythmGrid chooses the grid itself, and refuses one that
+ *  would round.
+ *
+ * @param grid The grid to put the parts on, or nullptr for MIN_SUBBEATS.
+ * @param verbose If true, a part whose rescaling to MIN_SUBBEATS rounds a duration is reported.
+ * @return true if the parts are on a common grid, false otherwise.
+ */
+bool Chorale::normalize_meter( RhythmGrid* grid, bool verbose ) {
+    if (!grid) {
+        for (auto& _it : parts_) {
+            _it.second->set_sub_beats( MIN_SUBBEATS, verbose );
+        }
+        return true;
+    }
+
+    std::vector<Part*> _parts;
+    for (auto& _it : parts_) {
+        _parts.push_back( _it.second.get() );
+    }
+    return grid->apply( _parts, MIN_SUBBEATS );
+}
+
+/**
+ * Encodes a single part: parses its XML and transposes it to C major or A minor. The meter is normalized once all
+ *  parts are encoded.
+ *
+ * Only the part and its own XML element are touched, so different parts can be encoded at the same time.
+ *
+ * @param part The Part object to encode into.
+ * @param partXml The XML element of the part.
+ * @return true if the part was parsed, false otherwise.
+ */
+bool Chorale::encode_part( Part& part, tinyxml2::XMLElement* partXml ) {
+    // encode it 
+    if (!part.parse_xml( partXml )) {
+        return false;
+    }
+
+    // transpose it to C major or A minor
+    part.transpose();
     return true;
 }
 
@@ -392,12 +576,17 @@ std::unique_ptr<Part>& Chorale::get_part(const std::string& partName) {
 /**
  * Combines the individual parts (Soprano, Alto, Tenor, Bass) into a single CombinedPart object.
  *
+ * @param partsToParse The names of the parts to combine, in voice order.
  * @param verbose If true, the function will print additional information during the build process.
  * @return True if the combined part was successfully built, false otherwise.
  */
 bool Chorale::combine_parts( std::vector<std::string> partsToParse, bool verbose ) {
     std::vector<std::unique_ptr<Part>> _parts;
     for (auto& _partName : partsToParse) {
+        if (!get_part( _partName )) {
+            std::cerr << "Part " << _partName << " not found for " << bwv_ << std::endl;
+            return false;
+        }
         _parts.push_back( std::move( get_part( _partName ) ) );
     }
 
@@ -1,33 +1,78 @@
  #include "CombinedPart.h"
 
+#include <climits>
+#include <numeric>
+
+/**
+ * Lays out the encodings of a part on an absolute tick timeline.
+ *
+ * Each note is copied once, with its duration scaled to the common grid, and each marker is reduced to its marker
+ *  type, so that merging the voices needs neither virtual calls nor changes to the source part.
+ *
+ * @param part The part to lay out.
+ * @param scale The factor by which to multiply durations to reach the common grid.
+ */
+VoiceTimeline::VoiceTimeline( const Part& part, size_t scale ) : partName{part.get_part_name()} {
+    size_t _tick{0};
+    events.reserve( part.get_encodings().size() );
+
+    for (const auto& _encoding : part.get_encodings()) {
+        if (_encoding->is_marker()) {
+            int _markerType = static_cast<const Marker&>( *_encoding ).get_marker_type();
+            events.push_back( Event{ _tick, _tick, _markerType, Note{} } );
+        }
+        else if (_encoding->is_note()) {
+            Note _note{ static_cast<const Note&>( *_encoding ) };
+            _note.set_duration( _note.get_duration() * scale );
+            size_t _onset{ _tick };
+            _tick += _note.get_duration();
+            events.push_back( Event{ _onset, _tick, NO_MARKER, std::move( _note ) } );
+        }
+    }
+}
+
 CombinedPart::CombinedPart( const std::vector<std::unique_ptr<Part>>& parts ) : Part(
         parts[0]->get_id(), parts[0]->get_title(), "Combined" ) {
 
-    // make copies of the parts, so we can pop encodings as we process them
+    // voices may use different grids; merge them on the smallest grid that fits all of them
+    size_t _subBeats{1};
     for (const auto& part : parts) {
-        parts_.emplace_back( std::make_unique<PartWrapper>( *part ) );
+        _subBeats = std::lcm( _subBeats, static_cast<size_t>( part->get_sub_beats() ) );
     }
 
+    // lay out each voice on the common grid; the source parts are not modified
+    for (const auto& part : parts) {
+        voices_.emplace_back( *part, _subBeats / part->get_sub_beats() );
+    }
+    cursors_.assign( voices_.size(), 0 );
+    sliced_.assign( voices_.size(), false );
+
     beatsPerMeasure_ = parts[0]->get_beats_per_measure();
-    subBeatsPerBeat_ = parts[0]->get_sub_beats();
+    subBeatsPerBeat_ = _subBeats;
     key_ = parts[0]->get_key();
     mode_ = parts[0]->get_mode();
 }
 
 /**
- * Prints the current measure and the current tokens for each part in the CombinedPart.
+ * Prints the current measure and the current event for each voice in the CombinedPart.
  * @param os The output stream to write the information to.
  * @return The output stream after writing the information.
  */
 std::ostream& CombinedPart::show_current_tokens( std::ostream& os ) const {
     os << "Current measure: " << currentMeasure_  << "." <<  nextTick_ << std::endl;
-    for (auto& _part : parts_) {
-        os << _part->part_name()  << ": ";
-        if (_part->currentToken) {
-            os << _part->currentToken->to_string();
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        os << voices_[_v].partName  << ": ";
+        if (cursors_[_v] < voices_[_v].events.size()) {
+            const auto& _event = voices_[_v].events[cursors_[_v]];
+            if (_event.markerType == VoiceTimeline::NO_MARKER) {
+                os << _event.note.to_string();
+            }
+            else {
+                os << Marker{ static_cast<Marker::MarkerType>( _event.markerType ) }.to_string();
+            }
         }
         else {
-            os << "<NULL>"; 
+            os << "<NULL>";
         }
         os << std::endl;
     }
@@ -36,41 +81,32 @@ std::ostream& CombinedPart::show_current_tokens( std::ostream& os ) const {
 }
 
 /**
- * Retrieves the next set of tokens from the parts in the CombinedPart, ensuring that the tokens are compatible.
- * 
- * This function checks if any of the parts needs a new token, and if so, retrieves the next token for that part.
- * It then checks if all the tokens are compatible across the parts.
- * If any part is missing a token or has an incompatible token, an error message is printed to std::cerr and the 
+ * Checks that every voice has a current event and that the events are compatible across the voices: either all
+ *  notes and rests, or all the same marker.
+ * If any voice has run out of events or has an incompatible event, an error message is printed to std::cerr and the
  *  function returns false.
- * Otherwise, the function returns true, indicating that the next set of compatible tokens has been retrieved.
  *
- * @return true if the next set of compatible tokens has been retrieved, false otherwise.
+ * @return true if the current events are compatible, false otherwise.
  */
-bool CombinedPart::get_next_tokens() {
+bool CombinedPart::check_current_events() const {
     std::string _missingTokenPart{};
     std::string _incompatibleTokenPart{};
 
-    // pop next token if needed
-    Encoding* _topVoice = nullptr; // save top voice for compatibility check
-
-    for (auto& _part : parts_) {
-        if (_part->needNewToken) {
-            if (_part->get_next_token()) {
-                // don't need a new token unless this is a marker
-                _part->needNewToken = _part->currentToken->is_marker();
-            }
-            else { 
-                // if we have exhausted the tokens for this part, we have a problem
-                _missingTokenPart = _part->part_name();  
-            }
+    const VoiceTimeline::Event* _topVoice = nullptr; // save top voice for compatibility check
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        if (cursors_[_v] >= voices_[_v].events.size()) {
+            // if we have exhausted the events for this voice, we have a problem
+            _missingTokenPart = voices_[_v].partName;
+            continue;
         }
-        // check if we have an inconsistency
-        // equality means tokens are compatible (not identical)
+
+        // markers must match exactly; notes and rests are compatible with each other
+        const auto& _event = voices_[_v].events[cursors_[_v]];
         if (!_topVoice) {
-            _topVoice = _part->currentToken.get();
+            _topVoice = &_event;
         }
-        else if (*_topVoice != *_part->currentToken) {
-            _incompatibleTokenPart = _part->part_name();
+        else if (_topVoice->markerType != _event.markerType) {
+            _incompatibleTokenPart = voices_[_v].partName;
         }
     }
 
@@ -88,97 +124,88 @@ bool CombinedPart::get_next_tokens() {
 }
 
 /**
- * Reduces the duration of a note by the specified amount.
- *
- * If the remaining duration is less than or equal to 0, the function returns true, indicating that a new note is needed.
- * Otherwise, the note's duration is updated and the function returns false, indicating that the note is tied to 
- *  the next one.
+ * Adds the marker that every voice is currently at to the encoding stack, and advances every voice past it.
  *
- * @param note The note to have its duration reduced.
- * @param reduction The amount to reduce the note's duration by.
- * @return True if a new note is needed, false if the note is tied to the next one.
+ * @param verbose If true, prints information about the added marker to the console.
+ * @return True if the processed marker is an EOC (End of Chorale) marker, false otherwise.
  */
-bool CombinedPart::reduce_duration(Note& note, const unsigned int reduction) {
-    // calcuate number of sub-beats left
-    int _newDuration = note.get_duration();
-    _newDuration -= reduction;
-
-    // if we are done with this note, get another next time
-    if (_newDuration <= 0) {
-        return true;
-    }
-    // otherwise next note is tied to this one
-    else {
-        note.set_duration( _newDuration );
-        note.set_tied( true );
-        return false;
+bool CombinedPart::process_marker( bool verbose ) {
+    auto _markerType = static_cast<Marker::MarkerType>( voices_[0].events[cursors_[0]].markerType );
+    std::unique_ptr<Encoding> _token = std::make_unique<Marker>( _markerType );
+    push_encoding( _token );
+
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        cursors_[_v]++;
+        sliced_[_v] = false;
     }
-};
 
-/**
- * Processes a marker token, adding it to the encoding stack 
- *
- * @param token The marker token to process.
- * @param verbose If true, prints information about the added marker to the console.
- * @return True if the processed marker is an EOC (End of Chord) marker, false otherwise.
- */
-bool CombinedPart::process_marker( std::unique_ptr<Encoding>& token, bool verbose  ) {
-    push_encoding( token );
     if (verbose) {
-        std::cout << "Added marker: " 
-            << location_to_string( get_last_encoding().get() ) 
-            << ": " << get_last_encoding()->to_string() << std::endl;  
-    } 
-    return get_last_encoding()->is_EOC();
+        std::cout << "Added marker: "
+            << location_to_string( get_last_encoding().get() )
+            << ": " << get_last_encoding()->to_string() << std::endl;
+    }
+    return _markerType == Marker::MarkerType::EOC;
 }
 
 /**
- * Adds a chord to the combined parts by finding the shortest duration among the notes, reducing each note's duration
- * to match the shortest, creating a new Chord object with the reduced notes, and pushing it onto the encoding stack.
+ * Adds a chord to the combined parts. The chord starts at the current tick and ends at the earliest end among the
+ *  voices' current notes (the next onset in any voice). A voice's note is marked tied if it was tied in the source
+ *  or if it already sounded in an earlier chord. Voices whose note ends with the chord move on to their next event.
  * If the verbose flag is set, it will also print information about the added chord to the console.
  *
  * @param verbose If true, prints information about the added chord to the console.
  */
 void CombinedPart::add_chord( bool verbose ) {
-    // find the shortest duration
-    unsigned int _shortestDuration = UINT_MAX;
-    for ( auto& _part : parts_ ) {
-        _shortestDuration = std::min( _shortestDuration, _part->currentToken->get_duration() );
-    } 
+    // find the next onset in any voice
+    size_t _end{ SIZE_MAX };
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        _end = std::min( _end, voices_[_v].events[cursors_[_v]].end );
+    }
+    unsigned int _duration = _end - currentTick_;
 
-    // reduce each note's duration to match shortest and save it in a vector
+    // slice each voice's note at that onset
     std::vector<Note> _notes;
-    for ( auto& _part : parts_ ) {
-        Note& _note = dynamic_cast<Note&>( *_part->currentToken );
-        _notes.emplace_back( _note );
-        _part->needNewToken = reduce_duration( _note, _shortestDuration );
+    _notes.reserve( voices_.size() );
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        const auto& _event = voices_[_v].events[cursors_[_v]];
+        const Note& _note = _event.note;
+        _notes.emplace_back( _note.get_pitch(), _note.get_octave(), _duration, _note.get_accidental(),
+            _note.get_tied() || sliced_[_v] );
+
+        if (_event.end == _end) {
+            cursors_[_v]++;
+            sliced_[_v] = false;
+        }
+        else {
+            sliced_[_v] = true;
+        }
     }
-    
+    currentTick_ = _end;
+
     // build the chord and add it to the encoding stack
-    auto chord = std::make_unique<Chord>( _notes, _shortestDuration );
-    auto encoding = std::unique_ptr<Encoding>( chord.release() );
-    push_encoding( encoding );
+    std::unique_ptr<Encoding> _encoding = std::make_unique<Chord>( std::move( _notes ), _duration );
+    push_encoding( _encoding );
 
     if (verbose) {
-        std::cout << "Added chord " 
-            << location_to_string( get_last_encoding().get() ) 
+        std::cout << "Added chord "
+            << location_to_string( get_last_encoding().get() )
             << ":  " << get_last_encoding()->to_string() << std::endl;
     }
 }
 
 
 /**
- * Builds the combined parts by iteratively processing tokens from the individual parts. 
- *  If a Note or Rest is encountered, it builds a chord and adds it to the combined parts.
+ * Builds the combined parts by merging the voices' timelines in onset order.
+ *  Markers must line up across the voices; between markers, a new chord starts whenever any voice starts a new
+ *  note or rest.
  *
  * @param verbose If true, prints information about the added markers and chords to the console.
- * @return true if an EOC (End of Chord) marker is encountered, false otherwise.
+ * @return true if an EOC (End of Chorale) marker is encountered, false otherwise.
  */
-bool CombinedPart::build( bool verbose )  {           
+bool CombinedPart::build( bool verbose )  {
 
     while (true) {
-        // get new tokens if necessary
-        if (!get_next_tokens()) {
+        if (!check_current_events()) {
 
             // we encountered some inconcistency
             // print out the current tokens and return false
@@ -187,11 +214,11 @@ bool CombinedPart::build( bool verbose )  {
         }
 
         // if we have a Marker, add it to the combined parts
-        if (parts_[0]->currentToken->is_marker() ) {
-            if (process_marker( parts_[0]->currentToken, verbose )) {
+        if (voices_[0].events[cursors_[0]].markerType != VoiceTimeline::NO_MARKER) {
+            if (process_marker( verbose )) {
                 // if return is true, marker is an EOC and we are done
                 return true;
-            }  
+            }
         }
 
         // if we have a Note or Rest, build a chord and add it to combined parts
@@ -199,4 +226,4 @@ bool CombinedPart::build( bool verbose )  {
             add_chord( verbose );
          }
     }
-}
\ No newline at end of file
+}
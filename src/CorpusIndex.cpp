@@ -0,0 +1,267 @@
+#include "CorpusIndex.h"
+
+#include <cctype>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Opens the index file and writes the column header.
+ *
+ * @param indexPath The path of the index file to create.
+ * @return `true` if the index file was opened, `false` otherwise.
+ */
+bool CorpusIndexWriter::open( const std::string& indexPath ) {
+    indexFile_.open( indexPath, std::ios::out );
+    if (!indexFile_) {
+        std::cerr << "Failed to open index file: " << indexPath << std::endl;
+        return false;
+    }
+    indexFile_ << COLUMNS << '\n';
+    return true;
+}
+
+/**
+ * Closes the index file, so that a failure to write what was still buffered is seen.
+ *
+ * @return `true` if the index was written (or was not open), `false` otherwise.
+ */
+bool CorpusIndexWriter::close() {
+    if (!indexFile_.is_open()) {
+        return true;
+    }
+    indexFile_.close();
+    if (!indexFile_) {
+        std::cerr << "Failed to write index file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes one entry to the index as a tab-separated line.
+ *
+ * @param entry The entry describing a line of the corpus.
+ */
+void CorpusIndexWriter::add_entry( const IndexEntry& entry ) {
+    indexFile_ << entry.offset
+        << '\t' << entry.length
+        << '\t' << entry.tokenCount
+        << '\t' << entry.id
+        << '\t' << entry.partName
+        << '\t' << entry.key
+        << '\t' << entry.beatsPerMeasure
+        << '\t' << entry.subBeatsPerBeat
+        << '\n';
+}
+
+/**
+ * Builds an index entry from a Part and the line that was written for it, and writes it to the index.
+ *
+ * @param part The Part that was written to the corpus.
+ * @param offset The byte offset at which the line starts.
+ * @param line The line written to the corpus, without its newline.
+ */
+void CorpusIndexWriter::add_entry( const Part& part, size_t offset, const std::string& line ) {
+    IndexEntry _entry;
+    _entry.offset = offset;
+    _entry.length = line.length();
+    _entry.tokenCount = count_tokens( line );
+    _entry.id = part.get_id();
+    _entry.partName = part.get_part_name();
+    _entry.key = part.key_to_string();
+    _entry.beatsPerMeasure = part.get_beats_per_measure();
+    _entry.subBeatsPerBeat = part.get_sub_beats();
+    add_entry( _entry );
+}
+
+/**
+ * Counts the whitespace-separated tokens on a line of the corpus.
+ * If the line starts with a header, the header is skipped.
+ *
+ * @param line A line of the corpus.
+ * @return The number of tokens on the line.
+ */
+size_t CorpusIndexWriter::count_tokens( std::string_view line ) {
+    if (line.starts_with( Part::SOH + Part::ID )) {
+        auto _eoh = line.find( Part::EOH );
+        line.remove_prefix( (_eoh == std::string_view::npos) ? line.length() : _eoh + Part::EOH.length() );
+    }
+
+    size_t _count{0};
+    bool _inToken{false};
+    for (char _ch : line) {
+        bool _isSpace = std::isspace( static_cast<unsigned char>( _ch ) );
+        if (!_isSpace && !_inToken) {
+            _count++;
+        }
+        _inToken = !_isSpace;
+    }
+    return _count;
+}
+
+/**
+ * Memory-maps the corpus and loads its sidecar index.
+ *
+ * @param corpusPath The path of the token corpus.
+ * @param indexPath The path of the index; if empty, the default index path for the corpus is used.
+ * @return `true` if both the corpus and the index were loaded, `false` otherwise.
+ */
+bool CorpusReader::open( const std::string& corpusPath, const std::string& indexPath ) {
+    close();
+
+    if (!load_index( indexPath.empty() ? CorpusIndexWriter::index_path( corpusPath ) : indexPath )) {
+        return false;
+    }
+
+    int _fd = ::open( corpusPath.c_str(), O_RDONLY );
+    if (_fd < 0) {
+        std::cerr << "Error opening corpus: " << corpusPath << std::endl;
+        return false;
+    }
+
+    struct stat _stat;
+    if (fstat( _fd, &_stat ) != 0) {
+        std::cerr << "Unable to determine size of corpus: " << corpusPath << std::endl;
+        ::close( _fd );
+        return false;
+    }
+
+    size_ = _stat.st_size;
+    if (size_ > 0) {
+        void* _data = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, _fd, 0 );
+        if (_data == MAP_FAILED) {
+            std::cerr << "Failed to map corpus: " << corpusPath << std::endl;
+            ::close( _fd );
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const char*>( _data );
+    }
+    ::close( _fd );
+
+    // make sure the index describes this corpus
+    for (const auto& _entry : entries_) {
+        if (_entry.offset + _entry.length > size_) {
+            std::cerr << "Index does not match corpus: " << corpusPath << std::endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Unmaps the corpus and discards the index.
+ */
+void CorpusReader::close() {
+    if (data_) {
+        munmap( const_cast<char*>( data_ ), size_ );
+    }
+    data_ = nullptr;
+    size_ = 0;
+    entries_.clear();
+    choraleStarts_.clear();
+}
+
+/**
+ * Reads the index file, grouping consecutive lines with the same ID into chorales.
+ *
+ * @param indexPath The path of the index file.
+ * @return `true` if the index was loaded, `false` otherwise.
+ */
+bool CorpusReader::load_index( const std::string& indexPath ) {
+    std::ifstream _indexFile{ indexPath };
+    if (!_indexFile) {
+        std::cerr << "Error opening index file: " << indexPath << std::endl;
+        return false;
+    }
+
+    for (std::string _line; std::getline( _indexFile, _line ); ) {
+        if (_line.empty() || _line[0] == '#') {
+            continue;
+        }
+
+        IndexEntry _entry;
+        if (!parse_entry( _line, _entry )) {
+            std::cerr << "Invalid index entry: " << _line << std::endl;
+            return false;
+        }
+
+        // a new ID starts a new chorale
+        if (entries_.empty() || entries_.back().id != _entry.id) {
+            choraleStarts_.push_back( entries_.size() );
+        }
+        entries_.push_back( std::move( _entry ) );
+    }
+    return true;
+}
+
+/**
+ * Parses a tab-separated line of the index.
+ *
+ * @param line The line to parse.
+ * @param entry The entry to fill in.
+ * @return `true` if all fields were present, `false` otherwise.
+ */
+bool CorpusReader::parse_entry( const std::string& line, IndexEntry& entry ) const {
+    std::istringstream _is{ line };
+    std::string _offset, _length, _tokens, _beats, _subBeats;
+    std::getline( _is, _offset, '\t' );
+    std::getline( _is, _length, '\t' );
+    std::getline( _is, _tokens, '\t' );
+    std::getline( _is, entry.id, '\t' );
+    std::getline( _is, entry.partName, '\t' );
+    std::getline( _is, entry.key, '\t' );
+    std::getline( _is, _beats, '\t' );
+    if (!std::getline( _is, _subBeats )) {
+        return false;
+    }
+
+    try {
+        entry.offset = std::stoull( _offset );
+        entry.length = std::stoull( _length );
+        entry.tokenCount = std::stoull( _tokens );
+        entry.beatsPerMeasure = std::stoull( _beats );
+        entry.subBeatsPerBeat = std::stoull( _subBeats );
+    }
+    catch (std::exception& e) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the index entries for the given chorale.
+ *
+ * @param chorale The position of the chorale within the corpus (origin 0).
+ * @return The entries for the chorale's lines, or an empty vector if out of range.
+ */
+std::vector<IndexEntry> CorpusReader::get_entries( size_t chorale ) const {
+    if (chorale >= choraleStarts_.size()) {
+        return {};
+    }
+    size_t _end = (chorale + 1 < choraleStarts_.size()) ? choraleStarts_[chorale + 1] : entries_.size();
+    return std::vector<IndexEntry>( entries_.begin() + choraleStarts_[chorale], entries_.begin() + _end );
+}
+
+/**
+ * Returns the lines of the corpus for the given chorale without copying them.
+ *
+ * @param chorale The position of the chorale within the corpus (origin 0).
+ * @return Views into the mapped corpus, one per line, or an empty vector if out of range.
+ */
+std::vector<std::string_view> CorpusReader::get_chorale( size_t chorale ) const {
+    std::vector<std::string_view> _lines;
+    if (chorale >= choraleStarts_.size()) {
+        return _lines;
+    }
+    size_t _end = (chorale + 1 < choraleStarts_.size()) ? choraleStarts_[chorale + 1] : entries_.size();
+    for (size_t _i = choraleStarts_[chorale]; _i < _end; _i++) {
+        _lines.push_back( get_line( entries_[_i] ) );
+    }
+    return _lines;
+}
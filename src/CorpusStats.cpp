@@ -0,0 +1,246 @@
+#include "CorpusStats.h"
+#include "CombinedPart.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+/**
+ * Counts the parts of one chorale.
+ *
+ * Notes are counted for the voice named by their part. The notes of chords (from a combined part) are counted for
+ *  "Voice 1", "Voice 2", etc. in the order they appear in the chord. If the chorale has no chords, its parts are
+ *  merged the way inputEncodings merges them, so that chord types can be counted from separate parts as well.
+ *
+ * @param parts The parts of the chorale.
+ */
+void CorpusStats::add_chorale( const std::vector<std::unique_ptr<Part>>& parts ) {
+    if (parts.empty()) {
+        return;
+    }
+
+    chorales_++;
+    uint64_t _tokens{0};
+    bool _hasChords{false};
+    std::vector<VoiceStats*> _chordVoices;
+
+    for (const auto& _part : parts) {
+        parts_++;
+        _tokens += _part->get_encodings().size();
+        VoiceStats* _voice = nullptr;  // looked up at the first note, so a combined part has no entry of its own
+
+        for (const auto& _encoding : _part->get_encodings()) {
+            if (_encoding->is_note()) {
+                if (!_voice) {
+                    _voice = &voices_[_part->get_part_name()];
+                }
+                add_note( *_voice, static_cast<const Note&>( *_encoding ) );
+            }
+            else if (_encoding->is_chord()) {
+                const Chord& _chord = static_cast<const Chord&>( *_encoding );
+                _hasChords = true;
+
+                // look up each voice of the chord once
+                while (_chordVoices.size() < _chord.get_notes().size()) {
+                    _chordVoices.push_back( &voices_["Voice " + std::to_string( _chordVoices.size() + 1 )] );
+                }
+                for (size_t _v = 0; _v < _chord.get_notes().size(); _v++) {
+                    add_note( *_chordVoices[_v], _chord.get_notes()[_v] );
+                }
+                add_chord( _chord );
+            }
+        }
+    }
+
+    // merge separate parts into chords
+    if (!_hasChords && parts.size() > 1) {
+        CombinedPart _combinedPart{ parts };
+        if (_combinedPart.build( /* verbose= */ false )) {
+            for (const auto& _encoding : _combinedPart.get_encodings()) {
+                if (_encoding->is_chord()) {
+                    add_chord( static_cast<const Chord&>( *_encoding ) );
+                }
+            }
+        }
+        else {
+            std::cerr << "Unable to merge parts of " << parts[0]->get_id() << "; chords not counted" << std::endl;
+        }
+    }
+
+    tokens_ += _tokens;
+    minTokens_ = std::min( minTokens_, _tokens );
+    maxTokens_ = std::max( maxTokens_, _tokens );
+    tokensPerChorale_[static_cast<int>( _tokens / TOKEN_BUCKET * TOKEN_BUCKET )]++;
+}
+
+/**
+ * Counts a note or rest for a voice.
+ *
+ * @param voice The statistics of the voice the note belongs to.
+ * @param note The note or rest.
+ */
+void CorpusStats::add_note( VoiceStats& voice, const Note& note ) {
+    voice.durations[note.get_duration()]++;
+    if (note.is_rest()) {
+        voice.rests++;
+    }
+    else if (!note.get_tied()) {
+        voice.notes++;
+        voice.pitches[note.get_midi_pitch()]++;
+    }
+}
+
+/**
+ * Counts a chord's duration and type.
+ *
+ * @param chord The chord.
+ */
+void CorpusStats::add_chord( const Chord& chord ) {
+    chords_++;
+    chordDurations_[chord.get_duration()]++;
+
+    std::string _type = chord_type( chord );
+    if (!_type.empty()) {
+        chordTypes_[_type]++;
+    }
+}
+
+/**
+ * Describes a chord by the pitch classes of its sounding notes relative to its lowest sounding note, so that
+ *  e.g. every root-position major triad is "0.4.7" and its first inversion is "0.3.8".
+ *
+ * @param chord The chord.
+ * @return The pitch classes in ascending order separated by periods, or an empty string if every voice rests.
+ */
+std::string CorpusStats::chord_type( const Chord& chord ) {
+    int _bass{ INT32_MAX };
+    for (const Note& _note : chord.get_notes()) {
+        if (!_note.is_rest()) {
+            _bass = std::min( _bass, _note.get_midi_pitch() );
+        }
+    }
+    if (_bass == INT32_MAX) {
+        return "";
+    }
+
+    std::set<int> _pitchClasses;
+    for (const Note& _note : chord.get_notes()) {
+        if (!_note.is_rest()) {
+            _pitchClasses.insert( (_note.get_midi_pitch() - _bass) % 12 );
+        }
+    }
+
+    std::ostringstream _os;
+    for (int _pitchClass : _pitchClasses) {
+        if (_pitchClass != *_pitchClasses.begin()) {
+            _os << '.';
+        }
+        _os << _pitchClass;
+    }
+    return _os.str();
+}
+
+/**
+ * Adds the counts of another partial result to this one.
+ *
+ * @param other The partial result to add.
+ */
+void CorpusStats::merge( const CorpusStats& other ) {
+    auto _mergeHistogram = []( Histogram& to, const Histogram& from ) {
+        for (const auto& [_value, _count] : from) {
+            to[_value] += _count;
+        }
+    };
+
+    chorales_ += other.chorales_;
+    parts_ += other.parts_;
+    for (const auto& [_name, _voice] : other.voices_) {
+        VoiceStats& _to = voices_[_name];
+        _to.notes += _voice.notes;
+        _to.rests += _voice.rests;
+        _mergeHistogram( _to.pitches, _voice.pitches );
+        _mergeHistogram( _to.durations, _voice.durations );
+    }
+    chords_ += other.chords_;
+    _mergeHistogram( chordDurations_, other.chordDurations_ );
+    for (const auto& [_type, _count] : other.chordTypes_) {
+        chordTypes_[_type] += _count;
+    }
+    _mergeHistogram( tokensPerChorale_, other.tokensPerChorale_ );
+    tokens_ += other.tokens_;
+    minTokens_ = std::min( minTokens_, other.minTokens_ );
+    maxTokens_ = std::max( maxTokens_, other.maxTokens_ );
+}
+
+/**
+ * Writes the statistics as a JSON object. Chord types are listed from most to least frequent.
+ *
+ * @param os The stream to write to.
+ */
+void CorpusStats::write_json( std::ostream& os ) const {
+    os << "{\n";
+    os << "  \"chorales\": " << chorales_ << ",\n";
+    os << "  \"parts\": " << parts_ << ",\n";
+
+    os << "  \"tokensPerChorale\": {\n";
+    os << "    \"min\": " << (chorales_ ? minTokens_ : 0) << ",\n";
+    os << "    \"max\": " << maxTokens_ << ",\n";
+    os << "    \"mean\": " << (chorales_ ? static_cast<double>( tokens_ ) / chorales_ : 0.0) << ",\n";
+    os << "    \"bucketWidth\": " << TOKEN_BUCKET << ",\n";
+    os << "    \"histogram\": ";
+    write_histogram( os, tokensPerChorale_ );
+    os << "\n  },\n";
+
+    os << "  \"voices\": {";
+    bool _first{true};
+    for (const auto& [_name, _voice] : voices_) {
+        os << (_first ? "\n" : ",\n") << "    \"" << _name << "\": {\n";
+        os << "      \"notes\": " << _voice.notes << ",\n";
+        os << "      \"rests\": " << _voice.rests << ",\n";
+        if (!_voice.pitches.empty()) {
+            os << "      \"lowest\": " << _voice.pitches.begin()->first << ",\n";
+            os << "      \"highest\": " << _voice.pitches.rbegin()->first << ",\n";
+        }
+        os << "      \"pitches\": ";
+        write_histogram( os, _voice.pitches );
+        os << ",\n      \"durations\": ";
+        write_histogram( os, _voice.durations );
+        os << "\n    }";
+        _first = false;
+    }
+    os << "\n  },\n";
+
+    std::vector<std::pair<std::string, uint64_t>> _types{ chordTypes_.begin(), chordTypes_.end() };
+    std::stable_sort( _types.begin(), _types.end(), []( const auto& a, const auto& b ) {
+        return a.second > b.second;
+    } );
+
+    os << "  \"chords\": {\n";
+    os << "    \"count\": " << chords_ << ",\n";
+    os << "    \"durations\": ";
+    write_histogram( os, chordDurations_ );
+    os << ",\n    \"types\": {";
+    _first = true;
+    for (const auto& [_type, _count] : _types) {
+        os << (_first ? "" : ", ") << '"' << _type << "\": " << _count;
+        _first = false;
+    }
+    os << "}\n  }\n";
+    os << "}\n";
+}
+
+/**
+ * Writes a histogram as a JSON object whose keys are the values counted.
+ *
+ * @param os The stream to write to.
+ * @param histogram The histogram.
+ */
+void CorpusStats::write_histogram( std::ostream& os, const Histogram& histogram ) {
+    os << '{';
+    bool _first{true};
+    for (const auto& [_value, _count] : histogram) {
+        os << (_first ? "" : ", ") << '"' << _value << "\": " << _count;
+        _first = false;
+    }
+    os << '}';
+}
@@ -0,0 +1,253 @@
+#include "Dedupe.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+
+Deduplicator::Deduplicator( const Options& options ) : options_{options} {
+    // each row of the signature is the minimum of a differently seeded hash over the shingles
+    for (size_t _row = 0; _row < signature_size(); _row++) {
+        seeds_.push_back( mix( _row + 1 ) );
+    }
+}
+
+/**
+ * Reserves room for a chorale's fingerprint.
+ *
+ * @param id The ID of the chorale, e.g. "BWV 10.1".
+ * @return The position of the chorale, to pass to fingerprint().
+ */
+size_t Deduplicator::add( const std::string& id ) {
+    ids_.push_back( id );
+    exactHashes_.push_back( 0 );
+    signatures_.resize( signatures_.size() + signature_size(), std::numeric_limits<uint64_t>::max() );
+    return ids_.size() - 1;
+}
+
+/**
+ * Computes the fingerprint of a chorale from its lines.
+ *
+ * The exact hash combines a hash of each part's token stream, in part order. The MinHash signature is computed over
+ *  every run of `ngram` consecutive tokens within a part (or the whole part if it is shorter); shingles are seeded
+ *  with the part's position, so the same passage in different voices is a different shingle.
+ *
+ * Only the chorale's own slots are written, so different chorales may be fingerprinted on different threads.
+ *
+ * @param k The position of the chorale, as returned by add().
+ * @param lines The chorale's lines, one per part.
+ */
+void Deduplicator::fingerprint( size_t k, const std::vector<std::string_view>& lines ) {
+    uint64_t _exact{0};
+    uint64_t* _signature = signatures_.data() + k * signature_size();
+    std::vector<std::string_view> _tokens;
+
+    for (size_t _voice = 0; _voice < lines.size(); _voice++) {
+        // skip the header, which holds the ID
+        std::string_view _line = lines[_voice];
+        size_t _eoh = _line.find( Part::EOH );
+        if (_line.starts_with( Part::SOH ) && _eoh != std::string_view::npos) {
+            _line.remove_prefix( _eoh + Part::EOH.size() );
+        }
+
+        // split the line into tokens
+        _tokens.clear();
+        for (size_t _start = 0; _start < _line.size(); ) {
+            size_t _end = std::min( _line.find( ' ', _start ), _line.size() );
+            if (_end > _start) {
+                _tokens.push_back( _line.substr( _start, _end - _start ) );
+            }
+            _start = _end + 1;
+        }
+        if (_tokens.empty()) {
+            continue;
+        }
+
+        // the part's whole stream
+        std::string_view _stream{ _tokens.front().data(),
+            static_cast<size_t>( _tokens.back().data() + _tokens.back().size() - _tokens.front().data() ) };
+        _exact = mix( _exact ^ hash( _stream, _voice ) );
+
+        // each run of ngram tokens
+        size_t _ngram = std::min( options_.ngram, _tokens.size() );
+        for (size_t _first = 0; _first + _ngram <= _tokens.size(); _first++) {
+            const std::string_view& _last = _tokens[_first + _ngram - 1];
+            std::string_view _shingle{ _tokens[_first].data(),
+                static_cast<size_t>( _last.data() + _last.size() - _tokens[_first].data() ) };
+            uint64_t _shingleHash = hash( _shingle, _voice );
+            for (size_t _row = 0; _row < seeds_.size(); _row++) {
+                _signature[_row] = std::min( _signature[_row], mix( _shingleHash ^ seeds_[_row] ) );
+            }
+        }
+    }
+    exactHashes_[k] = _exact;
+}
+
+/**
+ * Clusters the chorales and decides which to keep.
+ *
+ * Chorales with the same exact hash are joined first. Then, for each band, chorales whose signatures agree in every
+ *  row of the band are sorted next to each other, and each is joined to the first earlier chorale in its bucket
+ *  whose estimated similarity reaches the threshold. Chorales already in the same cluster are not compared again,
+ *  so a bucket of identical chorales costs one comparison per chorale.
+ */
+void Deduplicator::cluster() {
+    const size_t _count = ids_.size();
+    parents_.resize( _count );
+    std::iota( parents_.begin(), parents_.end(), 0 );
+
+    // exact duplicates
+    std::vector<std::pair<uint64_t, size_t>> _keys( _count );
+    for (size_t _k = 0; _k < _count; _k++) {
+        _keys[_k] = { exactHashes_[_k], _k };
+    }
+    std::sort( _keys.begin(), _keys.end() );
+    for (size_t _i = 1; _i < _count; _i++) {
+        if (_keys[_i].first == _keys[_i - 1].first) {
+            unite( _keys[_i - 1].second, _keys[_i].second );
+        }
+    }
+
+    // near duplicates
+    for (size_t _band = 0; _band < options_.bands; _band++) {
+        for (size_t _k = 0; _k < _count; _k++) {
+            const uint64_t* _rows = signatures_.data() + _k * signature_size() + _band * options_.rows;
+            uint64_t _key{ _band };
+            for (size_t _row = 0; _row < options_.rows; _row++) {
+                _key = mix( _key ^ _rows[_row] );
+            }
+            _keys[_k] = { _key, _k };
+        }
+        std::sort( _keys.begin(), _keys.end() );
+
+        for (size_t _start = 0; _start < _count; ) {
+            size_t _end = _start + 1;
+            while (_end < _count && _keys[_end].first == _keys[_start].first) {
+                _end++;
+            }
+
+            for (size_t _j = _start + 1; _j < _end; _j++) {
+                for (size_t _i = _start; _i < _j; _i++) {
+                    size_t _a = _keys[_i].second;
+                    size_t _b = _keys[_j].second;
+                    if (find( _a ) == find( _b )) {
+                        break;
+                    }
+                    if (estimate_similarity( _a, _b ) >= options_.threshold) {
+                        unite( _a, _b );
+                        break;
+                    }
+                }
+            }
+            _start = _end;
+        }
+    }
+
+    // keep the earliest chorale of each cluster
+    decisions_.assign( _count, Decision{} );
+    for (size_t _k = 0; _k < _count; _k++) {
+        Decision& _decision = decisions_[_k];
+        _decision.keptAs = find( _k );
+        _decision.keep = (_decision.keptAs == _k);
+        if (!_decision.keep) {
+            _decision.exact = (exactHashes_[_k] == exactHashes_[_decision.keptAs]);
+            _decision.similarity = _decision.exact ? 1.0 : estimate_similarity( _k, _decision.keptAs );
+        }
+    }
+}
+
+/**
+ * Writes the keep/drop manifest: a column header line followed by one tab-separated line per chorale, in corpus
+ *  order.
+ *
+ * @param os The stream to write to.
+ */
+void Deduplicator::write_manifest( std::ostream& os ) const {
+    os << "# id\taction\tkept\treason\tsimilarity\n";
+    for (size_t _k = 0; _k < decisions_.size(); _k++) {
+        const Decision& _decision = decisions_[_k];
+        os << ids_[_k] << '\t'
+            << (_decision.keep ? "keep" : "drop") << '\t'
+            << ids_[_decision.keptAs] << '\t'
+            << (_decision.keep ? "-" : (_decision.exact ? "exact" : "near")) << '\t'
+            << std::fixed << std::setprecision( 3 ) << _decision.similarity << '\n';
+    }
+}
+
+/**
+ * Finds the root of a chorale's cluster, halving the path as it goes.
+ *
+ * @param k The position of the chorale.
+ * @return The position of the root, which is the earliest chorale of the cluster.
+ */
+size_t Deduplicator::find( size_t k ) {
+    while (parents_[k] != k) {
+        parents_[k] = parents_[parents_[k]];
+        k = parents_[k];
+    }
+    return k;
+}
+
+/**
+ * Joins the clusters of two chorales, keeping the earlier root.
+ *
+ * @param a The position of one chorale.
+ * @param b The position of the other chorale.
+ */
+void Deduplicator::unite( size_t a, size_t b ) {
+    size_t _rootA = find( a );
+    size_t _rootB = find( b );
+    if (_rootA < _rootB) {
+        parents_[_rootB] = _rootA;
+    }
+    else if (_rootB < _rootA) {
+        parents_[_rootA] = _rootB;
+    }
+}
+
+/**
+ * Estimates the Jaccard similarity of two chorales' shingle sets as the fraction of signature rows that agree.
+ *
+ * @param a The position of one chorale.
+ * @param b The position of the other chorale.
+ * @return The estimated similarity, from 0 to 1.
+ */
+double Deduplicator::estimate_similarity( size_t a, size_t b ) const {
+    const uint64_t* _a = signatures_.data() + a * signature_size();
+    const uint64_t* _b = signatures_.data() + b * signature_size();
+    size_t _agree{0};
+    for (size_t _row = 0; _row < signature_size(); _row++) {
+        _agree += (_a[_row] == _b[_row]);
+    }
+    return static_cast<double>( _agree ) / signature_size();
+}
+
+/**
+ * 64-bit FNV-1a hash of a string, mixed with a seed.
+ *
+ * @param text The string to hash.
+ * @param seed The seed.
+ * @return The hash.
+ */
+uint64_t Deduplicator::hash( std::string_view text, uint64_t seed ) {
+    uint64_t _hash{ 14695981039346656037ull };
+    for (char _c : text) {
+        _hash ^= static_cast<unsigned char>( _c );
+        _hash *= 1099511628211ull;
+    }
+    return mix( _hash + seed );
+}
+
+/**
+ * Scrambles the bits of a value (the splitmix64 finalizer), so that nearby inputs give unrelated outputs.
+ *
+ * @param value The value to scramble.
+ * @return The scrambled value.
+ */
+uint64_t Deduplicator::mix( uint64_t value ) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
@@ -1,8 +1,11 @@
 #include "Encoding.h"
 #include "XmlUtils.h"
 
+#include <cstdlib>
 #include <map>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
 
 using namespace tinyxml2;
 
@@ -112,17 +115,103 @@ void Note::parse_pitch( const std::string& pitch ) {
  */
 std::string Note::pitch_to_string() const {
     std::ostringstream _os;
+    write_pitch( _os );
+    return _os.str();
+}  
+
+/**
+ * Writes the note's pitch representation (see pitch_to_string()) to the given stream.
+ *
+ * @param os The stream to write to.
+ */
+void Note::write_pitch( std::ostream& os ) const {
     if ( tied_ ) {
-        _os << "+";
+        os << '+';
     }
-    _os << pitch_;
+    os << pitch_;
     if ( accidental_) {
-        _os << accidental_;
+        os << accidental_;
     }
-    _os << '.' << octave_; 
+    os << '.' << octave_; 
+}
 
-    return _os.str();
-}  
+/**
+ * Writes the note's representation (see to_string()) to the given stream.
+ *
+ * @param os The stream to write to.
+ * @param ignoreDuration If true, the duration is omitted.
+ */
+void Note::write( std::ostream& os, bool ignoreDuration ) const {
+    write_pitch( os );
+    os << '.';
+    if (!ignoreDuration) {
+        os << duration_;
+    }
+}
+
+/**
+ * Converts the note's pitch, accidental, and octave into a MIDI note number (middle C is 60).
+ *
+ * @return The MIDI note number, or 0 if the note is a rest.
+ */
+int Note::get_midi_pitch() const {
+    static const std::map<char, int> _semitonesAboveC = {
+        {'C', 0}, {'D', 2}, {'E', 4}, {'F', 5}, {'G', 7}, {'A', 9}, {'B', 11}
+    };
+
+    auto _it = _semitonesAboveC.find( pitch_ );
+    if (_it == _semitonesAboveC.end()) {
+        return 0;
+    }
+    return 12 * (octave_ + 1) + _it->second + accidental_;
+}
+
+/**
+ * Spells a MIDI note number as a note in a given key, the inverse of get_midi_pitch().
+ *
+ * A pitch in the key's scale is spelled as the key signature spells it. A pitch outside it is spelled by its
+ *  distance from the tonic, as chromatic notes usually are in chorales: in a major key as a raised first, fourth or
+ *  fifth degree or a lowered third or seventh, and in a minor key as a lowered second degree or a raised third,
+ *  fourth, sixth or seventh.
+ *
+ * @param midiPitch The MIDI note number (middle C is 60).
+ * @param key The number of sharps (if plus) or flats (if minus) in the key signature.
+ * @param minor True if the key is minor.
+ * @param duration The duration of the note.
+ * @param tied True if the note is tied from the previous note.
+ * @return The note.
+ */
+Note Note::from_midi_pitch( int midiPitch, int key, bool minor, unsigned int duration, bool tied ) {
+    static const char _letters[] = { 'C', 'D', 'E', 'F', 'G', 'A', 'B' };
+    static const int _naturals[] = { 0, 2, 4, 5, 7, 9, 11 };
+    // for each semitone above the tonic: the scale degree (origin 0) it is spelled from, and the alteration of that
+    //  degree (0 for a pitch in the scale)
+    static const std::pair<int, int> _majorDegrees[] = {
+        {0, 0}, {0, 1}, {1, 0}, {2, -1}, {2, 0}, {3, 0}, {3, 1}, {4, 0}, {4, 1}, {5, 0}, {6, -1}, {6, 0}
+    };
+    static const std::pair<int, int> _minorDegrees[] = {
+        {0, 0}, {1, -1}, {1, 0}, {2, 0}, {2, 1}, {3, 0}, {3, 1}, {4, 0}, {5, 0}, {5, 1}, {6, 0}, {6, 1}
+    };
+
+    // the alteration of each letter in the key signature: sharps are added in the order F C G D A E B, flats in the
+    //  reverse order
+    int _alterations[7] = {};
+    for (int _i = 0; _i < std::abs( key ) && _i < 7; _i++) {
+        _alterations[key > 0 ? (3 + 4 * _i) % 7 : (6 + 3 * _i) % 7] = key > 0 ? 1 : -1;
+    }
+
+    // the tonic of a major key is (4 * key) letters above C, and that of its relative minor 5 letters further
+    int _tonic = (((4 * key) % 7 + 7) % 7 + (minor ? 5 : 0)) % 7;
+    int _tonicPitchClass = (_naturals[_tonic] + _alterations[_tonic] + 12) % 12;
+
+    auto [_degree, _alteration] = (minor ? _minorDegrees : _majorDegrees)[(midiPitch - _tonicPitchClass + 12) % 12];
+    int _letter = (_tonic + _degree) % 7;
+    int _accidental = _alterations[_letter] + _alteration;
+
+    // the octave belongs to the letter, so B#3 sounds like C4
+    unsigned int _octave = (midiPitch - _naturals[_letter] - _accidental) / 12 - 1;
+    return Note{ _letters[_letter], _octave, duration, _accidental, tied };
+}
 
 /**
  * Parses an XML note element and updates the note's properties accordingly.
@@ -133,7 +222,8 @@ std::string Note::pitch_to_string() const {
  * member variables of the Note object.
  *
  * The method also handles the case of a tied note by checking the "tie" child element and updating
- * the `tied_` and `tie_started_` member variables accordingly.
+ * the `tied_` member variable and the part's tie state accordingly. The tie state belongs to the part being
+ * parsed rather than to the Note class, so that parts can be parsed concurrently.
  *
  * If the note element has a "rest" child element, the method sets the `isValid_` member variable to
  * true, indicating that the note is a valid rest.
@@ -142,9 +232,10 @@ std::string Note::pitch_to_string() const {
  * which may in turn set the `isValid_` member variable to false if the duration is invalid.
  *
  * @param note The XML element representing the note to be parsed.
+ * @param tieStarted The tie state of the part: true if a tie was started by the previous note.
  * @return True if the note is valid, false otherwise.
  */
-bool Note::parse_xml( XMLElement* note )  {
+bool Note::parse_xml( XMLElement* note, bool& tieStarted )  {
     isValid_ = false;
     XMLElement* _pitch = note ? note->FirstChildElement( "pitch" ) : nullptr;
     if (_pitch) {
@@ -163,17 +254,17 @@ bool Note::parse_xml( XMLElement* note )  {
         }
 
         // handle ties
-        if (tie_started_) {
+        if (tieStarted) {
             tied_ = true;
         }
         
         if (_tie) {
             const char* _type = _tie->Attribute( "type" );
             if (_type && strcmp( _type, "start" ) == 0) {
-                tie_started_ = true;
+                tieStarted = true;
             }
             else if (_type && strcmp( _type, "stop" ) == 0) {
-                tie_started_ = false;
+                tieStarted = false;
             }
         }
     }
@@ -217,12 +308,50 @@ bool Encoding::parse_xml( XMLElement* element ) {
  */
 std::string Chord::to_string( bool ignoreDuration ) const {
     std::ostringstream _os;
+    write( _os, ignoreDuration );
+    return _os.str();
+}
+
+/**
+ * Writes the chord's representation (see to_string()) to the given stream.
+ *
+ * @param os The stream to write to.
+ * @param ignoreDuration If true, the duration is omitted.
+ */
+void Chord::write( std::ostream& os, bool ignoreDuration ) const {
     for (auto& note : notes_) {
-        _os << note.pitch_to_string() << '.';
+        note.write_pitch( os );
+        os << '.';
+    }
+    if (!ignoreDuration) {
+        os << duration_;
     }
+}
 
-    _os << Encoding::to_string( ignoreDuration );
-    return _os.str();
+/**
+ * Parses the encoding string and builds the chord's notes and duration.
+ * The encoding string is expected to be in the format "pitch.octave.pitch.octave. ... .duration", as written by
+ *  write(), with one pitch and octave for each voice. Each note gets the chord's duration.
+ * This method is an implementation detail of the Chord class.
+ */
+void Chord::parse_encoding( const std::string& encoding ) {
+    std::vector<std::string> _fields;
+    std::istringstream _is{encoding}; 
+    for (std::string _field; std::getline( _is, _field, '.' ); ) {
+        _fields.push_back( _field );
+    }
+    if (_fields.size() < 3 || _fields.size() % 2 == 0) {
+        throw std::invalid_argument( "chord must have a pitch and octave for each voice and a duration" );
+    }
+
+    duration_ = std::stoi( _fields.back() );
+    for (size_t _i = 0; _i + 1 < _fields.size(); _i += 2) {
+        Note _note{ _fields[_i] + '.' + _fields[_i + 1] + '.' + _fields.back() };
+        if (!_note.is_valid()) {
+            throw std::invalid_argument( "invalid note in chord" );
+        }
+        notes_.push_back( std::move( _note ) );
+    }
 }
 
 /**
@@ -239,3 +368,14 @@ void Note::transpose( const std::map<char, TranspositionRule>& rules ) {
         accidental_ += rule->second.accidentalChange;
     }
 }
+
+/**
+ * Transposes each note of the chord according to the given rules (see Note::transpose()).
+ *
+ * @param rules The transposition rules, keyed by pitch.
+ */
+void Chord::transpose( const std::map<char, TranspositionRule>& rules ) {
+    for (Note& _note : notes_) {
+        _note.transpose( rules );
+    }
+}
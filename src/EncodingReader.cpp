@@ -0,0 +1,107 @@
+#include "EncodingReader.h"
+#include "Arguments.h"
+#include "GzipStream.h"
+
+#include <iostream>
+#include <string>
+
+/**
+ * Determines whether a source is a file of encodings (as written by inputXml or inputEncodings) rather than
+ *  musicXml or a list of musicXml sources, by looking for a header on its first line.
+ *
+ * @param source The file name or url given on the command line.
+ * @return `true` if the source is a file of encodings, `false` otherwise.
+ */
+bool EncodingReader::is_encodings_file( const std::string& source ) {
+    if (Arguments::get_input_source_type( source ) != Arguments::TXT) {
+        return false;
+    }
+
+    auto _file = GzipStream::open_input( source );
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        if (!_line.empty()) {
+            return _line.starts_with( Part::SOH + Part::ID );
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads a file of encodings and groups its lines into chorales by ID. Only the header of each line is parsed here;
+ *  the encodings are parsed later, on the worker threads.
+ *
+ * @param source The path of the file of encodings, which is decompressed if its name ends in ".gz".
+ * @param chorales The vector to fill with the lines of each chorale.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool EncodingReader::read_chorale_lines( const std::string& source, std::vector<ChoraleLines>& chorales ) {
+    auto _file = GzipStream::open_input( source );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << source << std::endl;
+        return false;
+    }
+
+    std::string _currentId;
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        Part _header;
+        if (_line.empty() || !_header.parse_header( _line )) {
+            continue;
+        }
+
+        if (chorales.empty() || _header.get_id() != _currentId) {
+            _currentId = _header.get_id();
+            chorales.emplace_back();
+        }
+        chorales.back().push_back( std::move( _line ) );
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << source << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the parts of the next chorale. A chorale consists of consecutive lines with the same ID.
+ * Lines that cannot be parsed are reported and skipped.
+ *
+ * @param parts The vector to fill with the chorale's parts; any previous contents are discarded.
+ * @return `true` if a chorale was read, `false` if there are no more chorales.
+ */
+bool EncodingReader::read_chorale( std::vector<std::unique_ptr<Part>>& parts ) {
+    parts.clear();
+
+    if (!nextPart_) {
+        nextPart_ = read_part();
+    }
+
+    while (nextPart_) {
+        if (!parts.empty() && parts.back()->get_id() != nextPart_->get_id()) {
+            break;
+        }
+        parts.push_back( std::move( nextPart_ ) );
+        nextPart_ = read_part();
+    }
+    return !parts.empty();
+}
+
+/**
+ * Reads the next non-empty line and builds a Part object from it.
+ *
+ * @return The part, or nullptr if the end of the input has been reached.
+ */
+std::unique_ptr<Part> EncodingReader::read_part() {
+    for (std::string _line; std::getline( is_, _line ); ) {
+        lineNumber_++;
+        if (_line.empty()) {
+            continue;
+        }
+
+        auto _part = std::make_unique<Part>();
+        if (_part->parse_encoding( _line )) {
+            return _part;
+        }
+        std::cerr << "Skipping line " << lineNumber_ << std::endl;
+    }
+    return nullptr;
+}
@@ -0,0 +1,162 @@
+#include "EncodingVerifier.h"
+
+#include <string>
+
+/**
+ * Prints a part with the default print options (the only ones that keep everything parse_encoding() needs), parses
+ *  the text back into a new part, and compares the two. The measures of both parts are checked as well.
+ *
+ * @param part The part to verify.
+ * @param errors The stream to describe the first problem on.
+ * @return `true` if the part survived the round trip, `false` otherwise.
+ */
+bool EncodingVerifier::verify( const Part& part, std::ostream& errors ) {
+    if (!check_measures( part, errors )) {
+        return false;
+    }
+
+    Part _parsed;
+    if (!_parsed.parse_encoding( part.to_string() )) {
+        errors << "[" << part.get_id() << "] " << part.get_part_name() << ": Printed encoding cannot be parsed\n";
+        return false;
+    }
+    return check_measures( _parsed, errors ) && compare( part, _parsed, errors );
+}
+
+/**
+ * Compares two parts: first the fields of the header, then each encoding in turn, including the measure and tick
+ *  it was placed at. Only the first difference is reported.
+ *
+ * @param expected The part as it was encoded.
+ * @param actual The part as it was parsed back.
+ * @param errors The stream to describe the first difference on.
+ * @return `true` if the parts are the same, `false` otherwise.
+ */
+bool EncodingVerifier::compare( const Part& expected, const Part& actual, std::ostream& errors ) {
+    if (expected.get_header() != actual.get_header()) {
+        errors << "[" << expected.get_id() << "] " << expected.get_part_name() << ": Header differs: expected "
+            << expected.get_header() << ", found " << actual.get_header() << '\n';
+        return false;
+    }
+
+    const auto& _expected = expected.get_encodings();
+    const auto& _actual = actual.get_encodings();
+    for (size_t _i = 0; _i < _expected.size(); _i++) {
+        if (_i == _actual.size()) {
+            errors << expected.location_to_string( _expected[_i].get() ) << ' ' << expected.get_part_name()
+                << ": Parsed encoding ends early, before " << _expected[_i]->to_string() << '\n';
+            return false;
+        }
+
+        const Encoding& _e = *_expected[_i];
+        const Encoding& _a = *_actual[_i];
+        if (!same_encoding( _e, _a )) {
+            errors << expected.location_to_string( &_e ) << ' ' << expected.get_part_name()
+                << ": Expected " << _e.to_string() << ", found " << _a.to_string() << '\n';
+            return false;
+        }
+        if (_e.get_measure_number() != _a.get_measure_number() || _e.get_tick_number() != _a.get_tick_number()) {
+            errors << expected.location_to_string( &_e ) << ' ' << expected.get_part_name()
+                << ": " << _e.to_string() << " is parsed at " << actual.location_to_string( &_a ) << '\n';
+            return false;
+        }
+    }
+
+    if (_actual.size() > _expected.size()) {
+        const Encoding* _extra = _actual[_expected.size()].get();
+        errors << actual.location_to_string( _extra ) << ' ' << actual.get_part_name()
+            << ": Parsed encoding has extra " << _extra->to_string() << '\n';
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Walks the encodings of a part, replaying the measure and tick bookkeeping of push_encoding(), and checks that the
+ *  location stored with each encoding agrees with it and that no measure overflows.
+ *
+ * @param part The part to check.
+ * @param errors The stream to describe the first problem on.
+ * @return `true` if the measures are consistent, `false` otherwise.
+ */
+bool EncodingVerifier::check_measures( const Part& part, std::ostream& errors ) {
+    const auto& _encodings = part.get_encodings();
+    if (_encodings.empty() || !_encodings.front()->is_SOC() || !_encodings.back()->is_EOC()) {
+        errors << "[" << part.get_id() << "] " << part.get_part_name() << ": Encoding must run from "
+            << Marker::SOC_STR << " to " << Marker::EOC_STR << '\n';
+        return false;
+    }
+
+    const size_t _ticksPerMeasure = part.get_beats_per_measure() * part.get_sub_beats();
+    size_t _measure = _encodings.front()->get_measure_number();
+    size_t _nextTick = (_measure == 0) ? _encodings.front()->get_tick_number() : 1;
+    for (const auto& _encoding : _encodings) {
+        if (_encoding->is_EOM()) {
+            if (_measure == 0 && _nextTick != _ticksPerMeasure + 1) {
+                errors << part.location_to_string( _encoding.get() ) << ' ' << part.get_part_name()
+                    << ": Upbeat measure ends at tick " << _nextTick - 1 << " of " << _ticksPerMeasure << '\n';
+                return false;
+            }
+            _measure++;
+            _nextTick = 1;
+        }
+
+        if (_encoding->get_measure_number() != _measure || _encoding->get_tick_number() != _nextTick) {
+            errors << part.location_to_string( _encoding.get() ) << ' ' << part.get_part_name()
+                << ": " << _encoding->to_string() << " should be at measure " << _measure
+                << ", tick " << _nextTick << '\n';
+            return false;
+        }
+        if (!_encoding->is_marker() && _encoding->get_duration() == 0) {
+            errors << part.location_to_string( _encoding.get() ) << ' ' << part.get_part_name()
+                << ": " << _encoding->to_string() << " has no duration\n";
+            return false;
+        }
+
+        _nextTick += _encoding->get_duration();
+        if (_nextTick > _ticksPerMeasure + 1) {
+            errors << part.location_to_string( _encoding.get() ) << ' ' << part.get_part_name()
+                << ": Too many notes in measure (" << _nextTick - 1 << " of " << _ticksPerMeasure << " ticks)\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EncodingVerifier::same_note( const Note& expected, const Note& actual ) {
+    return expected.get_pitch() == actual.get_pitch()
+        && expected.get_octave() == actual.get_octave()
+        && expected.get_accidental() == actual.get_accidental()
+        && expected.get_tied() == actual.get_tied();
+}
+
+/**
+ * Compares two encodings by type, duration and content. Unlike Encoding::operator==, which only compares token
+ *  types, this looks at the pitches of notes and chords as well.
+ *
+ * @param expected The encoding as it was encoded.
+ * @param actual The encoding as it was parsed back.
+ * @return `true` if the encodings are the same, `false` otherwise.
+ */
+bool EncodingVerifier::same_encoding( const Encoding& expected, const Encoding& actual ) {
+    if (expected != actual || expected.get_duration() != actual.get_duration()) {
+        return false;
+    }
+
+    if (expected.is_note()) {
+        return same_note( static_cast<const Note&>( expected ), static_cast<const Note&>( actual ) );
+    }
+    if (expected.is_chord()) {
+        const auto& _expectedNotes = static_cast<const Chord&>( expected ).get_notes();
+        const auto& _actualNotes = static_cast<const Chord&>( actual ).get_notes();
+        if (_expectedNotes.size() != _actualNotes.size()) {
+            return false;
+        }
+        for (size_t _i = 0; _i < _expectedNotes.size(); _i++) {
+            if (!same_note( _expectedNotes[_i], _actualNotes[_i] )) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,311 @@
+#include "GzipStream.h"
+
+#include <fstream>
+#include <iostream>
+
+/**
+ * Opens a file for writing and starts a gzip stream on it.
+ *
+ * @param path The path of the file.
+ * @param level The zlib compression level (0-9, or Z_DEFAULT_COMPRESSION).
+ * @return `true` if the file was opened, `false` otherwise.
+ */
+bool GzipOutputBuffer::open( const std::string& path, int level ) {
+    close();
+    file_ = std::fopen( path.c_str(), "wb" );
+    if (!file_) {
+        std::cerr << "Failed to open compressed file: " << path << std::endl;
+        return false;
+    }
+
+    // 15 window bits, plus 16 for a gzip header and trailer instead of a zlib one
+    zs_ = z_stream{};
+    if (deflateInit2( &zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK) {
+        std::cerr << "Failed to start compression for " << path << std::endl;
+        std::fclose( file_ );
+        file_ = nullptr;
+        return false;
+    }
+
+    in_.resize( BUFFER_SIZE );
+    out_.resize( BUFFER_SIZE );
+    setp( in_.data(), in_.data() + in_.size() );
+    written_ = 0;
+    failed_ = false;
+    return true;
+}
+
+/**
+ * Compresses whatever is still buffered, writes the gzip trailer and closes the file.
+ *
+ * @return `true` if everything was written, `false` otherwise.
+ */
+bool GzipOutputBuffer::close() {
+    if (!file_) {
+        return !failed_;
+    }
+
+    deflate_buffer( Z_FINISH );
+    deflateEnd( &zs_ );
+    if (std::fclose( file_ ) != 0) {
+        failed_ = true;
+    }
+    file_ = nullptr;
+    setp( nullptr, nullptr );
+    return !failed_;
+}
+
+GzipOutputBuffer::int_type GzipOutputBuffer::overflow( int_type ch ) {
+    if (!file_ || !deflate_buffer( Z_NO_FLUSH )) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type( ch, traits_type::eof() )) {
+        *pptr() = traits_type::to_char_type( ch );
+        pbump( 1 );
+    }
+    return traits_type::not_eof( ch );
+}
+
+int GzipOutputBuffer::sync() {
+    return (file_ && deflate_buffer( Z_NO_FLUSH )) ? 0 : -1;
+}
+
+GzipOutputBuffer::pos_type GzipOutputBuffer::seekoff( off_type off, std::ios_base::seekdir dir,
+        std::ios_base::openmode which ) {
+    if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out)) {
+        return pos_type( off_type( -1 ) );
+    }
+    return pos_type( written_ + (pptr() - pbase()) );
+}
+
+/**
+ * Hands the buffered text to zlib and writes the compressed output to the file, emptying the buffer.
+ *
+ * @param flush Z_NO_FLUSH while writing, Z_FINISH at the end of the stream.
+ * @return `true` if the output was written, `false` otherwise.
+ */
+bool GzipOutputBuffer::deflate_buffer( int flush ) {
+    if (failed_) {
+        return false;
+    }
+
+    zs_.next_in = reinterpret_cast<Bytef*>( pbase() );
+    zs_.avail_in = static_cast<uInt>( pptr() - pbase() );
+    written_ += zs_.avail_in;
+    do {
+        zs_.next_out = out_.data();
+        zs_.avail_out = static_cast<uInt>( out_.size() );
+        if (deflate( &zs_, flush ) == Z_STREAM_ERROR) {
+            failed_ = true;
+            break;
+        }
+        size_t _produced = out_.size() - zs_.avail_out;
+        if (_produced > 0 && std::fwrite( out_.data(), 1, _produced, file_ ) != _produced) {
+            std::cerr << "Failed to write compressed output" << std::endl;
+            failed_ = true;
+            break;
+        }
+    } while (zs_.avail_out == 0);
+
+    setp( in_.data(), in_.data() + in_.size() );
+    return !failed_;
+}
+
+/**
+ * Opens a gzip file for reading.
+ *
+ * @param path The path of the file.
+ * @return `true` if the file was opened, `false` otherwise.
+ */
+bool GzipInputBuffer::open( const std::string& path ) {
+    close();
+    file_ = std::fopen( path.c_str(), "rb" );
+    if (!file_) {
+        return false;
+    }
+
+    // 15 window bits, plus 32 to accept either a gzip or a zlib header
+    zs_ = z_stream{};
+    if (inflateInit2( &zs_, 15 + 32 ) != Z_OK) {
+        std::cerr << "Failed to start decompression for " << path << std::endl;
+        std::fclose( file_ );
+        file_ = nullptr;
+        return false;
+    }
+
+    in_.resize( BUFFER_SIZE );
+    out_.resize( BUFFER_SIZE );
+    setg( out_.data(), out_.data(), out_.data() );
+    endOfFile_ = false;
+    inMember_ = false;
+    return true;
+}
+
+void GzipInputBuffer::close() {
+    if (file_) {
+        inflateEnd( &zs_ );
+        std::fclose( file_ );
+        file_ = nullptr;
+    }
+    setg( nullptr, nullptr, nullptr );
+}
+
+/**
+ * Refills the buffer with the next block of decompressed text, reading more of the file as zlib needs it. When one
+ *  gzip member ends and more data follows, decompression starts again on the next member. Corrupt data, or a file
+ *  that ends within a member (e.g. one cut short by a failed copy), fails the stream rather than ending it.
+ *
+ * @return The next character, or eof at the end of the file.
+ */
+GzipInputBuffer::int_type GzipInputBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type( *gptr() );
+    }
+    if (!file_) {
+        return traits_type::eof();
+    }
+
+    while (true) {
+        if (zs_.avail_in == 0) {
+            size_t _read = endOfFile_ ? 0 : std::fread( in_.data(), 1, in_.size(), file_ );
+            if (_read == 0) {
+                if (!endOfFile_ && (inMember_ || std::ferror( file_ ))) {
+                    fail( inMember_ ? "Compressed input ends within a gzip member" : "Error reading compressed input" );
+                }
+                endOfFile_ = true;
+                return traits_type::eof();
+            }
+            zs_.next_in = in_.data();
+            zs_.avail_in = static_cast<uInt>( _read );
+        }
+
+        zs_.next_out = reinterpret_cast<Bytef*>( out_.data() );
+        zs_.avail_out = static_cast<uInt>( out_.size() );
+        int _result = inflate( &zs_, Z_NO_FLUSH );
+        if (_result == Z_STREAM_END) {
+            // another gzip member may follow
+            inflateReset( &zs_ );
+            inMember_ = false;
+        }
+        else if (_result == Z_OK || _result == Z_BUF_ERROR) {
+            inMember_ = true;
+        }
+        else {
+            fail( std::string{ "Corrupt compressed input" } + (zs_.msg ? ": " : "") + (zs_.msg ? zs_.msg : "") );
+        }
+
+        size_t _produced = out_.size() - zs_.avail_out;
+        if (_produced > 0) {
+            setg( out_.data(), out_.data(), out_.data() + _produced );
+            return traits_type::to_int_type( *gptr() );
+        }
+    }
+}
+
+void GzipInputBuffer::fail( const std::string& message ) {
+    std::cerr << message << std::endl;
+    endOfFile_ = true;
+    zs_.avail_in = 0;
+    throw std::ios_base::failure( message );
+}
+
+void GzipOfstream::open( const std::string& path ) {
+    if (buffer_.open( path )) {
+        clear();
+    }
+    else {
+        setstate( std::ios_base::failbit );
+    }
+}
+
+void GzipOfstream::close() {
+    if (!buffer_.close()) {
+        setstate( std::ios_base::badbit );
+    }
+}
+
+void GzipIfstream::open( const std::string& path ) {
+    if (buffer_.open( path )) {
+        clear();
+    }
+    else {
+        setstate( std::ios_base::failbit );
+    }
+}
+
+namespace GzipStream {
+    /**
+     * Opens a file for writing: a GzipOfstream if its name ends in ".gz", an ofstream otherwise.
+     *
+     * @param path The path of the file.
+     * @return The stream, which is in a failed state if the file could not be opened.
+     */
+    std::unique_ptr<std::ostream> open_output( const std::string& path ) {
+        if (is_compressed( path )) {
+            return std::make_unique<GzipOfstream>( path );
+        }
+        return std::make_unique<std::ofstream>( path, std::ios::out );
+    }
+
+    /**
+     * Opens a file for reading: a GzipIfstream if its name ends in ".gz", an ifstream otherwise.
+     *
+     * @param path The path of the file.
+     * @return The stream, which is in a failed state if the file could not be opened.
+     */
+    std::unique_ptr<std::istream> open_input( const std::string& path ) {
+        if (is_compressed( path )) {
+            return std::make_unique<GzipIfstream>( path );
+        }
+        return std::make_unique<std::ifstream>( path );
+    }
+
+    /**
+     * Closes a stream opened by open_output, so that a failure to write what was still buffered (or, for a gzip
+     *  file, the last block and the trailer) is seen rather than lost when the stream is destroyed.
+     *
+     * @param os The stream.
+     * @param path The path of the file, for the error message.
+     * @return `true` if everything written reached the file, `false` otherwise.
+     */
+    bool close_output( std::ostream& os, const std::string& path ) {
+        if (auto* _gzip = dynamic_cast<GzipOfstream*>( &os )) {
+            _gzip->close();
+        }
+        else if (auto* _file = dynamic_cast<std::ofstream*>( &os )) {
+            _file->close();
+        }
+        if (!os) {
+            std::cerr << "Error writing output file: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Reads a whole file into a string, decompressing it if its name ends in ".gz".
+     *
+     * @param path The path of the file.
+     * @param contents The string to fill.
+     * @return `true` if the file was read, `false` otherwise (including a compressed file that is cut short).
+     */
+    bool read_file( const std::string& path, std::string& contents ) {
+        auto _input = open_input( path );
+        if (!*_input) {
+            std::cerr << "Error opening file: " << path << std::endl;
+            return false;
+        }
+
+        // read() (unlike inserting the stream buffer into another stream) sets the bad state if the buffer fails
+        contents.clear();
+        char _block[4096];
+        while (_input->read( _block, sizeof(_block) ) || _input->gcount() > 0) {
+            contents.append( _block, _input->gcount() );
+        }
+        if (_input->bad()) {
+            std::cerr << "Error reading file: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,180 @@
+#include "Harmony.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+/**
+ * Builds the table of labels: each triad and seventh chord is entered on each of the twelve roots, then each of them
+ *  that has a perfect fifth is entered without it, so a set that spells a complete chord keeps that label. Only
+ *  empty entries are filled, so of the roots of a symmetric chord the lowest is entered.
+ *
+ * @return The root and quality of each set of pitch classes.
+ */
+consteval std::array<Harmony::Entry, Harmony::TABLE_SIZE> Harmony::make_table() {
+    struct Template {
+        uint16_t intervals;     // bit n for n semitones above the root
+        Quality quality;
+    };
+    constexpr uint16_t ROOT = 1 << 0;
+    constexpr uint16_t MINOR_THIRD = 1 << 3;
+    constexpr uint16_t MAJOR_THIRD = 1 << 4;
+    constexpr uint16_t DIMINISHED_FIFTH = 1 << 6;
+    constexpr uint16_t FIFTH = 1 << 7;
+    constexpr uint16_t AUGMENTED_FIFTH = 1 << 8;
+    constexpr uint16_t DIMINISHED_SEVENTH = 1 << 9;
+    constexpr uint16_t MINOR_SEVENTH = 1 << 10;
+    constexpr uint16_t MAJOR_SEVENTH = 1 << 11;
+    constexpr Template _templates[] = {
+        { ROOT | MAJOR_THIRD | FIFTH, MAJOR },
+        { ROOT | MINOR_THIRD | FIFTH, MINOR },
+        { ROOT | MINOR_THIRD | DIMINISHED_FIFTH, DIMINISHED },
+        { ROOT | MAJOR_THIRD | AUGMENTED_FIFTH, AUGMENTED },
+        { ROOT | MAJOR_THIRD | FIFTH | MINOR_SEVENTH, DOMINANT_7 },
+        { ROOT | MAJOR_THIRD | FIFTH | MAJOR_SEVENTH, MAJOR_7 },
+        { ROOT | MINOR_THIRD | FIFTH | MINOR_SEVENTH, MINOR_7 },
+        { ROOT | MINOR_THIRD | DIMINISHED_FIFTH | MINOR_SEVENTH, HALF_DIMINISHED_7 },
+        { ROOT | MINOR_THIRD | DIMINISHED_FIFTH | DIMINISHED_SEVENTH, DIMINISHED_7 },
+    };
+
+    std::array<Entry, TABLE_SIZE> _table{};
+    auto _enter = [&_table]( uint16_t intervals, Quality quality ) {
+        for (uint8_t _root = 0; _root < 12; _root++) {
+            const uint16_t _set = ((intervals << _root) | (intervals >> (12 - _root))) & 0xfff;
+            if (_table[_set].quality == NONE) {
+                _table[_set] = Entry{ _root, quality };
+            }
+        }
+    };
+    for (const Template& _template : _templates) {
+        _enter( _template.intervals, _template.quality );
+    }
+    for (const Template& _template : _templates) {
+        if (_template.intervals & FIFTH) {
+            _enter( _template.intervals & ~FIFTH, _template.quality );
+        }
+    }
+    return _table;
+}
+
+const std::array<Harmony::Entry, Harmony::TABLE_SIZE> Harmony::table_ = Harmony::make_table();
+
+/**
+ * Collects the pitch classes a chord sounds, tied notes included, and finds its bass.
+ *
+ * @param chord The chord.
+ * @param bass Set to the pitch class of the lowest pitch sounding, or -1 if every voice rests.
+ * @return The set of pitch classes, bit p for pitch class p.
+ */
+uint16_t Harmony::pitch_classes( const Chord& chord, int& bass ) {
+    uint16_t _set{0};
+    int _lowest{128};
+    for (const Note& _note : chord.get_notes()) {
+        const int _pitch = _note.get_midi_pitch();
+        if (_pitch > 0) {
+            _set |= 1 << (_pitch % 12);
+            _lowest = std::min( _lowest, _pitch );
+        }
+    }
+    bass = (_lowest < 128) ? _lowest % 12 : -1;
+    return _set;
+}
+
+/**
+ * Labels a set of pitch classes: looks up its root and quality, and finds the inversion from the interval of the
+ *  bass above the root. The root of an augmented triad or diminished seventh is taken to be the bass.
+ *
+ * @param pitchClasses The set of pitch classes, bit p for pitch class p.
+ * @param bass The pitch class of the bass, which must be in the set.
+ * @return The label, with quality NONE if the set is not a chord in the table.
+ */
+Harmony::Label Harmony::label( uint16_t pitchClasses, int bass ) {
+    const Entry& _entry = table_[pitchClasses & 0xfff];
+    Label _label{ _entry.root, _entry.quality, 0 };
+    if (_label.quality == NONE) {
+        return _label;
+    }
+    if (_label.quality == AUGMENTED || _label.quality == DIMINISHED_7) {
+        _label.root = static_cast<uint8_t>( bass );
+        return _label;
+    }
+
+    // by the interval above the root: a third (3 or 4 semitones), a fifth (6 to 8) or a seventh (9 to 11)
+    static constexpr uint8_t _inversions[12] = { 0, 0, 0, 1, 1, 0, 2, 2, 2, 3, 3, 3 };
+    _label.inversion = _inversions[(bass - _label.root + 12) % 12];
+    return _label;
+}
+
+Harmony::Label Harmony::label( const Chord& chord ) {
+    int _bass;
+    const uint16_t _set = pitch_classes( chord, _bass );
+    return label( _set, _bass );
+}
+
+/**
+ * Returns the chord symbol of a chord: its root, the suffix of its quality, and for an inversion a slash and the
+ *  bass, e.g. "G7/B"; or NONE_STR if the chord has no label.
+ *
+ * @param chord The chord.
+ * @return The chord symbol.
+ */
+std::string Harmony::to_string( const Chord& chord ) {
+    int _bass;
+    const uint16_t _set = pitch_classes( chord, _bass );
+    const Label _label = label( _set, _bass );
+    if (_label.quality == NONE) {
+        return NONE_STR;
+    }
+
+    std::string _symbol = spell( chord, _label.root ) + QUALITY_SUFFIXES[_label.quality];
+    if (_label.inversion) {
+        _symbol += '/' + spell( chord, _bass );
+    }
+    return _symbol;
+}
+
+/**
+ * Returns a line with the header of a part and, after it, the chord symbol of each of its chords and each of its
+ *  markers, separated by spaces. Notes (in a part that was not combined) are written as NONE_STR.
+ *
+ * @param part The part.
+ * @return The line.
+ */
+std::string Harmony::to_string( const Part& part ) {
+    std::ostringstream _os;
+    _os << part.get_header();
+    for (const auto& _encoding : part.get_encodings()) {
+        _os << ' ';
+        if (_encoding->is_chord()) {
+            _os << to_string( static_cast<const Chord&>( *_encoding ) );
+        }
+        else if (_encoding->is_marker()) {
+            _os << _encoding->to_string();
+        }
+        else {
+            _os << NONE_STR;
+        }
+    }
+    return _os.str();
+}
+
+/**
+ * Spells a pitch class as the first voice of a chord with that pitch class spells it: its letter, then a sharp or
+ *  flat for each semitone it is raised or lowered.
+ *
+ * @param chord The chord.
+ * @param pitchClass The pitch class, which a voice of the chord must have.
+ * @return The spelling, e.g. "F#" or "Bb".
+ */
+std::string Harmony::spell( const Chord& chord, int pitchClass ) {
+    for (const Note& _note : chord.get_notes()) {
+        const int _pitch = _note.get_midi_pitch();
+        if (_pitch > 0 && _pitch % 12 == pitchClass) {
+            const int _accidental = _note.get_accidental();
+            return std::string( 1, _note.get_pitch() )
+                + std::string( std::abs( _accidental ), _accidental > 0 ? '#' : 'b' );
+        }
+    }
+    return NONE_STR;
+}
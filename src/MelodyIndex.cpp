@@ -0,0 +1,400 @@
+#include "MelodyIndex.h"
+#include "GzipStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * Maps an index file and checks that its sections lie within it.
+ *
+ * @param path The path of the index file.
+ * @return `true` if the index was mapped, `false` otherwise.
+ */
+bool MelodyIndex::open( const std::string& path ) {
+    close();
+
+    int _fd = ::open( path.c_str(), O_RDONLY );
+    if (_fd < 0) {
+        std::cerr << "Error opening melody index: " << path << std::endl;
+        return false;
+    }
+
+    struct stat _stat;
+    if (fstat( _fd, &_stat ) != 0 || static_cast<size_t>( _stat.st_size ) < sizeof(FileHeader)) {
+        std::cerr << "Not a melody index: " << path << std::endl;
+        ::close( _fd );
+        return false;
+    }
+
+    size_ = _stat.st_size;
+    void* _data = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, _fd, 0 );
+    ::close( _fd );
+    if (_data == MAP_FAILED) {
+        std::cerr << "Failed to map melody index: " << path << std::endl;
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const char*>( _data );
+    header_ = reinterpret_cast<const FileHeader*>( data_ );
+
+    auto _fits = [this]( uint64_t offset, uint64_t count, size_t size ) {
+        return offset % ALIGNMENT == 0 && offset <= size_ && count <= (size_ - offset) / size;
+    };
+    if (std::memcmp( header_->magic, MAGIC, sizeof(MAGIC) ) != 0 || header_->version != VERSION
+            || header_->ngram == 0
+            || !_fits( header_->partsOffset, header_->partCount, sizeof(PartEntry) )
+            || !_fits( header_->symbolsOffset, header_->noteCount, sizeof(uint32_t) )
+            || !_fits( header_->locationsOffset, header_->noteCount, sizeof(Location) )
+            || !_fits( header_->keysOffset, header_->keyCount, sizeof(uint64_t) )
+            || !_fits( header_->startsOffset, header_->keyCount + 1, sizeof(uint32_t) )
+            || !_fits( header_->postingsOffset, header_->postingCount, sizeof(uint32_t) )) {
+        std::cerr << "Not a melody index: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    parts_ = reinterpret_cast<const PartEntry*>( data_ + header_->partsOffset );
+    symbols_ = reinterpret_cast<const uint32_t*>( data_ + header_->symbolsOffset );
+    locations_ = reinterpret_cast<const Location*>( data_ + header_->locationsOffset );
+    keys_ = reinterpret_cast<const uint64_t*>( data_ + header_->keysOffset );
+    starts_ = reinterpret_cast<const uint32_t*>( data_ + header_->startsOffset );
+    postings_ = reinterpret_cast<const uint32_t*>( data_ + header_->postingsOffset );
+    return true;
+}
+
+void MelodyIndex::close() {
+    if (data_) {
+        munmap( const_cast<char*>( data_ ), size_ );
+    }
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+}
+
+/**
+ * Finds the longest span of the query that also occurs in the index. Each n-gram of the query is looked up, and
+ *  each of its postings is extended forward for as long as the melodies agree. A posting whose previous note also
+ *  agrees with the query's is skipped, since the span through it was already extended from an earlier n-gram.
+ *
+ * @param query The melody to look for.
+ * @param excludeSameId Whether to ignore melodies of the index with the query's ID.
+ * @return The longest match; its span counts the note before its first interval.
+ */
+MelodyIndex::Match MelodyIndex::longest_match( const Melody& query, bool excludeSameId ) const {
+    Match _best;
+    size_t _ngram = header_->ngram;
+    const uint32_t* _query = query.symbols.data();
+    size_t _queryLength = query.symbols.size();
+
+    for (size_t _q = 0; _q + _ngram <= _queryLength; _q++) {
+        uint64_t _key;
+        if (!gram_key( _query + _q, _ngram, _key )) {
+            continue;
+        }
+        const uint64_t* _found = std::lower_bound( keys_, keys_ + header_->keyCount, _key );
+        if (_found == keys_ + header_->keyCount || *_found != _key) {
+            continue;
+        }
+
+        size_t _k = _found - keys_;
+        for (uint32_t _p = starts_[_k]; _p < starts_[_k + 1]; _p++) {
+            uint64_t _note = postings_[_p];
+            size_t _part = part_of( _note );
+            const PartEntry& _entry = parts_[_part];
+            if (excludeSameId && query.id.compare( 0, sizeof(_entry.id) - 1, _entry.id ) == 0) {
+                continue;
+            }
+            if (_q > 0 && _note > _entry.firstNote && _query[_q - 1] == symbols_[_note - 1]
+                    && is_comparable( _query[_q - 1] )) {
+                continue;
+            }
+
+            size_t _length{0};
+            uint64_t _end = _entry.firstNote + _entry.notes;
+            while (_q + _length < _queryLength && _note + _length < _end
+                    && _query[_q + _length] == symbols_[_note + _length] && is_comparable( _query[_q + _length] )) {
+                _length++;
+            }
+            // a shorter agreement is a collision of keys
+            if (_length >= _ngram && _length + 1 > _best.notes) {
+                _best.notes = _length + 1;
+                _best.part = _part;
+                _best.start = _note - _entry.firstNote - 1;
+                _best.queryStart = _q - 1;
+            }
+        }
+    }
+    return _best;
+}
+
+size_t MelodyIndex::part_of( uint64_t note ) const {
+    const PartEntry* _next = std::upper_bound( parts_, parts_ + header_->partCount, note,
+        []( uint64_t value, const PartEntry& entry ) { return value < entry.firstNote; } );
+    return (_next - parts_) - 1;
+}
+
+/**
+ * Extracts the melodies of a part. A note tied from the previous note lengthens it; a rest ends the melody so far,
+ *  and the next note starts again without an interval. Markers are skipped.
+ *
+ * @param part The part.
+ * @param melodies The vector to append the melodies to.
+ */
+void MelodyIndex::extract_melodies( const Part& part, std::vector<Melody>& melodies ) {
+    size_t _voices{1};
+    bool _chords{false};
+    for (const auto& _encoding : part.get_encodings()) {
+        if (_encoding->is_chord()) {
+            _voices = static_cast<const Chord*>( _encoding.get() )->get_notes().size();
+            _chords = true;
+            break;
+        }
+    }
+
+    for (size_t _voice = 0; _voice < _voices; _voice++) {
+        // the notes struck, with their sounding durations
+        struct Struck {
+            int pitch;
+            unsigned int duration;
+            Location location;
+        };
+        std::vector<Struck> _struck;
+        for (const auto& _encoding : part.get_encodings()) {
+            const Note* _note{nullptr};
+            if (_encoding->is_note()) {
+                _note = static_cast<const Note*>( _encoding.get() );
+            }
+            else if (_encoding->is_chord()) {
+                const auto& _notes = static_cast<const Chord*>( _encoding.get() )->get_notes();
+                _note = _voice < _notes.size() ? &_notes[_voice] : nullptr;
+            }
+            if (!_note) {
+                continue;
+            }
+
+            int _pitch = _note->get_midi_pitch();
+            if (_note->get_tied() && !_struck.empty() && _struck.back().pitch == _pitch) {
+                _struck.back().duration += _encoding->get_duration();
+            }
+            else if (_pitch != 0 || _struck.empty() || _struck.back().pitch != 0) {
+                _struck.push_back( { _pitch, _encoding->get_duration(), {
+                    static_cast<uint16_t>( _encoding->get_measure_number() ),
+                    static_cast<uint16_t>( _encoding->get_tick_number() ) } } );
+            }
+        }
+
+        Melody _melody;
+        _melody.id = part.get_id();
+        _melody.partName = _chords ? part.get_part_name() + ":" + std::to_string( _voice + 1 ) : part.get_part_name();
+        _melody.subBeats = part.get_sub_beats();
+        int _previous{0};
+        for (const Struck& _note : _struck) {
+            if (_note.pitch != 0) {
+                uint32_t _interval = _previous == 0 ? NO_INTERVAL
+                    : static_cast<uint32_t>( std::clamp( _note.pitch - _previous, -126, 126 ) + 128 );
+                uint32_t _duration = std::min<uint32_t>( _note.duration * TICKS_PER_BEAT / _melody.subBeats,
+                    0xffffff );
+                _melody.symbols.push_back( (_interval << 24) | _duration );
+                _melody.locations.push_back( _note.location );
+            }
+            _previous = _note.pitch;
+        }
+        melodies.push_back( std::move( _melody ) );
+    }
+}
+
+/**
+ * Reads a file of encodings and extracts the melodies of every line, in order.
+ *
+ * @param path The path of the file of encodings.
+ * @param pool The pool to parse on.
+ * @param melodies The vector to append the melodies to.
+ * @return `true` if every line was read, `false` otherwise.
+ */
+bool MelodyIndex::read_melodies( const std::string& path, ThreadPool& pool, std::vector<Melody>& melodies ) {
+    auto _file = GzipStream::open_input( path );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << path << std::endl;
+        return false;
+    }
+    std::vector<std::string> _lines;
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        if (!_line.empty()) {
+            _lines.push_back( std::move( _line ) );
+        }
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << path << std::endl;
+        return false;
+    }
+
+    auto _partials = pool.map_ranges( _lines.size(), [&_lines]( size_t first, size_t last ) {
+        std::pair<bool, std::vector<Melody>> _result{ true, {} };
+        for (size_t _l = first; _l < last; _l++) {
+            Part _part;
+            if (!_part.parse_encoding( _lines[_l] )) {
+                _result.first = false;
+                break;
+            }
+            extract_melodies( _part, _result.second );
+        }
+        return _result;
+    } );
+
+    bool _ok{true};
+    for (auto& [_parsed, _melodies] : _partials) {
+        _ok = _ok && _parsed;
+        std::move( _melodies.begin(), _melodies.end(), std::back_inserter( melodies ) );
+    }
+    if (!_ok) {
+        std::cerr << "Unable to read the encodings in " << path << std::endl;
+    }
+    return _ok;
+}
+
+// 64-bit FNV-1a over the symbols, finished with the MurmurHash3 finalizer
+bool MelodyIndex::gram_key( const uint32_t* symbols, size_t ngram, uint64_t& key ) {
+    key = 14695981039346656037ull;
+    for (size_t _i = 0; _i < ngram; _i++) {
+        if (!is_comparable( symbols[_i] )) {
+            return false;
+        }
+        for (int _byte = 0; _byte < 4; _byte++) {
+            key ^= (symbols[_i] >> (8 * _byte)) & 0xff;
+            key *= 1099511628211ull;
+        }
+    }
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return true;
+}
+
+/**
+ * Writes the index. The (key, note) pair of every n-gram is collected on the pool, one contiguous range of melodies
+ *  per thread, and the pairs are sorted so that each key's postings are contiguous and in corpus order.
+ *
+ * @param path The path of the index file.
+ * @param ngram The symbols per n-gram.
+ * @param pool The pool to collect n-grams on.
+ * @return `true` if the index was written, `false` otherwise.
+ */
+bool MelodyIndexWriter::write( const std::string& path, size_t ngram, ThreadPool& pool ) {
+    std::vector<uint64_t> _firstNotes;
+    uint64_t _noteCount{0};
+    for (const auto& _melody : melodies_) {
+        _firstNotes.push_back( _noteCount );
+        _noteCount += _melody.symbols.size();
+    }
+    if (_noteCount > UINT32_MAX) {
+        std::cerr << "Too many notes for a melody index: " << _noteCount << std::endl;
+        return false;
+    }
+
+    auto _partials = pool.map_ranges( melodies_.size(), [this, &_firstNotes, ngram]( size_t first, size_t last ) {
+        std::vector<std::pair<uint64_t, uint32_t>> _grams;
+        for (size_t _m = first; _m < last; _m++) {
+            const auto& _symbols = melodies_[_m].symbols;
+            for (size_t _i = 0; _i + ngram <= _symbols.size(); _i++) {
+                uint64_t _key;
+                if (MelodyIndex::gram_key( _symbols.data() + _i, ngram, _key )) {
+                    _grams.emplace_back( _key, static_cast<uint32_t>( _firstNotes[_m] + _i ) );
+                }
+            }
+        }
+        return _grams;
+    } );
+    std::vector<std::pair<uint64_t, uint32_t>> _grams;
+    for (const auto& _part : _partials) {
+        _grams.insert( _grams.end(), _part.begin(), _part.end() );
+    }
+    std::sort( _grams.begin(), _grams.end() );
+
+    std::vector<uint64_t> _keys;
+    std::vector<uint32_t> _starts;
+    std::vector<uint32_t> _postings;
+    for (size_t _i = 0; _i < _grams.size(); _i++) {
+        if (_i == 0 || _grams[_i].first != _grams[_i - 1].first) {
+            _keys.push_back( _grams[_i].first );
+            _starts.push_back( static_cast<uint32_t>( _i ) );
+        }
+        _postings.push_back( _grams[_i].second );
+    }
+    _starts.push_back( static_cast<uint32_t>( _postings.size() ) );
+
+    std::ofstream _file{ path, std::ios::out | std::ios::binary };
+    if (!_file) {
+        std::cerr << "Failed to open melody index: " << path << std::endl;
+        return false;
+    }
+
+    MelodyIndex::FileHeader _header{};
+    std::memcpy( _header.magic, MelodyIndex::MAGIC, sizeof(MelodyIndex::MAGIC) );
+    _header.version = MelodyIndex::VERSION;
+    _header.ngram = ngram;
+    _header.partCount = melodies_.size();
+    _header.noteCount = _noteCount;
+    _header.keyCount = _keys.size();
+    _header.postingCount = _postings.size();
+    _file.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    pad_to_alignment( _file );
+
+    _header.partsOffset = _file.tellp();
+    for (size_t _m = 0; _m < melodies_.size(); _m++) {
+        MelodyIndex::PartEntry _entry{};
+        _entry.firstNote = _firstNotes[_m];
+        _entry.notes = melodies_[_m].symbols.size();
+        _entry.subBeats = melodies_[_m].subBeats;
+        std::strncpy( _entry.id, melodies_[_m].id.c_str(), sizeof(_entry.id) - 1 );
+        std::strncpy( _entry.part, melodies_[_m].partName.c_str(), sizeof(_entry.part) - 1 );
+        _file.write( reinterpret_cast<const char*>( &_entry ), sizeof(_entry) );
+    }
+    pad_to_alignment( _file );
+
+    _header.symbolsOffset = _file.tellp();
+    for (const auto& _melody : melodies_) {
+        _file.write( reinterpret_cast<const char*>( _melody.symbols.data() ), _melody.symbols.size() * sizeof(uint32_t) );
+    }
+    pad_to_alignment( _file );
+
+    _header.locationsOffset = _file.tellp();
+    for (const auto& _melody : melodies_) {
+        _file.write( reinterpret_cast<const char*>( _melody.locations.data() ),
+            _melody.locations.size() * sizeof(MelodyIndex::Location) );
+    }
+    pad_to_alignment( _file );
+
+    _header.keysOffset = _file.tellp();
+    _file.write( reinterpret_cast<const char*>( _keys.data() ), _keys.size() * sizeof(uint64_t) );
+    pad_to_alignment( _file );
+    _header.startsOffset = _file.tellp();
+    _file.write( reinterpret_cast<const char*>( _starts.data() ), _starts.size() * sizeof(uint32_t) );
+    pad_to_alignment( _file );
+    _header.postingsOffset = _file.tellp();
+    _file.write( reinterpret_cast<const char*>( _postings.data() ), _postings.size() * sizeof(uint32_t) );
+
+    _file.seekp( 0 );
+    _file.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    if (!_file) {
+        std::cerr << "Failed to write melody index: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Pads the file with zeros so that the next section starts on an ALIGNMENT boundary.
+ */
+void MelodyIndexWriter::pad_to_alignment( std::ofstream& file ) {
+    static const char _zeros[MelodyIndex::ALIGNMENT] = {};
+    size_t _remainder = static_cast<size_t>( file.tellp() ) % MelodyIndex::ALIGNMENT;
+    if (_remainder) {
+        file.write( _zeros, MelodyIndex::ALIGNMENT - _remainder );
+    }
+}
@@ -0,0 +1,337 @@
+#include "MidiFile.h"
+
+#include <algorithm>
+#include <array>
+#include <fcntl.h>
+#include <iostream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Maps a MIDI file into memory and reads its events. The notes are copied out of the mapping, which is released
+ *  before returning.
+ *
+ * @param path The path of the MIDI file.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool MidiFile::open( const std::string& path ) {
+    *this = MidiFile{};
+
+    int _fd = ::open( path.c_str(), O_RDONLY );
+    if (_fd < 0) {
+        std::cerr << "Error opening MIDI file: " << path << std::endl;
+        return false;
+    }
+
+    struct stat _stat;
+    if (fstat( _fd, &_stat ) != 0 || _stat.st_size == 0) {
+        std::cerr << "Unable to determine size of MIDI file: " << path << std::endl;
+        ::close( _fd );
+        return false;
+    }
+
+    size_t _size = _stat.st_size;
+    void* _data = mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0 );
+    ::close( _fd );
+    if (_data == MAP_FAILED) {
+        std::cerr << "Failed to map MIDI file: " << path << std::endl;
+        return false;
+    }
+
+    bool _success = parse( static_cast<const unsigned char*>( _data ), _size );
+    munmap( _data, _size );
+    if (!_success) {
+        std::cerr << "Unable to read MIDI file: " << path << std::endl;
+    }
+    return _success;
+}
+
+/**
+ * Reads the header chunk and every track chunk of a MIDI file, then gathers the notes into voices: one per track
+ *  with notes or, if only one track has notes, one per channel with notes.
+ *
+ * @param data The bytes of the file.
+ * @param size The number of bytes.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool MidiFile::parse( const unsigned char* data, size_t size ) {
+    auto _read_u32 = [data]( size_t offset ) {
+        return static_cast<uint32_t>( data[offset] ) << 24 | static_cast<uint32_t>( data[offset + 1] ) << 16
+            | static_cast<uint32_t>( data[offset + 2] ) << 8 | data[offset + 3];
+    };
+    auto _read_u16 = [data]( size_t offset ) {
+        return static_cast<uint16_t>( data[offset] << 8 | data[offset + 1] );
+    };
+
+    // header chunk: "MThd", length, format, number of tracks, division
+    if (size < 14 || std::string_view{ reinterpret_cast<const char*>( data ), 4 } != "MThd") {
+        std::cerr << "Not a MIDI file" << std::endl;
+        return false;
+    }
+    uint32_t _headerLength = _read_u32( 4 );
+    uint16_t _format = _read_u16( 8 );
+    uint16_t _trackCount = _read_u16( 10 );
+    uint16_t _division = _read_u16( 12 );
+    if (_format > 1) {
+        std::cerr << "MIDI format " << _format << " is not supported" << std::endl;
+        return false;
+    }
+    if (_division == 0 || (_division & 0x8000)) {
+        std::cerr << "MIDI files timed in SMPTE frames are not supported" << std::endl;
+        return false;
+    }
+    ticksPerQuarter_ = _division;
+
+    // track chunks; chunks of other types are skipped
+    std::vector<std::vector<Voice>> _trackVoices;
+    size_t _position = 8 + static_cast<size_t>( _headerLength );
+    while (_trackVoices.size() < _trackCount && _position + 8 <= size) {
+        uint32_t _length = _read_u32( _position + 4 );
+        if (_position + 8 + _length > size) {
+            std::cerr << "MIDI track is truncated" << std::endl;
+            return false;
+        }
+        if (std::string_view{ reinterpret_cast<const char*>( data + _position ), 4 } == "MTrk") {
+            std::string _name;
+            std::vector<Voice> _channels( 16 );
+            if (!parse_track( data + _position + 8, _length, _name, _channels )) {
+                return false;
+            }
+            for (Voice& _channel : _channels) {
+                _channel.name = _name;
+            }
+
+            // the name of a first track without notes (the conductor track of format 1) is the title
+            bool _hasNotes = std::any_of( _channels.begin(), _channels.end(),
+                []( const Voice& channel ) { return !channel.notes.empty(); } );
+            if (_trackVoices.empty() && !_hasNotes) {
+                title_ = _name;
+            }
+            _trackVoices.push_back( std::move( _channels ) );
+        }
+        _position += 8 + static_cast<size_t>( _length );
+    }
+
+    // one voice per track, or per channel if there is only one track with notes
+    size_t _tracksWithNotes = std::count_if( _trackVoices.begin(), _trackVoices.end(),
+        []( const std::vector<Voice>& channels ) {
+            return std::any_of( channels.begin(), channels.end(), []( const Voice& channel ) {
+                return !channel.notes.empty();
+            } );
+        } );
+    for (auto& _channels : _trackVoices) {
+        if (_tracksWithNotes == 1) {
+            for (Voice& _channel : _channels) {
+                if (!_channel.notes.empty()) {
+                    voices_.push_back( std::move( _channel ) );
+                }
+            }
+        }
+        else {
+            Voice _voice;
+            for (Voice& _channel : _channels) {
+                _voice.name = _channel.name;
+                _voice.notes.insert( _voice.notes.end(), _channel.notes.begin(), _channel.notes.end() );
+            }
+            if (!_voice.notes.empty()) {
+                voices_.push_back( std::move( _voice ) );
+            }
+        }
+    }
+    if (voices_.empty()) {
+        std::cerr << "MIDI file has no notes" << std::endl;
+        return false;
+    }
+
+    // channels of one track share its name, so tell them apart by number
+    if (_tracksWithNotes == 1 && voices_.size() > 1) {
+        for (size_t _i = 0; _i < voices_.size(); _i++) {
+            voices_[_i].name = (voices_[_i].name.empty() ? "Voice " : voices_[_i].name + " ") + std::to_string( _i + 1 );
+        }
+    }
+
+    for (Voice& _voice : voices_) {
+        std::sort( _voice.notes.begin(), _voice.notes.end(), []( const Note& a, const Note& b ) {
+            return a.start != b.start ? a.start < b.start : a.pitch > b.pitch;
+        } );
+    }
+
+    // a file without a time signature is in 4/4
+    std::stable_sort( timeSignatures_.begin(), timeSignatures_.end(),
+        []( const TimeSignature& a, const TimeSignature& b ) { return a.tick < b.tick; } );
+    if (timeSignatures_.empty() || timeSignatures_.front().tick > 0) {
+        timeSignatures_.insert( timeSignatures_.begin(), TimeSignature{} );
+    }
+    return true;
+}
+
+/**
+ * Reads the events of one track. Notes are paired from note-on to note-off (or note-on with velocity 0) per channel
+ *  and pitch; the track name, time signatures and the earliest key signature are recorded, and other events are
+ *  skipped. A note still sounding at the end of the track ends there.
+ *
+ * @param data The bytes of the track, after its chunk header.
+ * @param size The number of bytes.
+ * @param name The string to fill with the track name.
+ * @param channels The voices to add the notes of each channel to (16 of them).
+ * @return `true` if the track was read, `false` otherwise.
+ */
+bool MidiFile::parse_track( const unsigned char* data, size_t size, std::string& name, std::vector<Voice>& channels ) {
+    const uint64_t NOT_SOUNDING = UINT64_MAX;
+    std::vector<std::array<uint64_t, 128>> _onsets( 16 );
+    for (auto& _channel : _onsets) {
+        _channel.fill( NOT_SOUNDING );
+    }
+
+    auto _end_note = [&]( int channel, int pitch, uint64_t tick ) {
+        uint64_t& _onset = _onsets[channel][pitch];
+        if (_onset != NOT_SOUNDING) {
+            channels[channel].notes.push_back( Note{ _onset, tick, pitch } );
+            _onset = NOT_SOUNDING;
+        }
+    };
+
+    uint64_t _tick{0};
+    size_t _position{0};
+    unsigned char _runningStatus{0};
+    while (_position < size) {
+        uint64_t _delta;
+        if (!read_variable_length( data, size, _position, _delta ) || _position >= size) {
+            std::cerr << "MIDI track is truncated" << std::endl;
+            return false;
+        }
+        _tick += _delta;
+
+        unsigned char _status = data[_position];
+        if (_status & 0x80) {
+            _position++;
+        }
+        else if (_runningStatus) {
+            _status = _runningStatus;   // running status: the data bytes follow directly
+        }
+        else {
+            std::cerr << "MIDI event without a status byte" << std::endl;
+            return false;
+        }
+
+        // meta events and system exclusive messages carry their own length
+        if (_status == 0xFF || _status == 0xF0 || _status == 0xF7) {
+            unsigned char _type = 0;
+            if (_status == 0xFF) {
+                if (_position >= size) {
+                    std::cerr << "MIDI track is truncated" << std::endl;
+                    return false;
+                }
+                _type = data[_position++];
+            }
+            uint64_t _length;
+            if (!read_variable_length( data, size, _position, _length ) || _position + _length > size) {
+                std::cerr << "MIDI track is truncated" << std::endl;
+                return false;
+            }
+            const unsigned char* _payload = data + _position;
+            _position += _length;
+            _runningStatus = 0;
+
+            if (_status != 0xFF) {
+                continue;
+            }
+            if (_type == 0x03) {
+                name.assign( reinterpret_cast<const char*>( _payload ), _length );
+            }
+            else if (_type == 0x58 && _length >= 2) {
+                timeSignatures_.push_back( TimeSignature{ _tick, _payload[0], static_cast<size_t>( 1 ) << _payload[1] } );
+            }
+            else if (_type == 0x59 && _length >= 2 && _tick < keyTick_) {
+                key_ = static_cast<int8_t>( _payload[0] );
+                minor_ = _payload[1] != 0;
+                keyTick_ = _tick;
+            }
+            else if (_type == 0x2F) {
+                break;
+            }
+            continue;
+        }
+
+        // channel messages have one or two data bytes
+        _runningStatus = _status;
+        size_t _dataBytes = ((_status & 0xF0) == 0xC0 || (_status & 0xF0) == 0xD0) ? 1 : 2;
+        if (_position + _dataBytes > size) {
+            std::cerr << "MIDI track is truncated" << std::endl;
+            return false;
+        }
+        int _channel = _status & 0x0F;
+        int _pitch = data[_position] & 0x7F;
+        int _velocity = _dataBytes > 1 ? data[_position + 1] & 0x7F : 0;
+        _position += _dataBytes;
+
+        if ((_status & 0xF0) == 0x90 && _velocity > 0) {
+            _end_note( _channel, _pitch, _tick );    // a repeated note-on ends the note already sounding
+            _onsets[_channel][_pitch] = _tick;
+        }
+        else if ((_status & 0xF0) == 0x80 || (_status & 0xF0) == 0x90) {
+            _end_note( _channel, _pitch, _tick );
+        }
+    }
+
+    for (int _channel = 0; _channel < 16; _channel++) {
+        for (int _pitch = 0; _pitch < 128; _pitch++) {
+            _end_note( _channel, _pitch, _tick );
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads a variable-length quantity: seven bits per byte, most significant first, with the top bit set on every byte
+ *  but the last.
+ *
+ * @param data The bytes of the track.
+ * @param size The number of bytes.
+ * @param position The position to read at, advanced past the quantity.
+ * @param value The value read.
+ * @return `true` if the quantity was read, `false` if it runs past the end of the track or is too long.
+ */
+bool MidiFile::read_variable_length( const unsigned char* data, size_t size, size_t& position, uint64_t& value ) {
+    value = 0;
+    for (size_t _i = 0; _i < 4 && position < size; _i++) {
+        unsigned char _byte = data[position++];
+        value = (value << 7) | (_byte & 0x7F);
+        if (!(_byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Finds the first onset of any note in the file.
+ *
+ * @return The tick of the first onset.
+ */
+uint64_t MidiFile::get_first_onset() const {
+    uint64_t _first{UINT64_MAX};
+    for (const Voice& _voice : voices_) {
+        if (!_voice.notes.empty()) {
+            _first = std::min( _first, _voice.notes.front().start );
+        }
+    }
+    return _first == UINT64_MAX ? 0 : _first;
+}
+
+/**
+ * Finds the last release of any note in the file.
+ *
+ * @return The tick of the last release.
+ */
+uint64_t MidiFile::get_last_release() const {
+    uint64_t _last{0};
+    for (const Voice& _voice : voices_) {
+        for (const Note& _note : _voice.notes) {
+            _last = std::max( _last, _note.end );
+        }
+    }
+    return _last;
+}
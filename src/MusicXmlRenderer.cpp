@@ -0,0 +1,386 @@
+#include "MusicXmlRenderer.h"
+
+#include <iostream>
+
+/**
+ * Lays out the parts of one chorale as voices divided into measures.
+ *
+ * The key, meter and grid are taken from the first part, and every part must use the same grid. A beat is written
+ *  as a quarter note, so the MusicXML divisions are the sub-beats per beat.
+ *
+ * @param parts The parts of the chorale, each holding separate notes or chords.
+ * @return `true` if the parts were laid out, `false` otherwise.
+ */
+bool MusicXmlRenderer::load( const std::vector<std::unique_ptr<Part>>& parts ) {
+    voices_.clear();
+    if (parts.empty()) {
+        std::cerr << "No parts to render" << std::endl;
+        return false;
+    }
+
+    const Part& _first = *parts[0];
+    id_ = _first.get_id();
+    key_ = _first.get_key();
+    mode_ = _first.get_mode();
+    beatsPerMeasure_ = _first.get_beats_per_measure();
+    subBeatsPerBeat_ = _first.get_sub_beats();
+    if (beatsPerMeasure_ == 0 || subBeatsPerBeat_ == 0) {
+        std::cerr << "Invalid meter for " << id_ << std::endl;
+        return false;
+    }
+
+    for (const auto& _part : parts) {
+        if (static_cast<size_t>( _part->get_sub_beats() ) != subBeatsPerBeat_) {
+            std::cerr << "Sub-beats of " << _part->get_part_name() << " do not match "
+                << _first.get_part_name() << " for " << id_ << std::endl;
+            return false;
+        }
+
+        size_t _firstVoice = voices_.size();
+        add_part( *_part );
+        if (voices_.size() == _firstVoice) {
+            std::cerr << "No notes in " << _part->get_part_name() << " for " << id_ << std::endl;
+            return false;
+        }
+    }
+
+    for (auto& _voice : voices_) {
+        mark_ties( _voice );
+    }
+    return true;
+}
+
+/**
+ * Adds the voices of a part. A part of separate notes is one voice; a combined part has one voice for each note of
+ *  its chords, named Soprano, Alto, Tenor and Bass if there are four.
+ *
+ * A new measure starts after each <EOM>. If the part has no <EOM> markers (e.g. it was written with --noEOM), it
+ *  is cut into measures of equal length instead. An <EOP> puts a fermata on the note before it.
+ *
+ * @param part The part to add.
+ */
+void MusicXmlRenderer::add_part( const Part& part ) {
+    static const char* _fourVoices[] = { "Soprano", "Alto", "Tenor", "Bass" };
+
+    size_t _firstVoice = voices_.size();
+    bool _hasEOM{false};
+
+    for (const auto& _encoding : part.get_encodings()) {
+        if (_encoding->is_marker()) {
+            if (_encoding->is_EOM()) {
+                _hasEOM = true;
+                for (size_t _v = _firstVoice; _v < voices_.size(); _v++) {
+                    voices_[_v].measures.emplace_back();
+                }
+            }
+            else if (_encoding->is_EOP()) {
+                for (size_t _v = _firstVoice; _v < voices_.size(); _v++) {
+                    auto& _measures = voices_[_v].measures;
+                    for (auto _it = _measures.rbegin(); _it != _measures.rend(); _it++) {
+                        if (!_it->empty()) {
+                            _it->back().fermata = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            continue;
+        }
+
+        // a note is one voice
+        if (_encoding->is_note()) {
+            if (voices_.size() == _firstVoice) {
+                voices_.push_back( Voice{ part.get_part_name(), std::vector<std::vector<VoiceNote>>( 1 ) } );
+            }
+            voices_.back().measures.back().push_back( VoiceNote{ static_cast<const Note&>( *_encoding ) } );
+            continue;
+        }
+
+        // a chord has a note for each voice
+        const auto& _notes = static_cast<const Chord&>( *_encoding ).get_notes();
+        if (voices_.size() == _firstVoice) {
+            for (size_t _v = 0; _v < _notes.size(); _v++) {
+                std::string _name = (_notes.size() == 4) ? _fourVoices[_v] : "Voice " + std::to_string( _v + 1 );
+                voices_.push_back( Voice{ _name, std::vector<std::vector<VoiceNote>>( 1 ) } );
+            }
+        }
+        if (voices_.size() - _firstVoice != _notes.size()) {
+            std::cerr << part.location_to_string( _encoding.get() ) << ": Chord has " << _notes.size()
+                << " notes; expected " << voices_.size() - _firstVoice << std::endl;
+            voices_.resize( _firstVoice );
+            return;
+        }
+
+        for (size_t _v = 0; _v < _notes.size(); _v++) {
+            auto& _measure = voices_[_firstVoice + _v].measures.back();
+            const Note& _note = _notes[_v];
+
+            // a continuation of the voice's previous note within the measure lengthens it
+            if (!_measure.empty() && _note.get_tied() && !_measure.back().fermata) {
+                Note& _previous = _measure.back().note;
+                if (_previous.get_pitch() == _note.get_pitch() && _previous.get_octave() == _note.get_octave()
+                        && _previous.get_accidental() == _note.get_accidental()) {
+                    _previous.set_duration( _previous.get_duration() + _note.get_duration() );
+                    continue;
+                }
+            }
+            _measure.push_back( VoiceNote{ _note } );
+        }
+    }
+
+    // the last <EOM> leaves an empty measure behind
+    for (size_t _v = _firstVoice; _v < voices_.size(); _v++) {
+        auto& _measures = voices_[_v].measures;
+        while (_measures.size() > 1 && _measures.back().empty()) {
+            _measures.pop_back();
+        }
+        if (!_hasEOM) {
+            split_measures( voices_[_v] );
+        }
+    }
+}
+
+/**
+ * Cuts a voice into measures of beatsPerMeasure_ beats. A note that crosses a barline is split, and the part after
+ *  the barline is tied from the part before it.
+ *
+ * @param voice The voice, whose notes are all in its first measure.
+ */
+void MusicXmlRenderer::split_measures( Voice& voice ) const {
+    const unsigned int _measureLength = beatsPerMeasure_ * subBeatsPerBeat_;
+    std::vector<VoiceNote> _notes = std::move( voice.measures.front() );
+    voice.measures.assign( 1, {} );
+
+    unsigned int _remaining{ _measureLength };
+    for (const VoiceNote& _voiceNote : _notes) {
+        unsigned int _duration = _voiceNote.note.get_duration();
+        bool _continued{false};
+        while (_duration > 0) {
+            VoiceNote _piece{ _voiceNote };
+            _piece.note.set_duration( std::min( _duration, _remaining ) );
+            if (_continued) {
+                _piece.note.set_tied( true );
+            }
+            _duration -= _piece.note.get_duration();
+            _remaining -= _piece.note.get_duration();
+            _piece.fermata = _voiceNote.fermata && _duration == 0;
+            voice.measures.back().push_back( _piece );
+            _continued = true;
+
+            if (_remaining == 0) {
+                voice.measures.emplace_back();
+                _remaining = _measureLength;
+            }
+        }
+    }
+
+    if (voice.measures.size() > 1 && voice.measures.back().empty()) {
+        voice.measures.pop_back();
+    }
+}
+
+/**
+ * Marks each note that the next note is tied to. A tie only joins two sounding notes; a rest, or a note that
+ *  follows a rest, is never tied.
+ *
+ * @param voice The voice to mark.
+ */
+void MusicXmlRenderer::mark_ties( Voice& voice ) {
+    VoiceNote* _previous = nullptr;
+    for (auto& _measure : voice.measures) {
+        for (auto& _voiceNote : _measure) {
+            bool _tied = _voiceNote.note.get_tied() && !_voiceNote.note.is_rest()
+                && _previous && !_previous->note.is_rest();
+            _voiceNote.note.set_tied( _tied );
+            if (_tied) {
+                _previous->tieStart = true;
+            }
+            _previous = &_voiceNote;
+        }
+    }
+}
+
+/**
+ * Writes the score: a part list naming each voice, then one MusicXML part per voice.
+ *
+ * @param os The stream to write to.
+ */
+void MusicXmlRenderer::write( std::ostream& os ) const {
+    XmlWriter _writer{ os };
+    _writer.declaration( DOCTYPE );
+    _writer.open( "score-partwise", { {"version", "3.1"} } );
+    _writer.element( "movement-title", id_ );
+
+    _writer.open( "part-list" );
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        std::string _id = "P" + std::to_string( _v + 1 );
+        _writer.open( "score-part", { {"id", _id} } );
+        _writer.element( "part-name", voices_[_v].name );
+        _writer.close();
+    }
+    _writer.close();
+
+    for (size_t _v = 0; _v < voices_.size(); _v++) {
+        write_part( _writer, voices_[_v], _v + 1 );
+    }
+    _writer.finish();
+}
+
+/**
+ * Writes one voice as a MusicXML part. The first measure carries the divisions, key, time and a clef chosen from
+ *  the voice's average pitch. A short first measure is an upbeat, numbered 0 and marked implicit.
+ *
+ * @param writer The writer to use.
+ * @param voice The voice to write.
+ * @param number The number of the part (origin 1).
+ */
+void MusicXmlRenderer::write_part( XmlWriter& writer, const Voice& voice, size_t number ) const {
+    std::string _id = "P" + std::to_string( number );
+    writer.open( "part", { {"id", _id} } );
+
+    // an incomplete first measure is an upbeat
+    unsigned int _firstLength{0};
+    for (const auto& _voiceNote : voice.measures.front()) {
+        _firstLength += _voiceNote.note.get_duration();
+    }
+    bool _upbeat = voice.measures.size() > 1 && _firstLength < beatsPerMeasure_ * subBeatsPerBeat_;
+
+    // clef from average pitch
+    long _pitchSum{0};
+    long _pitchCount{0};
+    for (const auto& _measure : voice.measures) {
+        for (const auto& _voiceNote : _measure) {
+            if (!_voiceNote.note.is_rest()) {
+                _pitchSum += _voiceNote.note.get_midi_pitch();
+                _pitchCount++;
+            }
+        }
+    }
+    long _averagePitch = _pitchCount ? _pitchSum / _pitchCount : 60;
+
+    for (size_t _m = 0; _m < voice.measures.size(); _m++) {
+        std::string _number = std::to_string( _upbeat ? _m : _m + 1 );
+        if (_upbeat && _m == 0) {
+            writer.open( "measure", { {"number", _number}, {"implicit", "yes"} } );
+        }
+        else {
+            writer.open( "measure", { {"number", _number} } );
+        }
+
+        if (_m == 0) {
+            writer.open( "attributes" );
+            writer.element( "divisions", static_cast<long>( subBeatsPerBeat_ ) );
+            writer.open( "key" );
+            writer.element( "fifths", key_ );
+            writer.element( "mode", mode_ == Part::Mode::MAJOR ? "major" : "minor" );
+            writer.close();
+            writer.open( "time" );
+            writer.element( "beats", static_cast<long>( beatsPerMeasure_ ) );
+            writer.element( "beat-type", 4 );
+            writer.close();
+            writer.open( "clef" );
+            writer.element( "sign", _averagePitch >= 52 ? "G" : "F" );
+            writer.element( "line", _averagePitch >= 52 ? 2 : 4 );
+            if (_averagePitch >= 52 && _averagePitch < 60) {
+                writer.element( "clef-octave-change", -1 );
+            }
+            writer.close();
+            writer.close();
+        }
+
+        for (const auto& _voiceNote : voice.measures[_m]) {
+            write_note( writer, _voiceNote );
+        }
+        writer.close();
+    }
+    writer.close();
+}
+
+/**
+ * Writes a note or rest.
+ *
+ * A note that is tied both from the previous note and to the next one gets its "start" tie first, since
+ *  Part::parse_xml() only reads the first <tie> of a note.
+ *
+ * @param writer The writer to use.
+ * @param voiceNote The note to write.
+ */
+void MusicXmlRenderer::write_note( XmlWriter& writer, const VoiceNote& voiceNote ) const {
+    const Note& _note = voiceNote.note;
+    writer.open( "note" );
+
+    if (_note.is_rest()) {
+        writer.empty( "rest" );
+    }
+    else {
+        writer.open( "pitch" );
+        writer.element( "step", std::string( 1, _note.get_pitch() ) );
+        if (_note.get_accidental()) {
+            writer.element( "alter", _note.get_accidental() );
+        }
+        writer.element( "octave", static_cast<long>( _note.get_octave() ) );
+        writer.close();
+    }
+    writer.element( "duration", static_cast<long>( _note.get_duration() ) );
+    if (voiceNote.tieStart) {
+        writer.empty( "tie", { {"type", "start"} } );
+    }
+    if (_note.get_tied()) {
+        writer.empty( "tie", { {"type", "stop"} } );
+    }
+
+    int _dots{0};
+    std::string _type = note_type( _note.get_duration(), _dots );
+    if (!_type.empty()) {
+        writer.element( "type", _type );
+        for (int _d = 0; _d < _dots; _d++) {
+            writer.empty( "dot" );
+        }
+    }
+
+    if (voiceNote.tieStart || _note.get_tied() || voiceNote.fermata) {
+        writer.open( "notations" );
+        if (voiceNote.tieStart) {
+            writer.empty( "tied", { {"type", "start"} } );
+        }
+        if (_note.get_tied()) {
+            writer.empty( "tied", { {"type", "stop"} } );
+        }
+        if (voiceNote.fermata) {
+            writer.empty( "fermata", { {"type", "upright"} } );
+        }
+        writer.close();
+    }
+    writer.close();
+}
+
+/**
+ * Finds the MusicXML note type for a duration, allowing one dot.
+ *
+ * @param duration The duration in sub-beats, where a beat is a quarter note.
+ * @param dots Set to the number of dots.
+ * @return The note type, e.g. "quarter", or an empty string if no single note has this duration.
+ */
+std::string MusicXmlRenderer::note_type( unsigned int duration, int& dots ) const {
+    // durations in 64ths of a quarter note
+    static const std::pair<unsigned int, const char*> _types[] = {
+        { 256, "whole" }, { 128, "half" }, { 64, "quarter" }, { 32, "eighth" },
+        { 16, "16th" }, { 8, "32nd" }, { 4, "64th" }
+    };
+
+    dots = 0;
+    if ((duration * 64) % subBeatsPerBeat_ != 0) {
+        return "";
+    }
+    unsigned int _length = duration * 64 / subBeatsPerBeat_;
+    for (const auto& [_typeLength, _name] : _types) {
+        if (_length == _typeLength) {
+            return _name;
+        }
+        if (_length * 2 == _typeLength * 3) {
+            dots = 1;
+            return _name;
+        }
+    }
+    return "";
+}
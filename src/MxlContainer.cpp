@@ -0,0 +1,209 @@
+#include "MxlContainer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <tinyxml2.h>
+#include <zlib.h>
+
+/**
+ * Inflates the root score of an .mxl archive.
+ *
+ * @param data The bytes of the archive.
+ * @param xml The string to fill with the MusicXML of the score.
+ * @return `true` if the score was extracted, `false` otherwise.
+ */
+bool MxlContainer::extract_score( std::string_view data, std::string& xml ) {
+    std::vector<Entry> _entries;
+    if (!read_directory( data, _entries )) {
+        return false;
+    }
+
+    std::string _rootPath = find_root_path( data, _entries );
+    auto _root = std::find_if( _entries.begin(), _entries.end(),
+        [&_rootPath]( const Entry& entry ) { return entry.name == _rootPath; } );
+    if (_rootPath.empty() || _root == _entries.end()) {
+        std::cerr << "No score found in compressed MusicXML archive" << (_rootPath.empty() ? "" : ": ")
+            << _rootPath << std::endl;
+        return false;
+    }
+    return extract( data, *_root, xml );
+}
+
+/**
+ * Reads the central directory of a zip archive, found through the end-of-central-directory record at the end of the
+ *  archive (which may be followed by a comment of up to 64K).
+ *
+ * @param data The bytes of the archive.
+ * @param entries The vector to fill with the entries of the archive.
+ * @return `true` if the directory was read, `false` otherwise.
+ */
+bool MxlContainer::read_directory( std::string_view data, std::vector<Entry>& entries ) {
+    const size_t END_RECORD_SIZE = 22;
+    const size_t MAX_COMMENT_SIZE = 0xFFFF;
+    if (data.size() < END_RECORD_SIZE) {
+        std::cerr << "Compressed MusicXML archive is truncated" << std::endl;
+        return false;
+    }
+
+    // find the end-of-central-directory record, searching back from the end of the archive
+    size_t _end = data.size() - END_RECORD_SIZE;
+    size_t _limit = _end > MAX_COMMENT_SIZE ? _end - MAX_COMMENT_SIZE : 0;
+    while (read_u32( data, _end ) != 0x06054b50) {
+        if (_end == _limit) {
+            std::cerr << "Compressed MusicXML archive has no central directory" << std::endl;
+            return false;
+        }
+        _end--;
+    }
+
+    uint16_t _count = read_u16( data, _end + 10 );
+    uint32_t _directorySize = read_u32( data, _end + 12 );
+    uint32_t _directoryOffset = read_u32( data, _end + 16 );
+    if (_count == 0xFFFF || _directoryOffset == 0xFFFFFFFF) {
+        std::cerr << "Zip64 archives are not supported" << std::endl;
+        return false;
+    }
+    if (static_cast<size_t>( _directoryOffset ) + _directorySize > _end) {
+        std::cerr << "Compressed MusicXML archive has a corrupt central directory" << std::endl;
+        return false;
+    }
+
+    // read one central directory header per entry
+    const size_t HEADER_SIZE = 46;
+    size_t _offset = _directoryOffset;
+    for (uint16_t _i = 0; _i < _count; _i++) {
+        if (_offset + HEADER_SIZE > _end || read_u32( data, _offset ) != 0x02014b50) {
+            std::cerr << "Compressed MusicXML archive has a corrupt central directory" << std::endl;
+            return false;
+        }
+
+        uint16_t _nameLength = read_u16( data, _offset + 28 );
+        uint16_t _extraLength = read_u16( data, _offset + 30 );
+        uint16_t _commentLength = read_u16( data, _offset + 32 );
+        if (_offset + HEADER_SIZE + _nameLength > _end) {
+            std::cerr << "Compressed MusicXML archive has a corrupt central directory" << std::endl;
+            return false;
+        }
+
+        Entry _entry;
+        _entry.method = read_u16( data, _offset + 10 );
+        _entry.crc = read_u32( data, _offset + 16 );
+        _entry.compressedSize = read_u32( data, _offset + 20 );
+        _entry.size = read_u32( data, _offset + 24 );
+        _entry.localHeaderOffset = read_u32( data, _offset + 42 );
+        _entry.name = data.substr( _offset + HEADER_SIZE, _nameLength );
+        entries.push_back( std::move( _entry ) );
+
+        _offset += HEADER_SIZE + _nameLength + _extraLength + _commentLength;
+    }
+    return true;
+}
+
+/**
+ * Extracts one entry of a zip archive. The sizes and checksum come from the central directory, so entries written
+ *  with a trailing data descriptor are read correctly. The sizes are checked against the archive before anything is
+ *  allocated: the compressed data must lie within it, and the uncompressed size must be one the compressed data
+ *  could inflate to and no more than MAX_ENTRY_SIZE, so a corrupt or hostile archive cannot ask for gigabytes.
+ *
+ * @param data The bytes of the archive.
+ * @param entry The entry to extract.
+ * @param contents The string to fill with the uncompressed contents of the entry.
+ * @return `true` if the entry was extracted and its checksum matched, `false` otherwise.
+ */
+bool MxlContainer::extract( std::string_view data, const Entry& entry, std::string& contents ) {
+    const size_t HEADER_SIZE = 30;
+    size_t _offset = entry.localHeaderOffset;
+    if (_offset + HEADER_SIZE > data.size() || read_u32( data, _offset ) != 0x04034b50) {
+        std::cerr << "Compressed MusicXML archive has a corrupt entry: " << entry.name << std::endl;
+        return false;
+    }
+
+    size_t _start = _offset + HEADER_SIZE + read_u16( data, _offset + 26 ) + read_u16( data, _offset + 28 );
+    if (_start + entry.compressedSize > data.size()) {
+        std::cerr << "Compressed MusicXML archive is truncated: " << entry.name << std::endl;
+        return false;
+    }
+    std::string_view _compressed = data.substr( _start, entry.compressedSize );
+    if (entry.size > MAX_ENTRY_SIZE
+            || (entry.method == 0 && entry.size != entry.compressedSize)
+            || (entry.method == 8 && entry.size > MAX_DEFLATE_RATIO * static_cast<size_t>( entry.compressedSize ))) {
+        std::cerr << "Compressed MusicXML archive has an entry of implausible size (" << entry.size << " bytes): "
+            << entry.name << std::endl;
+        return false;
+    }
+
+    switch (entry.method) {
+        case 0:
+            contents.assign( _compressed );
+            break;
+
+        case 8: {
+            // a raw deflate stream, without a zlib or gzip header
+            z_stream _zs{};
+            if (inflateInit2( &_zs, -15 ) != Z_OK) {
+                std::cerr << "Failed to start decompression of " << entry.name << std::endl;
+                return false;
+            }
+            contents.resize( entry.size );
+            _zs.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( _compressed.data() ) );
+            _zs.avail_in = static_cast<uInt>( _compressed.size() );
+            _zs.next_out = reinterpret_cast<Bytef*>( contents.data() );
+            _zs.avail_out = static_cast<uInt>( contents.size() );
+            int _result = inflate( &_zs, Z_FINISH );
+            inflateEnd( &_zs );
+            if (_result != Z_STREAM_END || _zs.total_out != entry.size) {
+                std::cerr << "Failed to decompress " << entry.name << std::endl;
+                return false;
+            }
+            break;
+        }
+
+        default:
+            std::cerr << "Unsupported compression method " << entry.method << " for " << entry.name << std::endl;
+            return false;
+    }
+
+    if (crc32( 0L, reinterpret_cast<const Bytef*>( contents.data() ), static_cast<uInt>( contents.size() ) )
+            != entry.crc) {
+        std::cerr << "Checksum mismatch in compressed MusicXML archive: " << entry.name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Finds the path of the root score: the first <rootfile> of META-INF/container.xml that is MusicXML. An archive
+ *  without a container falls back to its first .xml entry outside META-INF.
+ *
+ * @param data The bytes of the archive.
+ * @param entries The entries of the archive.
+ * @return The path of the score within the archive, or an empty string if there is none.
+ */
+std::string MxlContainer::find_root_path( std::string_view data, const std::vector<Entry>& entries ) {
+    auto _container = std::find_if( entries.begin(), entries.end(),
+        []( const Entry& entry ) { return entry.name == CONTAINER_PATH; } );
+
+    std::string _containerXml;
+    if (_container != entries.end() && extract( data, *_container, _containerXml )) {
+        tinyxml2::XMLDocument _doc;
+        if (_doc.Parse( _containerXml.c_str() ) == tinyxml2::XML_SUCCESS && _doc.RootElement()) {
+            tinyxml2::XMLElement* _rootfiles = _doc.RootElement()->FirstChildElement( "rootfiles" );
+            for (tinyxml2::XMLElement* _rootfile = _rootfiles ? _rootfiles->FirstChildElement( "rootfile" ) : nullptr;
+                    _rootfile; _rootfile = _rootfile->NextSiblingElement( "rootfile" )) {
+                // the root score may omit its media type; other rootfiles (e.g. a pdf rendering) carry theirs
+                const char* _mediaType = _rootfile->Attribute( "media-type" );
+                const char* _path = _rootfile->Attribute( "full-path" );
+                if (_path && (!_mediaType || std::string_view{ _mediaType }.ends_with( "musicxml+xml" ))) {
+                    return _path;
+                }
+            }
+        }
+    }
+
+    for (const Entry& _entry : entries) {
+        if (!_entry.name.starts_with( "META-INF/" ) && _entry.name.ends_with( ".xml" )) {
+            return _entry.name;
+        }
+    }
+    return "";
+}
@@ -0,0 +1,246 @@
+#include "NGramModel.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <future>
+#include <iostream>
+
+/**
+ * Splits a line into tokens and maps them to IDs. A header at the start of the line is skipped.
+ *
+ * @param line The line, as written by Part::to_string() or CombinedPart::to_string().
+ * @param grow Whether to add tokens that are not yet in the vocabulary; only one thread may grow the vocabulary.
+ * @return The IDs of the tokens.
+ */
+NGramModel::Sequence NGramModel::encode( std::string_view line, bool grow ) {
+    size_t _eoh = line.find( Part::EOH );
+    if (line.starts_with( Part::SOH ) && _eoh != std::string_view::npos) {
+        line.remove_prefix( _eoh + Part::EOH.size() );
+    }
+
+    Sequence _sequence;
+    std::string _token;
+    for (size_t _start = 0; _start < line.size(); ) {
+        size_t _end = std::min( line.find( ' ', _start ), line.size() );
+        if (_end > _start) {
+            _token.assign( line.substr( _start, _end - _start ) );
+            auto _it = ids_.find( _token );
+            if (_it != ids_.end()) {
+                _sequence.push_back( _it->second );
+            }
+            else if (grow) {
+                _sequence.push_back( ids_.emplace( _token, static_cast<uint32_t>( vocabularySize_++ ) ).first->second );
+            }
+            else {
+                _sequence.push_back( UNK );
+            }
+        }
+        _start = _end + 1;
+    }
+    return _sequence;
+}
+
+/**
+ * Trains the model in four passes over sharded tables:
+ *  - each thread counts the n-grams of every order in a contiguous range of sequences into its own shards;
+ *  - the threads' shards are merged, one shard per task;
+ *  - below the top order, the count of an n-gram is replaced by the number of distinct tokens seen before it (its
+ *     continuation count), unless it starts with the start token, which has nothing before it;
+ *  - the discount of each order is estimated from its counts of counts (D = n1 / (n1 + 2 n2)), and the totals
+ *     following each context are summed.
+ *
+ * @param sequences The training sequences, from encode().
+ * @param pool The pool to count on.
+ * @return `true` if the model was trained, `false` otherwise.
+ */
+bool NGramModel::train( const std::vector<Sequence>& sequences, ThreadPool& pool ) {
+    bits_ = std::max( 1u, static_cast<unsigned int>( std::bit_width( vocabularySize_ - 1 ) ) );
+    if (order_ == 0 || order_ * bits_ > 64) {
+        std::cerr << "An n-gram model of order " << order_ << " over " << vocabularySize_
+            << " tokens does not fit in 64-bit keys (the largest order is " << 64 / bits_ << ")" << std::endl;
+        return false;
+    }
+
+    // count
+    size_t _shards = pool.size();
+    counts_.assign( order_, std::vector<Table>( _shards ) );
+    std::vector<std::vector<std::vector<Table>>> _threadCounts = pool.map_ranges( sequences.size(),
+        [this, &sequences, _shards]( size_t first, size_t last ) {
+            std::vector<std::vector<Table>> _counts( order_, std::vector<Table>( _shards ) );
+            Sequence _padded;
+            for (size_t _q = first; _q < last; _q++) {
+                _padded.assign( order_ - 1, BOS );
+                _padded.insert( _padded.end(), sequences[_q].begin(), sequences[_q].end() );
+                _padded.push_back( EOS );
+                for (size_t _i = order_ - 1; _i < _padded.size(); _i++) {
+                    uint64_t _key{0};
+                    for (size_t _k = 1; _k <= order_; _k++) {
+                        _key |= static_cast<uint64_t>( _padded[_i + 1 - _k] ) << ((_k - 1) * bits_);
+                        _counts[_k - 1][shard_of( _key )][_key]++;
+                    }
+                }
+            }
+            return _counts;
+        } );
+
+    // merge
+    std::vector<std::future<void>> _merges;
+    for (size_t _k = 0; _k < order_; _k++) {
+        for (size_t _s = 0; _s < _shards; _s++) {
+            _merges.push_back( pool.submit( [this, &_threadCounts, _k, _s] {
+                Table& _merged = counts_[_k][_s];
+                _merged = std::move( _threadCounts[0][_k][_s] );
+                for (size_t _t = 1; _t < _threadCounts.size(); _t++) {
+                    for (const auto& [_key, _count] : _threadCounts[_t][_k][_s]) {
+                        _merged[_key] += _count;
+                    }
+                }
+            } ) );
+        }
+    }
+    for (auto& _merge : _merges) {
+        _merge.get();
+    }
+    _threadCounts.clear();
+
+    // replace the counts below the top order with continuation counts
+    std::vector<std::vector<Table>> _adjusted( order_ - 1, std::vector<Table>( _shards ) );
+    std::vector<std::future<void>> _adjustments;
+    for (size_t _order = 1; _order < order_; _order++) {
+        for (size_t _s = 0; _s < _shards; _s++) {
+            _adjustments.push_back( pool.submit( [this, &_adjusted, _order, _s, _shards] {
+                Table& _table = _adjusted[_order - 1][_s];
+                for (const auto& [_key, _count] : counts_[_order - 1][_s]) {
+                    if (first_token( _order, _key ) == BOS) {
+                        _table.emplace( _key, _count );
+                    }
+                }
+                for (size_t _from = 0; _from < _shards; _from++) {
+                    for (const auto& [_key, _count] : counts_[_order][_from]) {
+                        uint64_t _suffix = suffix( _order + 1, _key );
+                        if (first_token( _order, _suffix ) != BOS && shard_of( _suffix ) == _s) {
+                            _table[_suffix]++;
+                        }
+                    }
+                }
+            } ) );
+        }
+    }
+    for (auto& _adjustment : _adjustments) {
+        _adjustment.get();
+    }
+    for (size_t _order = 1; _order < order_; _order++) {
+        counts_[_order - 1] = std::move( _adjusted[_order - 1] );
+    }
+
+    // discounts and context totals
+    contexts_.assign( order_, {} );
+    discounts_.assign( order_, 0.5 );
+    for (size_t _order = 1; _order <= order_; _order++) {
+        uint64_t _n1{0};
+        uint64_t _n2{0};
+        auto& _contexts = contexts_[_order - 1];
+        for (const Table& _table : counts_[_order - 1]) {
+            for (const auto& [_key, _count] : _table) {
+                _n1 += _count == 1;
+                _n2 += _count == 2;
+                Context& _context = _contexts[_key >> bits_];
+                _context.total += _count;
+                _context.types++;
+            }
+        }
+        if (_n1 > 0 && _n2 > 0) {
+            discounts_[_order - 1] = static_cast<double>( _n1 ) / (_n1 + 2 * _n2);
+        }
+    }
+    return true;
+}
+
+/**
+ * Scores a set of sequences, one contiguous range per thread.
+ *
+ * @param sequences The sequences, from encode() without growing the vocabulary.
+ * @param pool The pool to score on.
+ * @return The log-probability of the sequences.
+ */
+NGramModel::Score NGramModel::score( const std::vector<Sequence>& sequences, ThreadPool& pool ) const {
+    auto _partials = pool.map_ranges( sequences.size(), [this, &sequences]( size_t first, size_t last ) {
+        Score _score;
+        Sequence _padded;
+        for (size_t _q = first; _q < last; _q++) {
+            _padded.assign( order_ - 1, BOS );
+            _padded.insert( _padded.end(), sequences[_q].begin(), sequences[_q].end() );
+            _padded.push_back( EOS );
+            for (size_t _i = order_ - 1; _i < _padded.size(); _i++) {
+                _score.bits += cost( _padded.data(), _i );
+                _score.tokens++;
+                _score.unknown += _padded[_i] == UNK;
+            }
+        }
+        return _score;
+    } );
+
+    Score _score;
+    for (const Score& _part : _partials) {
+        _score.bits += _part.bits;
+        _score.tokens += _part.tokens;
+        _score.unknown += _part.unknown;
+    }
+    return _score;
+}
+
+size_t NGramModel::ngram_count( size_t order ) const {
+    size_t _count{0};
+    if (order >= 1 && order <= counts_.size()) {
+        for (const Table& _table : counts_[order - 1]) {
+            _count += _table.size();
+        }
+    }
+    return _count;
+}
+
+/**
+ * Computes the interpolated Kneser-Ney probability of a token, from the uniform distribution up through each order
+ *  whose context has been seen:
+ *      p_k(w | h) = (max( c(h w) - D_k, 0 ) + D_k * types(h) * p_k-1(w | h')) / total(h)
+ *  where h' is h without its first token. An unseen context leaves the lower order's probability as it is.
+ *
+ * @param padded The padded sequence.
+ * @param i The position of the token.
+ * @return -log2 of the probability.
+ */
+double NGramModel::cost( const uint32_t* padded, size_t i ) const {
+    double _probability = 1.0 / vocabulary_size();
+    uint64_t _key{0};
+    for (size_t _order = 1; _order <= order_; _order++) {
+        _key |= static_cast<uint64_t>( padded[i + 1 - _order] ) << ((_order - 1) * bits_);
+        const auto& _contexts = contexts_[_order - 1];
+        auto _context = _contexts.find( _key >> bits_ );
+        if (_context == _contexts.end()) {
+            break;
+        }
+        double _discount = discounts_[_order - 1];
+        double _count = static_cast<double>( lookup( _order, _key ) );
+        _probability = (std::max( _count - _discount, 0.0 ) + _discount * _context->second.types * _probability)
+            / _context->second.total;
+    }
+    return -std::log2( _probability );
+}
+
+uint64_t NGramModel::lookup( size_t order, uint64_t key ) const {
+    const Table& _table = counts_[order - 1][shard_of( key )];
+    auto _it = _table.find( key );
+    return _it != _table.end() ? _it->second : 0;
+}
+
+// the finalizer of MurmurHash3, so that keys differing only in their high bits land in different shards
+uint64_t NGramModel::mix( uint64_t value ) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb93fe53ad878ull;
+    value ^= value >> 33;
+    return value;
+}
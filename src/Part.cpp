@@ -1,4 +1,5 @@
 #include "Part.h"
+#include <algorithm>
 #include <iostream>
 #include <numeric>
 #include <sstream>
@@ -34,10 +35,13 @@ bool Part::parse_xml( tinyxml2::XMLElement* part ) {
     }
 
     // Construct encodings_ from each measure
+    // ties are tracked per part, so that parts can be parsed concurrently
+    bool _tieStarted{false};
+
     std::unique_ptr<Encoding> _token = std::make_unique<Marker>( Marker::MarkerType::SOC );
     push_encoding( _token );
     while (_measure) {
-        if (!parse_measure( _measure )) {
+        if (!parse_measure( _measure, _tieStarted )) {
             return false;
         }
         _token = std::make_unique<Marker>( Marker::MarkerType::EOM );
@@ -113,9 +117,10 @@ bool Part::parse_attributes( tinyxml2::XMLElement* attributes ) {
  * measure, the function will log an error message and return false.
  *
  * @param measure The XML element representing the measure to be parsed.
+ * @param tieStarted The tie state of the part, carried from one note to the next.
  * @return true if the parsing was successful, false otherwise.
  */
-bool Part::parse_measure( tinyxml2::XMLElement* measure ) {
+bool Part::parse_measure( tinyxml2::XMLElement* measure, bool& tieStarted ) {
     XMLElement* _note = try_get_child( measure, "note" );
     while (_note) {
 
@@ -125,7 +130,7 @@ bool Part::parse_measure( tinyxml2::XMLElement* measure ) {
             continue;
         }
 
-        std::unique_ptr<Encoding> _token = std::make_unique<Note>( _note  );       
+        std::unique_ptr<Encoding> _token = std::make_unique<Note>( _note, tieStarted );       
         if (!_token->is_valid()) {
             std::cerr << "Unable to process " << partName_ << " for " <<  id_ << std::endl;
             return false;
@@ -143,10 +148,130 @@ bool Part::parse_measure( tinyxml2::XMLElement* measure ) {
     return true;
 }
 
+/**
+ * Encodes one voice of a MIDI file the way parse_xml() encodes a MusicXML part.
+ *
+ * The meter is the time signature that lasts longest, and the key is the file's first key signature. Onsets and
+ *  releases are quantized to the nearest of MidiFile::QUANTIZE_SUB_BEATS sub-beats per beat, and notes that vanish
+ *  are dropped. A voice is read as a melody: of notes starting together the highest is kept, and a note is cut off
+ *  by the next one. Gaps become rests, and a note that crosses a barline is split into notes tied across it.
+ *
+ * Measures are laid out by the time signatures, from the first onset to the last release of any voice in the file,
+ *  so that every part of a chorale has the same measures and a late first onset becomes an upbeat.
+ *
+ * @param midi The MIDI file.
+ * @param voice The voice to encode.
+ * @return true if the parsing was successful, false otherwise.
+ */
+bool Part::parse_midi( const MidiFile& midi, const MidiFile::Voice& voice ) {
+    struct Span {
+        uint64_t start;
+        uint64_t end;
+        int pitch;
+    };
+
+    key_ = midi.get_key();
+    mode_ = midi.is_minor() ? Mode::MINOR : Mode::MAJOR;
+
+    // the meter is the time signature that lasts longest
+    const auto& _signatures = midi.get_time_signatures();
+    uint64_t _firstOnset = midi.get_first_onset();
+    uint64_t _lastRelease = midi.get_last_release();
+    const MidiFile::TimeSignature* _meter = &_signatures.front();
+    uint64_t _longest{0};
+    for (size_t _i = 0; _i < _signatures.size(); _i++) {
+        uint64_t _start = std::max( _signatures[_i].tick, _firstOnset );
+        uint64_t _end = (_i + 1 < _signatures.size()) ? std::min( _signatures[_i + 1].tick, _lastRelease ) : _lastRelease;
+        if (_end > _start && _end - _start > _longest) {
+            _longest = _end - _start;
+            _meter = &_signatures[_i];
+        }
+    }
+    beatsPerMeasure_ = _meter->beats;
+    subBeatsPerBeat_ = MidiFile::QUANTIZE_SUB_BEATS;
+
+    // file ticks to the nearest sub-beat of the meter's beat
+    uint64_t _ticksPerQuarter = midi.get_ticks_per_quarter();
+    auto _quantize = [&]( uint64_t tick ) {
+        return (tick * subBeatsPerBeat_ * _meter->beatType + 2 * _ticksPerQuarter) / (4 * _ticksPerQuarter);
+    };
+    uint64_t _first = _quantize( _firstOnset );
+    uint64_t _last = _quantize( _lastRelease );
+
+    // the start of each measure, from the time signatures
+    std::vector<uint64_t> _barlines;
+    for (size_t _i = 0; _i < _signatures.size(); _i++) {
+        uint64_t _start = _quantize( _signatures[_i].tick );
+        uint64_t _end = (_i + 1 < _signatures.size()) ? _quantize( _signatures[_i + 1].tick ) : _last;
+        uint64_t _measureLength = std::max<uint64_t>( 1, 
+            _signatures[_i].beats * subBeatsPerBeat_ * _meter->beatType / _signatures[_i].beatType );
+        for (uint64_t _bar = _start; _bar < _end; _bar += _measureLength) {
+            _barlines.push_back( _bar );
+        }
+    }
+    _barlines.push_back( _last );
+
+    // the melody of the voice, quantized
+    std::vector<Span> _melody;
+    for (const MidiFile::Note& _note : voice.notes) {
+        Span _span{ _quantize( _note.start ), _quantize( _note.end ), _note.pitch };
+        if (_span.end <= _span.start || (!_melody.empty() && _span.start == _melody.back().start)) {
+            continue;
+        }
+        if (!_melody.empty() && _span.start < _melody.back().end) {
+            _melody.back().end = _span.start;
+        }
+        _melody.push_back( _span );
+    }
+
+    std::unique_ptr<Encoding> _token = std::make_unique<Marker>( Marker::MarkerType::SOC );
+    push_encoding( _token );
+
+    size_t _next{0};    // the first note of the melody not yet encoded in full
+    for (size_t _i = 0; _i + 1 < _barlines.size(); _i++) {
+        uint64_t _measureStart = std::max( _barlines[_i], _first );
+        uint64_t _measureEnd = std::min( _barlines[_i + 1], _last );
+        if (_measureEnd <= _measureStart) {
+            continue;
+        }
+
+        for (uint64_t _tick = _measureStart; _tick < _measureEnd; ) {
+            while (_next < _melody.size() && _melody[_next].end <= _tick) {
+                _next++;
+            }
+
+            uint64_t _end;
+            if (_next < _melody.size() && _melody[_next].start <= _tick) {
+                _end = std::min( _melody[_next].end, _measureEnd );
+                _token = std::make_unique<Note>( Note::from_midi_pitch( _melody[_next].pitch, key_, 
+                    mode_ == Mode::MINOR, _end - _tick, /* tied = */ _tick > _melody[_next].start ) );
+            }
+            else {
+                _end = (_next < _melody.size()) ? std::min( _melody[_next].start, _measureEnd ) : _measureEnd;
+                _token = std::make_unique<Note>( _end - _tick );
+            }
+            push_encoding( _token );
+            _tick = _end;
+        }
+
+        if (ticks_remaining() < 0) {
+            std::cerr << location_to_string( get_last_encoding().get() ) << ": Measure is longer than "
+                << beatsPerMeasure_ << " beats in " << partName_ << std::endl;
+            return false;
+        }
+        _token = std::make_unique<Marker>( Marker::MarkerType::EOM );
+        push_encoding( _token );
+    }
+
+    _token = std::make_unique<Marker>( Marker::MarkerType::EOC );
+    push_encoding( _token );
+    return true;
+}
+
 /**
  * Transposes the notes in the Part object to the specified key.
  *
- * This function iterates through all the encodings (notes) in the Part object and transposes
+ * This function iterates through all the encodings (notes and chords) in the Part object and transposes
  * them up or down as necessary to reach the target key. It does this by calling the
  * transpose_up() or transpose_down() functions on each note, and then adjusting the key_
  * member variable one step closer to the target key.
@@ -165,6 +290,12 @@ bool Part::transpose( int key ) {
             else if (_token->is_note() && (key < key_)) {
                 transpose_down( static_cast<Note&>( *_token ), _byFifth );
             }
+            else if (_token->is_chord() && (key > key_)) {
+                transpose_up( static_cast<Chord&>( *_token ), _byFifth );
+            }
+            else if (_token->is_chord() && (key < key_)) {
+                transpose_down( static_cast<Chord&>( *_token ), _byFifth );
+            }
         }
 
         // move one step closer to the target key
@@ -189,17 +320,57 @@ bool Part::transpose( int key ) {
   * count. This ensures that the timing and duration of the notes remain consistent when the
   * sub-beat count is changed.
   *
+  * Durations and ticks are rescaled with integer division, so a grid that is not a multiple of min_sub_beats()
+  * (e.g. 8 sub-beats for a part with triplets) rounds some of them. The part is rescaled anyway; the caller decides
+  * whether that matters, and may ask for the first encoding affected to be reported.
+  *
   * @param subBeats The new number of sub-beats per beat.
+  * @param report If true, the first encoding rounded is reported to cerr.
+  * @return true if every duration and tick was rescaled exactly, false otherwise.
   */
- void Part::set_sub_beats( size_t subBeats ) {
+ bool Part::set_sub_beats( size_t subBeats, bool report ) {
     size_t _oldSubBeats{ subBeatsPerBeat_ };
+    bool _exact{true};
+    for (const auto& _encoding : encodings_) {
+        if ((_encoding->get_duration() * subBeats) % _oldSubBeats != 0 
+                || ((_encoding->get_tick_number() - 1) * subBeats) % _oldSubBeats != 0) {
+            if (report) {
+                std::cerr << location_to_string( _encoding.get() ) << ": Rescaling " << partName_ << " from " 
+                    << _oldSubBeats << " to " << subBeats << " sub-beats per beat rounds " << _encoding->to_string() 
+                    << std::endl;
+            }
+            _exact = false;
+            break;
+        }
+    }
+
     subBeatsPerBeat_ = subBeats;
     for (auto& _encoding : encodings_) {
         _encoding->set_duration( _encoding->get_duration() * subBeats / _oldSubBeats );
         _encoding->set_tick_number( (_encoding->get_tick_number() - 1) * subBeats / _oldSubBeats + 1 );
     }
+    nextTick_ = (nextTick_ - 1) * subBeats / _oldSubBeats + 1;
+    return _exact;
  }
 
+/**
+ * Finds the smallest number of sub-beats per beat the part can be rescaled onto without rounding: the current
+ *  number divided by the greatest common divisor of it and of every duration and tick offset in the part.
+ *
+ * @return The smallest exact number of sub-beats per beat (1 if every note starts and ends on a beat).
+ */
+size_t Part::min_sub_beats() const {
+    size_t _divisor{ subBeatsPerBeat_ };
+    for (const auto& _encoding : encodings_) {
+        _divisor = std::gcd( _divisor, static_cast<size_t>( _encoding->get_duration() ) );
+        _divisor = std::gcd( _divisor, _encoding->get_tick_number() - 1 );
+        if (_divisor == 1) {
+            break;
+        }
+    }
+    return subBeatsPerBeat_ / _divisor;
+}
+
 /**
  * Generates the header string for the Part object.
  * 
@@ -214,14 +385,23 @@ bool Part::transpose( int key ) {
  * 
  * @return The header string for the Part object.
  */
-std::string Part::get_header() const {
+std::string Part::get_header( bool intervals, bool voices ) const {
     std::ostringstream _os;
     _os << SOH << ID << id_ 
         << DELIM << PART << partName_  
         << DELIM << KEY + key_to_string() 
         << DELIM << BEATS  << beatsPerMeasure_ 
-        << DELIM << SUB_BEATS << subBeatsPerBeat_
-        << EOH;
+        << DELIM << SUB_BEATS << subBeatsPerBeat_;
+    if (intervals || voices) {
+        _os << DELIM << ENCODING;
+        if (intervals) {
+            _os << INTERVALS_STR << (voices ? " " : "");
+        }
+        if (voices) {
+            _os << VOICES_STR;
+        }
+    }
+    _os << EOH;
     return _os.str();
 }
 
@@ -244,61 +424,291 @@ std::string Part::to_string( const PartPrintOptions& opts ) const {
     std::ostringstream _os;
     print_header( _os, opts );
 
-    // keep track of position within the beat
-    unsigned int _currentSubBeat = 0;
-    unsigned int _nextSubBeat = 0;
+    // the options are resolved once, by picking the kernel compiled for them
+    (this->*emitKernels_[opts.kernel_index()])( _os, nullptr );
 
-    for (const auto& _encoding : encodings_) {
-        if (_encoding->is_marker()) {
-            print_marker( _os, opts, *_encoding );
-        }
-        else {
-            _currentSubBeat = _nextSubBeat;
-            _nextSubBeat = (_currentSubBeat + _encoding->get_duration()) % subBeatsPerBeat_;
-            print_note( _os, opts, *_encoding, _currentSubBeat == 0, _nextSubBeat == 0 );
-        }
-    }
+    return _os.str();
+}
+
+/**
+ * Generates a string representation of the Part object, as to_string( opts ) does, and records the position of
+ *  each token written after the header.
+ *
+ * @param opts The print options.
+ * @param positions Cleared, then filled with one entry for each token.
+ * @return A string representation of the Part object.
+ */
+std::string Part::to_string( const PartPrintOptions& opts, TokenPositions& positions ) const {
+
+    std::ostringstream _os;
+    print_header( _os, opts );
+
+    positions.clear();
+    (this->*emitKernels_[opts.kernel_index()])( _os, &positions );
 
     return _os.str();
 }
 
+// one kernel for each combination of print options, indexed by PartPrintOptions::kernel_index(); an index that
+//  kernel_index() never returns shares the kernel of its normalized index
+template <size_t... Index>
+constexpr std::array<Part::EmitKernel, sizeof...(Index)> Part::make_emit_kernels( std::index_sequence<Index...> ) {
+    return { &Part::emit_encodings<(Index & 1) != 0, (Index & 2) != 0,
+        (PartPrintOptions::normalize_kernel_index( Index ) & 4) != 0, (Index & 8) != 0, (Index & 16) != 0,
+        (Index & 32) != 0>... };
+}
+
+const std::array<Part::EmitKernel, PartPrintOptions::KERNEL_COUNT> Part::emitKernels_ =
+    make_emit_kernels( std::make_index_sequence<PartPrintOptions::KERNEL_COUNT>{} );
 
 void Part::print_header( std::ostream& os, const PartPrintOptions& opts ) const {
     // don't print header unless requested
     if (opts.printHeader) {
-        os << get_header() << " ";
+        os << get_header( opts.printIntervals, opts.printVoices ) << " ";
+    }
+}
+
+/**
+ * Writes the encodings to the stream using the print options given as template parameters.
+ *
+ * Markers are written according to their type; <EOM> is skipped unless PrintEOM, and <SOC> and <EOC> are written 
+ *  as '.' if EndTokensAsPeriod. Notes and chords are followed by a period rather than a space if ConsolidateBeat and
+ *  more of the beat follows, and only the token starting each beat is written, without its duration, if 
+ *  StartingTokensOnly. The position within the beat is carried from note to note, so a modulo is only needed 
+ *  when a note crosses into a later beat. If Intervals, notes and chords are written as intervals from the 
+ *  previous token written. If Voices, each pitch or interval of a note or chord is a token of its own, followed by
+ *  a duration token. If positions is given, the position of each token written is added to it; tokens joined by
+ *  ConsolidateBeat count as one.
+ *
+ * @param os The stream to write to.
+ * @param positions The positions to add to, or nullptr.
+ */
+template <bool PrintEOM, bool EndTokensAsPeriod, bool ConsolidateBeat, bool StartingTokensOnly, bool Intervals,
+    bool Voices>
+void Part::emit_encodings( std::ostream& os, TokenPositions* positions ) const {
+    static_assert( !(ConsolidateBeat && (StartingTokensOnly || Voices)),
+        "ConsolidateBeat is normalized away with StartingTokensOnly or Voices" );
+    const size_t _subBeatsPerBeat{ subBeatsPerBeat_ };
+
+    // keep track of position within the beat
+    size_t _subBeat{0};
+
+    // true if the last note written was joined to the next by a period, so they are one token
+    bool _joined{false};
+
+    // the pitch the next interval is measured from
+    [[maybe_unused]] int _reference{ INTERVAL_REFERENCE };
+
+    for (const auto& _encoding : encodings_) {
+        if (_encoding->is_marker()) {
+            if (positions && (PrintEOM || !_encoding->is_EOM())) {
+                add_positions( *positions, *_encoding, false );
+            }
+            switch (static_cast<const Marker&>( *_encoding ).get_marker_type()) {
+                case Marker::MarkerType::SOC:
+                    os << (EndTokensAsPeriod ? "." : Marker::SOC_STR) << ' ';
+                    break;
+                case Marker::MarkerType::EOM:
+                    if constexpr (PrintEOM) {
+                        os << Marker::EOM_STR << ' ';
+                    }
+                    break;
+                case Marker::MarkerType::EOP:
+                    os << Marker::EOP_STR << ' ';
+                    break;
+                case Marker::MarkerType::EOC:
+                    os << (EndTokensAsPeriod ? "." : Marker::EOC_STR);
+                    break;
+            }
+            continue;
+        }
+
+        const bool _startsBeat = (_subBeat == 0);
+        _subBeat += _encoding->get_duration();
+        if (_subBeat >= _subBeatsPerBeat) {
+            _subBeat %= _subBeatsPerBeat;
+        }
+        const bool _endsBeat = (_subBeat == 0);
+
+        // always print start of beat
+        // ignore subsequent notes if requested
+        if (!StartingTokensOnly || _startsBeat) {
+            if (positions && !_joined) {
+                add_positions( *positions, *_encoding, Voices );
+            }
+            if constexpr (Intervals) {
+                write_interval_token( os, *_encoding, StartingTokensOnly, _reference, Voices );
+            }
+            else if constexpr (Voices) {
+                write_voice_tokens( os, *_encoding, StartingTokensOnly );
+            }
+            else {
+                write_token( os, *_encoding, StartingTokensOnly );
+            }
+
+            // if we are consolidating tokens withn the beat and have more coming, delimiter is a period
+            _joined = ConsolidateBeat && !_endsBeat;
+            os << (_joined ? '.' : ' ');
+        }
     }
 }
 
-void Part::print_marker( std::ostream& os, const PartPrintOptions& opts, const Encoding& marker ) const {
-    if (marker.is_EOM() && !opts.printEOM) {
+/**
+ * Adds the positions of the tokens written for a marker, note or chord: its measure, beat and sub-beat, with the
+ *  voice and tie of each voice token if voices, followed by a duration token. A chord not written as voices is
+ *  one token, with the ties of all its voices.
+ *
+ * @param positions The positions to add to.
+ * @param encoding The marker, note or chord written.
+ * @param voices If true, a note or chord was written as one token for each voice and a duration token.
+ */
+void Part::add_positions( TokenPositions& positions, const Encoding& encoding, bool voices ) const {
+    const size_t _measure = encoding.get_measure_number();
+    const size_t _beat = tick_to_beat( encoding.get_tick_number() );
+    const size_t _subBeat = tick_to_sub_beat( encoding.get_tick_number() );
+
+    if (encoding.is_note()) {
+        positions.add( _measure, _beat, _subBeat, 0, static_cast<const Note&>( encoding ).get_tied() ? 1 : 0 );
+    }
+    else if (encoding.is_chord()) {
+        const auto& _notes = static_cast<const Chord&>( encoding ).get_notes();
+        if (voices) {
+            for (size_t _voice = 0; _voice < _notes.size(); _voice++) {
+                positions.add( _measure, _beat, _subBeat, static_cast<uint8_t>( _voice ),
+                    _notes[_voice].get_tied() ? 1 : 0 );
+            }
+        }
+        else {
+            uint8_t _tied{0};
+            for (size_t _voice = 0; _voice < _notes.size(); _voice++) {
+                if (_notes[_voice].get_tied()) {
+                    _tied |= static_cast<uint8_t>( 1u << _voice );
+                }
+            }
+            positions.add( _measure, _beat, _subBeat, TokenPositions::NO_VOICE, _tied );
+        }
+    }
+    else {
+        positions.add( _measure, _beat, _subBeat, TokenPositions::NO_VOICE, 0 );
         return;
     }
 
-    if ((marker.is_SOC() || marker.is_EOC()) && opts.printEndTokensAsPeriod) {
-        os << ".";
+    // the duration token ending a note or chord written as voices
+    if (voices) {
+        positions.add( _measure, _beat, _subBeat, TokenPositions::NO_VOICE, 0 );
+    }
+}
+
+/**
+ * Writes a note or chord to the stream, dispatching on its token type rather than through a virtual call.
+ *
+ * @param os The stream to write to.
+ * @param encoding The note or chord to write.
+ * @param ignoreDuration If true, the duration is omitted.
+ */
+void Part::write_token( std::ostream& os, const Encoding& encoding, bool ignoreDuration ) {
+    if (encoding.is_note()) {
+        static_cast<const Note&>( encoding ).write( os, ignoreDuration );
+    }
+    else if (encoding.is_chord()) {
+        static_cast<const Chord&>( encoding ).write( os, ignoreDuration );
     }
     else {
-        os << marker.to_string();
+        os << encoding.to_string( ignoreDuration );
     }
-    os << ( marker.is_EOC() ? "" : " " );
 }
 
-void Part::print_note( std::ostream& os, const PartPrintOptions& opts, const Encoding& note,
-    bool startsBeat, bool endsBeat ) const {
 
-    // if we are consolidating tokens withn the beat and have more coming, delimiter is a period
-    char _delimiter = (opts.consolidateBeat && !endsBeat) ? '.' : ' ';
+/**
+ * Writes a note or chord as intervals in semitones, negative if downward: a note as "<interval>.<duration>", its
+ *  interval from the reference, and a chord as "<interval>. ... .<interval>.<duration>", the intervals of its upper
+ *  voices above its bass (or above the reference, if the bass rests) followed by the interval of its bass from the
+ *  reference. A rest is written as 'R', and a note tied from the previous note is prefixed with '+', as in pitch
+ *  tokens. With voices, the intervals and the duration are separate tokens, as in write_voice_tokens().
+ *
+ * @param os The stream to write to.
+ * @param encoding The note or chord to write.
+ * @param ignoreDuration If true, the duration is omitted.
+ * @param reference The MIDI pitch of the previous note, or of the previous bass; updated unless the note or bass
+ *  rests.
+ * @param voices If true, each interval is a token of its own.
+ */
+void Part::write_interval_token( std::ostream& os, const Encoding& encoding, bool ignoreDuration, int& reference,
+        bool voices ) {
+    const char _delimiter = voices ? ' ' : '.';
+    auto _write = [_delimiter]( std::ostream& os, const Note& note, int from ) {
+        if (note.get_tied()) {
+            os << '+';
+        }
+        if (note.is_rest()) {
+            os << 'R';
+        }
+        else {
+            os << note.get_midi_pitch() - from;
+        }
+        os << _delimiter;
+    };
+
+    if (encoding.is_note()) {
+        const Note& _note = static_cast<const Note&>( encoding );
+        _write( os, _note, reference );
+        if (!_note.is_rest()) {
+            reference = _note.get_midi_pitch();
+        }
+    }
+    else if (encoding.is_chord()) {
+        const auto& _notes = static_cast<const Chord&>( encoding ).get_notes();
+        const Note& _bass = _notes.back();
+        int _bassPitch = _bass.is_rest() ? reference : _bass.get_midi_pitch();
+        for (size_t _i = 0; _i + 1 < _notes.size(); _i++) {
+            _write( os, _notes[_i], _bassPitch );
+        }
+        _write( os, _bass, reference );
+        reference = _bassPitch;
+    }
+    else {
+        os << encoding.to_string( ignoreDuration );
+        return;
+    }
 
-    // always print start of beat
-    // ignore subsequent notes if requested
-    if (startsBeat || !opts.printOnlyStartingTokenforEachBeat) {
-        os << note.to_string( opts.printOnlyStartingTokenforEachBeat ) << _delimiter;
-    }   
+    if (voices) {
+        os << VOICES_DURATION;
+    }
+    if (!ignoreDuration) {
+        os << encoding.get_duration();
+    }
 }
 
+/**
+ * Writes a note or chord as one token for each pitch, in the order of its voices, followed by a token holding
+ *  VOICES_DURATION and its duration, e.g. "+A.4 F.4 C.4 F.3 :8" for the chord "+A.4.F.4.C.4.F.3.8". The duration
+ *  token ends the note or chord, so the pitches can be joined again when they are parsed (see join_voices()).
+ *
+ * @param os The stream to write to.
+ * @param encoding The note or chord to write.
+ * @param ignoreDuration If true, the duration is omitted (but VOICES_DURATION is still written).
+ */
+void Part::write_voice_tokens( std::ostream& os, const Encoding& encoding, bool ignoreDuration ) {
+    if (encoding.is_note()) {
+        static_cast<const Note&>( encoding ).write_pitch( os );
+        os << ' ';
+    }
+    else if (encoding.is_chord()) {
+        for (const Note& _note : static_cast<const Chord&>( encoding ).get_notes()) {
+            _note.write_pitch( os );
+            os << ' ';
+        }
+    }
+    else {
+        os << encoding.to_string( ignoreDuration );
+        return;
+    }
 
-
+    os << VOICES_DURATION;
+    if (!ignoreDuration) {
+        os << encoding.get_duration();
+    }
+}
 
 /**
  * Generates a string representation of the location of the given Encoding within the Part.
@@ -377,10 +787,86 @@ bool Part::parse_encoding( const std::string& part ) {
         return false;
     }
 
-    if (!import_header( part.substr( 0, _it + 1 ))) {
+    std::string _header = part.substr( 0, _it + 1 );
+    if (!import_header( _header )) {
+        return false;
+    }
+
+    // the encoding field is only written for encodings that are not plain pitches
+    std::string _encodingType = _header.find( ENCODING ) != std::string::npos 
+        ? find_header_value( _header, ENCODING ) : "";
+    std::string _encodings = part.substr( _it + 1 );
+    if (_encodingType.find( VOICES_STR ) != std::string::npos) {
+        _encodings = join_voices( _encodings );
+    }
+    if (_encodingType.find( INTERVALS_STR ) != std::string::npos) {
+        return import_interval_encodings( _encodings );
+    }
+    return import_encodings( _encodings );
+}
+
+/**
+ * Parses only the header of a string representation of a part, e.g. to identify the part without the cost of
+ *  parsing its encodings.
+ *
+ * @param part The string representation of the part to parse.
+ * @return `true` if the header was found and parsed, `false` otherwise.
+ */
+bool Part::parse_header( const std::string& part ) {
+    auto _it = part.find(EOH);
+    if (_it == std::string::npos) {
+        std::cerr << "No header found. Line = " << part;
+        return false;
+    }
+    return import_header( part.substr( 0, _it + 1 ));
+}
+
+/**
+ * Rebuilds a part from a snapshot: the header fields from its entry, and a note or marker from each record, at the
+ *  location recorded, so nothing is parsed. The next location is left after the last record, as push_encoding()
+ *  leaves it.
+ *
+ * @param entry The part's entry in the snapshot's table.
+ * @param records Its entry.records records.
+ * @return `true` if every record was a valid note (a letter A-G, or R for a rest, in an octave up to
+ *  PartSnapshot::MAX_OCTAVE) or marker, `false` otherwise.
+ */
+bool Part::parse_snapshot( const PartSnapshot::PartEntry& entry, const PartSnapshot::Record* records ) {
+    id_ = entry.id;
+    partName_ = entry.part;
+    beatsPerMeasure_ = entry.beatsPerMeasure;
+    subBeatsPerBeat_ = entry.subBeatsPerBeat;
+    key_ = entry.key;
+    mode_ = (entry.mode == Mode::MINOR) ? Mode::MINOR : Mode::MAJOR;
+    if (beatsPerMeasure_ == 0 || subBeatsPerBeat_ == 0) {
+        std::cerr << "Invalid meter in snapshot of " << id_ << ' ' << partName_ << std::endl;
         return false;
     }
-    return import_encodings( part.substr( _it + 1 ) );
+
+    encodings_.clear();
+    encodings_.reserve( entry.records );
+    for (const PartSnapshot::Record* _record = records; _record != records + entry.records; _record++) {
+        std::unique_ptr<Encoding> _encoding;
+        if (_record->type == Encoding::MARKER && _record->value <= Marker::MarkerType::EOC) {
+            _encoding = std::make_unique<Marker>( static_cast<Marker::MarkerType>( _record->value ) );
+        }
+        else if (_record->type == Encoding::NOTE
+                && ((_record->value >= 'A' && _record->value <= 'G') || _record->value == 'R')
+                && _record->octave <= PartSnapshot::MAX_OCTAVE) {
+            _encoding = std::make_unique<Note>( static_cast<char>( _record->value ), _record->octave,
+                _record->duration, _record->accidental, _record->tied != 0 );
+        }
+        else {
+            std::cerr << "Invalid record in snapshot of " << id_ << ' ' << partName_ << std::endl;
+            return false;
+        }
+        _encoding->set_location( _record->measure, _record->tick );
+        encodings_.push_back( std::move( _encoding ) );
+    }
+
+    currentMeasure_ = encodings_.empty() ? 1 : encodings_.back()->get_measure_number();
+    nextTick_ = encodings_.empty() ? 1 : encodings_.back()->get_tick_number() + encodings_.back()->get_duration();
+    return true;
 }
 
 /**
@@ -497,8 +983,8 @@ bool Part::import_encodings( const std::string& line ) {
  * Creates a new `Encoding` object based on the provided encoding string.
  *
  * This function examines the encoding string and determines whether it represents a marker (such as start of
- * content, end of content, etc.) or a note. It then creates and returns the appropriate `Encoding` subclass
- * instance.
+ * content, end of content, etc.), a note, or a chord (as written for a combined part). It then creates and returns 
+ * the appropriate `Encoding` subclass instance.
  *
  * @param encoding The string representation of the encoding to create.
  * @return A unique_ptr to the newly created `Encoding` object.
@@ -517,10 +1003,116 @@ std::unique_ptr<Encoding> Part::make_encoding( const std::string& encoding ) con
         return std::make_unique<Marker>( Marker::MarkerType::EOM );
     }
 
-    // if it's not a marker, it must be a note
+    // if it's not a marker, it is a note ("pitch.octave.duration") or a chord with more than one pitch and octave
+    if (std::count( encoding.begin(), encoding.end(), '.' ) > 2) {
+        return std::make_unique<Chord>( encoding );
+    }
     return std::make_unique<Note>( encoding );
 }
 
+/**
+ * Rejoins encodings written by write_voice_tokens(), with each pitch (or interval) a token of its own, into one
+ *  token for each note or chord, as write_token() (or write_interval_token()) writes them: the tokens before each
+ *  duration token are joined with '.', followed by the duration. Markers (and '.' for <SOC> or <EOC>) are left as
+ *  they are.
+ *
+ * @param line The string containing the encodings to rejoin.
+ * @return The string with one token for each note or chord.
+ */
+std::string Part::join_voices( const std::string& line ) {
+    std::istringstream _is{ line };
+    std::ostringstream _os;
+    for (std::string _token; _is >> _token; ) {
+        if (_token.starts_with( '[' ) || _token == ".") {
+            _os << _token << ' ';
+        }
+        else if (_token.front() == VOICES_DURATION) {
+            _os << _token.substr( 1 ) << ' ';
+        }
+        else {
+            _os << _token << '.';
+        }
+    }
+    return _os.str();
+}
+
+/**
+ * Imports encodings written as intervals (see write_interval_token()), spelling each pitch as it is usually spelled
+ *  in the part's key (see Note::from_midi_pitch()).
+ *
+ * @param line The string containing the encodings to import.
+ * @return `true` if the encodings were successfully imported, `false` otherwise.
+ */
+bool Part::import_interval_encodings( const std::string& line ) {
+    std::istringstream _is{ line };
+    int _reference{ INTERVAL_REFERENCE };
+    for (std::string _token; _is >> _token; ) {
+        std::unique_ptr<Encoding> _encoding;
+        if (_token.starts_with( '[' )) {
+            _encoding = make_encoding( _token );
+        }
+        else {
+            try {
+                _encoding = make_interval_encoding( _token, _reference );
+            }
+            catch (std::exception& e) {
+                std::cerr << "Error parsing interval token in " << id_ << ' ' << partName_ << ": " << _token
+                    << std::endl;
+                return false;
+            }
+        }
+        push_encoding( _encoding );
+    }
+    return true;
+}
+
+/**
+ * Creates a note or chord from a token written by write_interval_token().
+ *
+ * @param encoding The token.
+ * @param reference The MIDI pitch of the previous note, or of the previous bass; updated as when writing.
+ * @return A unique_ptr to the note or chord.
+ */
+std::unique_ptr<Encoding> Part::make_interval_encoding( const std::string& encoding, int& reference ) const {
+    std::vector<std::string> _fields;
+    std::istringstream _is{ encoding };
+    for (std::string _field; std::getline( _is, _field, '.' ); ) {
+        _fields.push_back( _field );
+    }
+    if (_fields.size() < 2) {
+        throw std::invalid_argument( "interval token must have an interval and a duration" );
+    }
+
+    unsigned int _duration = std::stoi( _fields.back() );
+    auto _make_note = [this, _duration]( const std::string& field, int from ) {
+        bool _tied = field.starts_with( '+' );
+        std::string _interval = _tied ? field.substr( 1 ) : field;
+        Note _note = (_interval == "R") ? Note{ _duration }
+            : Note::from_midi_pitch( from + std::stoi( _interval ), key_, mode_ == Mode::MINOR, _duration );
+        _note.set_tied( _tied );
+        return _note;
+    };
+
+    if (_fields.size() == 2) {
+        Note _note = _make_note( _fields[0], reference );
+        if (!_note.is_rest()) {
+            reference = _note.get_midi_pitch();
+        }
+        return std::make_unique<Note>( std::move( _note ) );
+    }
+
+    // the bass is last, and the upper voices are measured from it
+    Note _bass = _make_note( _fields[_fields.size() - 2], reference );
+    int _bassPitch = _bass.is_rest() ? reference : _bass.get_midi_pitch();
+    std::vector<Note> _notes;
+    for (size_t _i = 0; _i + 2 < _fields.size(); _i++) {
+        _notes.push_back( _make_note( _fields[_i], _bassPitch ) );
+    }
+    _notes.push_back( std::move( _bass ) );
+    reference = _bassPitch;
+    return std::make_unique<Chord>( std::move( _notes ), _duration );
+}
+
 /**
  * Removes and returns the first encoding from the Part's list of encodings.
  *
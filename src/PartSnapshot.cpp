@@ -0,0 +1,254 @@
+#include "PartSnapshot.h"
+#include "Part.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Checks whether a file is a snapshot by reading its first bytes.
+ *
+ * @param path The path of the file.
+ * @return `true` if the file starts with MAGIC, `false` otherwise (or if it cannot be read).
+ */
+bool PartSnapshot::is_snapshot( const std::string& path ) {
+    std::ifstream _file{ path, std::ios::binary };
+    char _magic[sizeof(MAGIC)] = {};
+    return _file.read( _magic, sizeof(_magic) ) && std::memcmp( _magic, MAGIC, sizeof(MAGIC) ) == 0;
+}
+
+/**
+ * Opens the output file and writes a placeholder header, which is completed by close().
+ *
+ * @param path The path of the file to create.
+ * @return `true` if the file was opened, `false` otherwise.
+ */
+bool PartSnapshotWriter::open( const std::string& path ) {
+    file_.open( path, std::ios::out | std::ios::binary );
+    if (!file_) {
+        std::cerr << "Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+
+    PartSnapshot::FileHeader _header{};
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    pad_to_alignment();
+    return true;
+}
+
+/**
+ * Appends a record for each note and marker of a part, and records the part's header fields in the table.
+ *
+ * @param part The part to write.
+ * @return `true` if the part was written, `false` otherwise.
+ */
+bool PartSnapshotWriter::add( const Part& part ) {
+    auto _fail = [&part]( const std::string& reason ) {
+        std::cerr << "Failed to write snapshot of " << part.get_id() << ' ' << part.get_part_name() << ": "
+            << reason << std::endl;
+        return false;
+    };
+    PartSnapshot::PartEntry _entry{};
+    if (part.get_id().size() >= sizeof(_entry.id) || part.get_part_name().size() >= sizeof(_entry.part)) {
+        return _fail( "ID or part name too long" );
+    }
+    _entry.offset = file_.tellp();
+    _entry.beatsPerMeasure = part.get_beats_per_measure();
+    _entry.subBeatsPerBeat = part.get_sub_beats();
+    _entry.key = static_cast<int8_t>( part.get_key() );
+    _entry.mode = static_cast<uint8_t>( part.get_mode() );
+    std::strncpy( _entry.id, part.get_id().c_str(), sizeof(_entry.id) - 1 );
+    std::strncpy( _entry.part, part.get_part_name().c_str(), sizeof(_entry.part) - 1 );
+
+    records_.clear();
+    for (const auto& _encoding : part.get_encodings()) {
+        if (_encoding->get_measure_number() > UINT16_MAX || _encoding->get_tick_number() > UINT16_MAX
+                || _encoding->get_duration() > UINT16_MAX) {
+            return _fail( "location or duration too large" );
+        }
+        PartSnapshot::Record _record{};
+        _record.measure = static_cast<uint16_t>( _encoding->get_measure_number() );
+        _record.tick = static_cast<uint16_t>( _encoding->get_tick_number() );
+        _record.duration = static_cast<uint16_t>( _encoding->get_duration() );
+        if (_encoding->is_marker()) {
+            _record.type = Encoding::MARKER;
+            _record.value = static_cast<uint8_t>( static_cast<const Marker&>( *_encoding ).get_marker_type() );
+        }
+        else if (_encoding->is_note()) {
+            const Note& _note = static_cast<const Note&>( *_encoding );
+            if (_note.get_octave() > PartSnapshot::MAX_OCTAVE) {
+                return _fail( "octave out of range" );
+            }
+            _record.type = Encoding::NOTE;
+            _record.value = static_cast<uint8_t>( _note.get_pitch() );
+            _record.accidental = static_cast<int8_t>( _note.get_accidental() );
+            _record.octave = static_cast<uint8_t>( _note.get_octave() );
+            _record.tied = _note.get_tied() ? 1 : 0;
+        }
+        else {
+            return _fail( "only notes and markers can be written" );
+        }
+        records_.push_back( _record );
+    }
+    _entry.records = records_.size();
+
+    file_.write( reinterpret_cast<const char*>( records_.data() ), records_.size() * sizeof(PartSnapshot::Record) );
+    pad_to_alignment();
+    if (!file_) {
+        return _fail( "write error" );
+    }
+
+    table_.push_back( _entry );
+    return true;
+}
+
+/**
+ * Writes the table after the last part, then rewrites the header to point to it.
+ *
+ * @return `true` if the file was completed (or was not open), `false` otherwise.
+ */
+bool PartSnapshotWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+
+    PartSnapshot::FileHeader _header{};
+    std::memcpy( _header.magic, PartSnapshot::MAGIC, sizeof(PartSnapshot::MAGIC) );
+    _header.version = PartSnapshot::VERSION;
+    _header.partCount = table_.size();
+    _header.tableOffset = file_.tellp();
+
+    file_.write( reinterpret_cast<const char*>( table_.data() ), table_.size() * sizeof(PartSnapshot::PartEntry) );
+    file_.seekp( 0 );
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    file_.close();
+    table_.clear();
+    if (!file_) {
+        std::cerr << "Failed to write snapshot file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Pads the file with zeros so that the next block starts on an ALIGNMENT boundary.
+ */
+void PartSnapshotWriter::pad_to_alignment() {
+    static const char _zeros[PartSnapshot::ALIGNMENT] = {};
+    size_t _remainder = static_cast<size_t>( file_.tellp() ) % PartSnapshot::ALIGNMENT;
+    if (_remainder) {
+        file_.write( _zeros, PartSnapshot::ALIGNMENT - _remainder );
+    }
+}
+
+/**
+ * Maps a snapshot and checks that its table and the records of each part lie within it.
+ *
+ * @param path The path of the snapshot.
+ * @return `true` if the snapshot was mapped, `false` otherwise.
+ */
+bool PartSnapshotReader::open( const std::string& path ) {
+    close();
+
+    int _fd = ::open( path.c_str(), O_RDONLY );
+    if (_fd < 0) {
+        std::cerr << "Error opening snapshot: " << path << std::endl;
+        return false;
+    }
+
+    struct stat _stat;
+    if (fstat( _fd, &_stat ) != 0 || static_cast<size_t>( _stat.st_size ) < sizeof(PartSnapshot::FileHeader)) {
+        std::cerr << "Not a snapshot: " << path << std::endl;
+        ::close( _fd );
+        return false;
+    }
+
+    size_ = _stat.st_size;
+    void* _data = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, _fd, 0 );
+    ::close( _fd );
+    if (_data == MAP_FAILED) {
+        std::cerr << "Failed to map snapshot: " << path << std::endl;
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const char*>( _data );
+
+    auto _fits = [this]( uint64_t offset, uint64_t count, size_t size ) {
+        return offset % PartSnapshot::ALIGNMENT == 0 && offset <= size_ && count <= (size_ - offset) / size;
+    };
+    const auto* _header = reinterpret_cast<const PartSnapshot::FileHeader*>( data_ );
+    bool _valid = std::memcmp( _header->magic, PartSnapshot::MAGIC, sizeof(PartSnapshot::MAGIC) ) == 0
+        && _header->version == PartSnapshot::VERSION
+        && _fits( _header->tableOffset, _header->partCount, sizeof(PartSnapshot::PartEntry) );
+    if (_valid) {
+        table_ = reinterpret_cast<const PartSnapshot::PartEntry*>( data_ + _header->tableOffset );
+        partCount_ = _header->partCount;
+        for (size_t _p = 0; _p < partCount_ && _valid; _p++) {
+            _valid = _fits( table_[_p].offset, table_[_p].records, sizeof(PartSnapshot::Record) )
+                && table_[_p].id[sizeof(table_[_p].id) - 1] == '\0'
+                && table_[_p].part[sizeof(table_[_p].part) - 1] == '\0';
+        }
+    }
+    if (!_valid) {
+        std::cerr << "Not a snapshot: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    nextPart_ = 0;
+    return true;
+}
+
+void PartSnapshotReader::close() {
+    if (data_) {
+        munmap( const_cast<char*>( data_ ), size_ );
+    }
+    data_ = nullptr;
+    size_ = 0;
+    table_ = nullptr;
+    partCount_ = 0;
+    nextPart_ = 0;
+}
+
+/**
+ * Rebuilds the parts of the next chorale: the parts that follow with the ID of the first, which is compared in the
+ *  table, so no part is rebuilt only to find that it starts the next chorale. Parts that fail to load are reported
+ *  and skipped.
+ *
+ * @param parts The vector to fill with the chorale's parts; any previous contents are discarded.
+ * @return `true` if a chorale was read, `false` if there are no more chorales.
+ */
+bool PartSnapshotReader::read_chorale( std::vector<std::unique_ptr<Part>>& parts ) {
+    parts.clear();
+    while (nextPart_ < partCount_) {
+        if (!parts.empty() && std::strcmp( table_[nextPart_].id, parts.back()->get_id().c_str() ) != 0) {
+            break;
+        }
+        if (auto _part = read_part()) {
+            parts.push_back( std::move( _part ) );
+        }
+    }
+    return !parts.empty();
+}
+
+/**
+ * Rebuilds the next part from its entry and records.
+ *
+ * @return The part, or nullptr if it could not be loaded (or there are no more parts).
+ */
+std::unique_ptr<Part> PartSnapshotReader::read_part() {
+    if (nextPart_ >= partCount_) {
+        return nullptr;
+    }
+    const PartSnapshot::PartEntry& _entry = table_[nextPart_++];
+    auto _part = std::make_unique<Part>();
+    if (!_part->parse_snapshot( _entry,
+            reinterpret_cast<const PartSnapshot::Record*>( data_ + _entry.offset ) )) {
+        std::cerr << "Skipping part " << nextPart_ << " of snapshot" << std::endl;
+        return nullptr;
+    }
+    return _part;
+}
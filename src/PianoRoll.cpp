@@ -0,0 +1,184 @@
+#include "PianoRoll.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/**
+ * Builds the piano roll for a chorale from the encodings of its parts.
+ *
+ * Each part becomes one row of the grid, in the order given. Voices that are shorter than the longest voice
+ *  are padded with rests.
+ *
+ * @param parts The parts of the chorale, e.g. Soprano, Alto, Tenor and Bass.
+ * @return `true` if the piano roll was built, `false` otherwise.
+ */
+bool PianoRoll::build( const std::vector<const Part*>& parts ) {
+    if (parts.empty()) {
+        std::cerr << "No parts provided for piano roll" << std::endl;
+        return false;
+    }
+
+    const Part& _first = *parts[0];
+    id_ = _first.get_id();
+    mode_ = _first.get_mode();
+    beatsPerMeasure_ = _first.get_beats_per_measure();
+    subBeatsPerBeat_ = _first.get_sub_beats();
+    voices_ = parts.size();
+
+    // all voices must share a grid
+    ticks_ = 0;
+    for (const Part* _part : parts) {
+        if (static_cast<size_t>( _part->get_sub_beats() ) != subBeatsPerBeat_) {
+            std::cerr << "Sub-beats of " << _part->get_part_name() << " do not match "
+                << _first.get_part_name() << " for " << id_ << std::endl;
+            return false;
+        }
+        ticks_ = std::max( ticks_, count_ticks( *_part ) );
+    }
+
+    // an upbeat shifts the first note into the first measure
+    startTick_ = 0;
+    for (const auto& _encoding : _first.get_encodings()) {
+        if (_encoding->is_note()) {
+            startTick_ = _encoding->get_tick_number() - 1;
+            break;
+        }
+    }
+
+    cells_.assign( voices_ * ticks_, REST );
+    for (size_t _voice = 0; _voice < voices_; _voice++) {
+        fill_voice( _voice, *parts[_voice] );
+    }
+    return true;
+}
+
+/**
+ * Counts the ticks in a part by summing the durations of its notes.
+ *
+ * @param part The part to measure.
+ * @return The number of ticks in the part.
+ */
+size_t PianoRoll::count_ticks( const Part& part ) {
+    size_t _ticks{0};
+    for (const auto& _encoding : part.get_encodings()) {
+        if (_encoding->is_note()) {
+            _ticks += _encoding->get_duration();
+        }
+    }
+    return _ticks;
+}
+
+/**
+ * Fills one row of the grid with the MIDI pitches of a part's notes.
+ *
+ * @param voice The row to fill.
+ * @param part The part supplying the notes.
+ */
+void PianoRoll::fill_voice( size_t voice, const Part& part ) {
+    uint8_t* _row = cells_.data() + voice * ticks_;
+    size_t _tick{0};
+
+    for (const auto& _encoding : part.get_encodings()) {
+        if (!_encoding->is_note()) {
+            continue;
+        }
+
+        const Note& _note = static_cast<const Note&>( *_encoding );
+        size_t _duration = _note.get_duration();
+        if (!_note.is_rest()) {
+            uint8_t _pitch = static_cast<uint8_t>( _note.get_midi_pitch() ) & PITCH_MASK;
+            std::fill( _row + _tick, _row + _tick + _duration, _pitch );
+            if (!_note.get_tied() && _duration > 0) {
+                _row[_tick] |= ONSET;
+            }
+        }
+        _tick += _duration;
+    }
+}
+
+/**
+ * Opens the output file and writes a placeholder header, which is completed by close().
+ *
+ * @param path The path of the file to create.
+ * @return `true` if the file was opened, `false` otherwise.
+ */
+bool PianoRollWriter::open( const std::string& path ) {
+    file_.open( path, std::ios::out | std::ios::binary );
+    if (!file_) {
+        std::cerr << "Failed to open piano roll file: " << path << std::endl;
+        return false;
+    }
+
+    FileHeader _header{};
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    pad_to_alignment();
+    return true;
+}
+
+/**
+ * Appends a chorale's cells to the file and records its place in the offset table.
+ *
+ * @param roll The piano roll to write.
+ * @return `true` if the piano roll was written, `false` otherwise.
+ */
+bool PianoRollWriter::add( const PianoRoll& roll ) {
+    TableEntry _entry{};
+    _entry.offset = file_.tellp();
+    _entry.ticks = roll.get_ticks();
+    _entry.voices = roll.get_voices();
+    _entry.beatsPerMeasure = roll.get_beats_per_measure();
+    _entry.subBeatsPerBeat = roll.get_sub_beats();
+    _entry.startTick = roll.get_start_tick();
+    _entry.mode = (roll.get_mode() == Part::Mode::MINOR) ? 1 : 0;
+    std::strncpy( _entry.id, roll.get_id().c_str(), sizeof(_entry.id) - 1 );
+
+    file_.write( reinterpret_cast<const char*>( roll.get_cells().data() ), roll.get_cells().size() );
+    pad_to_alignment();
+    if (!file_) {
+        std::cerr << "Failed to write piano roll for " << roll.get_id() << std::endl;
+        return false;
+    }
+
+    table_.push_back( _entry );
+    return true;
+}
+
+/**
+ * Writes the offset table after the last chorale, then rewrites the header to point to it.
+ *
+ * @return `true` if the file was completed (or was not open), `false` otherwise.
+ */
+bool PianoRollWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+
+    FileHeader _header{};
+    std::memcpy( _header.magic, MAGIC, sizeof(MAGIC) );
+    _header.version = VERSION;
+    _header.choraleCount = table_.size();
+    _header.tableOffset = file_.tellp();
+
+    file_.write( reinterpret_cast<const char*>( table_.data() ), table_.size() * sizeof(TableEntry) );
+    file_.seekp( 0 );
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    file_.close();
+    table_.clear();
+    if (!file_) {
+        std::cerr << "Failed to write piano roll file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Pads the file with zeros so that the next block starts on an ALIGNMENT boundary.
+ */
+void PianoRollWriter::pad_to_alignment() {
+    static const char _zeros[ALIGNMENT] = {};
+    size_t _remainder = static_cast<size_t>( file_.tellp() ) % ALIGNMENT;
+    if (_remainder) {
+        file_.write( _zeros, ALIGNMENT - _remainder );
+    }
+}
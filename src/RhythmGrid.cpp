@@ -0,0 +1,133 @@
+#include "RhythmGrid.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+/**
+ * Parses a grid specification: "auto" for the smallest exact grid of each chorale, or a positive number of
+ *  sub-beats per beat to use for every chorale.
+ *
+ * @param spec The grid specification.
+ * @return `true` if the specification is valid, `false` otherwise.
+ */
+bool RhythmGrid::parse( const std::string& spec ) {
+    if (spec == "auto") {
+        subBeats_ = AUTO;
+        return true;
+    }
+
+    try {
+        size_t _subBeats = std::stoul( spec );
+        if (_subBeats > 0) {
+            subBeats_ = _subBeats;
+            return true;
+        }
+    }
+    catch (std::exception& e) {
+    }
+    std::cerr << "Grid must be 'auto' or a number of sub-beats per beat: " << spec << std::endl;
+    return false;
+}
+
+/**
+ * Finds the smallest grid onto which every part can be rescaled exactly: the least common multiple of the parts'
+ *  own smallest grids.
+ *
+ * @param parts The parts of a chorale.
+ * @return The smallest exact number of sub-beats per beat.
+ */
+size_t RhythmGrid::min_sub_beats( const std::vector<Part*>& parts ) {
+    size_t _subBeats{1};
+    for (const Part* _part : parts) {
+        _subBeats = std::lcm( _subBeats, _part->min_sub_beats() );
+    }
+    return _subBeats;
+}
+
+/**
+ * Rescales the parts of a chorale onto the grid: the fixed grid if one was given, otherwise the smallest grid the
+ *  chorale fits on exactly. The piano-roll columns of the chorale are counted at the reference grid (the grid the
+ *  parts would have been encoded on without this one) and at the new grid.
+ *
+ * A fixed grid that would round a duration or tick is refused, and the parts are left as they were.
+ *
+ * @param parts The parts of a chorale.
+ * @param referenceSubBeats The grid to compare with, in sub-beats per beat.
+ * @return `true` if the parts were rescaled, `false` otherwise.
+ */
+bool RhythmGrid::apply( const std::vector<Part*>& parts, size_t referenceSubBeats ) {
+    if (parts.empty()) {
+        return true;
+    }
+
+    size_t _minSubBeats = min_sub_beats( parts );
+    size_t _subBeats = is_auto() ? _minSubBeats : subBeats_;
+    corpusSubBeats_ = std::lcm( corpusSubBeats_, _minSubBeats );
+    if (_subBeats % _minSubBeats != 0) {
+        std::cerr << "[" << parts[0]->get_id() << "]: A grid of " << _subBeats << " sub-beats per beat "
+            << "would round durations; use a multiple of " << _minSubBeats << std::endl;
+        return false;
+    }
+
+    size_t _columnsBefore{0};
+    for (const Part* _part : parts) {
+        _columnsBefore = std::max( _columnsBefore,
+            count_ticks( *_part ) * referenceSubBeats / _part->get_sub_beats() );
+    }
+
+    size_t _columnsAfter{0};
+    for (Part* _part : parts) {
+        _part->set_sub_beats( _subBeats, /* report =*/ true );
+        _columnsAfter = std::max( _columnsAfter, count_ticks( *_part ) );
+    }
+
+    chorales_++;
+    columnsBefore_ += _columnsBefore;
+    columnsAfter_ += _columnsAfter;
+    referenceSubBeats_ = referenceSubBeats;
+    subBeatsUsed_[_subBeats]++;
+    return true;
+}
+
+/**
+ * Writes a summary of the grids used and the piano-roll columns saved, e.g.
+ *
+ *      Grid: 10240 piano-roll columns instead of 40960 at 8 sub-beats per beat (75.0% saved)
+ *      Sub-beats per beat: 2 (350 chorales), 4 (47 chorales)
+ *      Smallest exact grid for every chorale: 4 sub-beats per beat
+ *
+ * @param os The stream to write to.
+ */
+void RhythmGrid::write_report( std::ostream& os ) const {
+    if (chorales_ > 0) {
+        double _saved = 100.0 * (static_cast<double>( columnsBefore_ ) - columnsAfter_) / std::max<size_t>( columnsBefore_, 1 );
+        os << "Grid: " << columnsAfter_ << " piano-roll columns instead of " << columnsBefore_
+            << " at " << referenceSubBeats_ << " sub-beats per beat (" << std::fixed << std::setprecision( 1 )
+            << _saved << "% saved)" << std::defaultfloat << '\n';
+
+        os << "Sub-beats per beat:";
+        const char* _separator = " ";
+        for (const auto& [_subBeats, _chorales] : subBeatsUsed_) {
+            os << _separator << _subBeats << " (" << _chorales << (_chorales == 1 ? " chorale)" : " chorales)");
+            _separator = ", ";
+        }
+        os << '\n';
+    }
+    else if (corpusSubBeats_ == 1) {
+        return;
+    }
+
+    os << "Smallest exact grid for every chorale: " << corpusSubBeats_
+        << (corpusSubBeats_ == 1 ? " sub-beat per beat" : " sub-beats per beat") << std::endl;
+}
+
+size_t RhythmGrid::count_ticks( const Part& part ) {
+    size_t _ticks{0};
+    for (const auto& _encoding : part.get_encodings()) {
+        _ticks += _encoding->get_duration();
+    }
+    return _ticks;
+}
@@ -0,0 +1,69 @@
+#include "Shard.h"
+
+#include <cctype>
+#include <iostream>
+
+/**
+ * Parses a shard specification in the format "i/N", where N is the number of shards and i is the shard to 
+ *  process (origin 0).
+ *
+ * @param spec The shard specification.
+ * @return `true` if the specification is valid, `false` otherwise.
+ */
+bool Shard::parse( const std::string& spec ) {
+    auto _slash = spec.find( '/' );
+    if (_slash == std::string::npos) {
+        std::cerr << "Shard must be given as i/N: " << spec << std::endl;
+        return false;
+    }
+
+    // each number must be digits only: stoul alone accepts leading spaces, a sign and trailing junk
+    auto _toNumber = []( const std::string& text, size_t& value ) {
+        size_t _end{0};
+        if (text.empty() || !std::isdigit( static_cast<unsigned char>( text.front() ) )) {
+            return false;
+        }
+        value = std::stoul( text, &_end );
+        return _end == text.size();
+    };
+
+    try {
+        size_t _index{0};
+        size_t _count{0};
+        if (!_toNumber( spec.substr( 0, _slash ), _index ) || !_toNumber( spec.substr( _slash + 1 ), _count )) {
+            std::cerr << "Shard must be given as i/N: " << spec << std::endl;
+            return false;
+        }
+        if (_count == 0 || _index >= _count) {
+            std::cerr << "Shard index must be less than the number of shards: " << spec << std::endl;
+            return false;
+        }
+        index_ = _index;
+        count_ = _count;
+    }
+    catch (std::exception& e) {
+        std::cerr << "Shard must be given as i/N: " << spec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Hashes a BWV identifier with 64-bit FNV-1a. Any trailing modifier letters are dropped first, so that
+ *  "BWV 18.5" and "BWV 18.5a" hash to the same value.
+ *
+ * @param bwv The BWV identifier, e.g. "BWV 18.5a".
+ * @return The hash value.
+ */
+uint64_t Shard::hash( std::string_view bwv ) {
+    while (!bwv.empty() && std::islower( static_cast<unsigned char>( bwv.back() ) )) {
+        bwv.remove_suffix( 1 );
+    }
+
+    uint64_t _hash{ 14695981039346656037ull };
+    for (char _ch : bwv) {
+        _hash ^= static_cast<unsigned char>( _ch );
+        _hash *= 1099511628211ull;
+    }
+    return _hash;
+}
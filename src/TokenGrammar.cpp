@@ -0,0 +1,316 @@
+#include "TokenGrammar.h"
+#include "Encoding.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <map>
+
+/**
+ * Compiles the grammar for the tokens of a vocabulary in a meter: classifies each token, then builds the
+ *  transition table and masks of the measure automaton and the masks of the tie automaton. Without the tie rule,
+ *  the tie automaton has a single state that allows every token.
+ *
+ * @param vocabulary The vocabulary whose token IDs the automaton runs on.
+ * @param beatsPerMeasure The beats per measure of the chorales to accept.
+ * @param subBeatsPerBeat The sub-beats per beat they are encoded on.
+ * @param tiesKeepPitch If true, a tied voice must repeat the pitch (or rest) of the same voice before it.
+ * @return `true` if the grammar was built, `false` otherwise.
+ */
+bool TokenGrammar::build( const Vocabulary& vocabulary, size_t beatsPerMeasure, size_t subBeatsPerBeat,
+        bool tiesKeepPitch ) {
+    ticksPerMeasure_ = beatsPerMeasure * subBeatsPerBeat;
+    if (ticksPerMeasure_ == 0) {
+        std::cerr << "A grammar needs a measure of at least one tick" << std::endl;
+        return false;
+    }
+    measureStates_ = 2 + 2 * 2 * (ticksPerMeasure_ + 1);
+    if (measureStates_ >= REJECT) {
+        std::cerr << "A measure of " << ticksPerMeasure_ << " ticks is too long for a grammar" << std::endl;
+        return false;
+    }
+    vocabularySize_ = vocabulary.size();
+    words_ = (vocabularySize_ + 63) / 64;
+
+    std::vector<std::vector<int>> _pitches;
+    std::vector<uint32_t> _tied;
+    if (!classify( vocabulary, _pitches, _tied )) {
+        return false;
+    }
+    if (!tiesKeepPitch) {
+        _pitches.resize( 1 );
+        _tied.assign( vocabularySize_, 0 );
+        pitchSets_.assign( vocabularySize_, NO_PITCHES );
+    }
+    build_measure_automaton();
+    build_tie_automaton( _pitches, _tied );
+    return true;
+}
+
+/**
+ * Returns the state after a token, which must be allowed in the state (see allows()). A marker leaves the pitches
+ *  of the tie automaton as they are, so a note may be tied across it.
+ *
+ * @param state The state.
+ * @param token The token ID.
+ * @return The next state.
+ */
+TokenGrammar::State TokenGrammar::next( const State& state, int32_t token ) const {
+    State _next;
+    _next.measure = transitions_[state.measure * vocabularySize_ + token];
+    _next.pitches = (classes_[token] == NOTE) ? pitchSets_[token] : state.pitches;
+    return _next;
+}
+
+/**
+ * Writes the tokens allowed in a state, the AND of the masks of its measure and tie states.
+ *
+ * @param state The state.
+ * @param mask The mask_words() words to write.
+ */
+void TokenGrammar::allowed( const State& state, uint64_t* mask ) const {
+    const uint64_t* _measureMask = measure_mask( state.measure );
+    const uint64_t* _pitchMask = pitch_mask( state.pitches );
+    for (size_t _w = 0; _w < words_; _w++) {
+        mask[_w] = _measureMask[_w] & _pitchMask[_w];
+    }
+}
+
+/**
+ * Runs a sequence of tokens through the automaton.
+ *
+ * @param tokens The token IDs.
+ * @param state The state to start in, updated to the state after the last token accepted.
+ * @return The number of tokens accepted before the first that is not allowed.
+ */
+size_t TokenGrammar::accept( const std::vector<int32_t>& tokens, State& state ) const {
+    for (size_t _i = 0; _i < tokens.size(); _i++) {
+        if (!allows( state, tokens[_i] )) {
+            return _i;
+        }
+        state = next( state, tokens[_i] );
+    }
+    return tokens.size();
+}
+
+/**
+ * Returns the measure state after a token: [SOC] starts the first measure; a note or chord adds its duration if it
+ *  fits in the measure; [EOP] may follow a note or chord; [EOM] ends any measure that is not empty, as Part allows
+ *  an incomplete measure anywhere; and [EOC] ends the chorale after an [EOM] or within a short last measure. A '.'
+ *  is [SOC] at the start and [EOC] after it.
+ *
+ * @param measureState The measure state.
+ * @param token The token ID.
+ * @return The next measure state, or REJECT if the token is not allowed.
+ */
+uint16_t TokenGrammar::measure_transition( uint32_t measureState, int32_t token ) const {
+    const TokenClass _class = classes_[token];
+    if (measureState == START) {
+        return (_class == SOC || _class == PERIOD) ? in_measure( true, 0, false ) : REJECT;
+    }
+    if (measureState == END || _class == INVALID || _class == SOC) {
+        return REJECT;
+    }
+
+    // decode the position in the measure (see in_measure())
+    size_t _index = measureState - 2;
+    const bool _afterNote = _index & 1;
+    _index /= 2;
+    const bool _first = _index > ticksPerMeasure_;
+    const size_t _ticks = _first ? _index - (ticksPerMeasure_ + 1) : _index;
+
+    switch (_class) {
+        case NOTE:
+            return (_ticks + durations_[token] <= ticksPerMeasure_)
+                ? in_measure( _first, _ticks + durations_[token], true ) : REJECT;
+        case EOP:
+            return _afterNote ? in_measure( _first, _ticks, false ) : REJECT;
+        case EOM:
+            return (_ticks > 0) ? in_measure( false, 0, false ) : REJECT;
+        case EOC:
+        case PERIOD:
+            return ((_ticks == 0 && !_first) || (_ticks > 0 && _ticks < ticksPerMeasure_)) ? END : REJECT;
+        default:
+            return REJECT;
+    }
+}
+
+/**
+ * Classifies each token of the vocabulary as a marker, or a note or chord; only <PAD> and <UNK> are invalid. A
+ *  note or chord is parsed as Part::parse_encoding() parses it, and its pitches (MIDI numbers, 0 for a rest) become
+ *  a state of the tie automaton, shared by every token with the same pitches. Any other token, or a vocabulary
+ *  without [EOM], means the encodings are in a format the grammar cannot follow, which is reported.
+ *
+ * @param vocabulary The vocabulary.
+ * @param pitches Set to the pitches of each tie automaton state, starting with NO_PITCHES (none).
+ * @param tied Set to the tied voices of each token, bit v for voice v.
+ * @return `true` if every token was classified, `false` otherwise.
+ */
+bool TokenGrammar::classify( const Vocabulary& vocabulary, std::vector<std::vector<int>>& pitches,
+        std::vector<uint32_t>& tied ) {
+    classes_.assign( vocabularySize_, INVALID );
+    durations_.assign( vocabularySize_, 0 );
+    pitchSets_.assign( vocabularySize_, NO_PITCHES );
+    tied.assign( vocabularySize_, 0 );
+    pitches.assign( 1, {} );
+    std::map<std::vector<int>, uint32_t> _pitchSetIds;
+    auto _unsupported = []( const std::string& token ) {
+        std::cerr << "The grammar cannot check token " << token << ": it is written for encodings in the default "
+            << "format or with -e (not --noEOM, -c, -C, --intervals or --voices)" << std::endl;
+        return false;
+    };
+
+    for (size_t _id = 0; _id < vocabularySize_; _id++) {
+        const std::string& _token = vocabulary.get_token( _id );
+        if (_token == Vocabulary::PAD || _token == Vocabulary::UNK) {
+            continue;
+        }
+        else if (_token == Marker::SOC_STR) {
+            classes_[_id] = SOC;
+            continue;
+        }
+        else if (_token == Marker::EOM_STR) {
+            classes_[_id] = EOM;
+            continue;
+        }
+        else if (_token == Marker::EOP_STR) {
+            classes_[_id] = EOP;
+            continue;
+        }
+        else if (_token == Marker::EOC_STR) {
+            classes_[_id] = EOC;
+            continue;
+        }
+        else if (_token == ".") {
+            classes_[_id] = PERIOD;
+            continue;
+        }
+
+        // a note or chord ends in its duration
+        auto _dot = _token.rfind( '.' );
+        if (_dot == std::string::npos || _dot + 1 == _token.size()
+                || !std::all_of( _token.begin() + _dot + 1, _token.end(), ::isdigit )) {
+            return _unsupported( _token );
+        }
+        std::vector<Note> _notes;
+        unsigned int _duration{0};
+        if (std::count( _token.begin(), _token.end(), '.' ) > 2) {
+            Chord _chord{ _token };
+            if (!_chord.is_valid()) {
+                return _unsupported( _token );
+            }
+            _notes = _chord.get_notes();
+            _duration = _chord.get_duration();
+        }
+        else {
+            Note _note{ _token };
+            if (!_note.is_valid()) {
+                return _unsupported( _token );
+            }
+            _notes.push_back( _note );
+            _duration = _note.get_duration();
+        }
+        if (_duration == 0 || _notes.size() > 32) {
+            return _unsupported( _token );
+        }
+
+        std::vector<int> _pitches;
+        for (size_t _voice = 0; _voice < _notes.size(); _voice++) {
+            _pitches.push_back( _notes[_voice].get_midi_pitch() );
+            if (_notes[_voice].get_tied()) {
+                tied[_id] |= uint32_t{1} << _voice;
+            }
+        }
+        auto [_it, _inserted] = _pitchSetIds.try_emplace( _pitches, static_cast<uint32_t>( pitches.size() ) );
+        if (_inserted) {
+            pitches.push_back( std::move( _pitches ) );
+        }
+        classes_[_id] = NOTE;
+        durations_[_id] = _duration;
+        pitchSets_[_id] = _it->second;
+    }
+
+    if (std::find( classes_.begin(), classes_.end(), EOM ) == classes_.end()) {
+        std::cerr << "The grammar needs the measures of the encodings marked with [EOM] (not written with --noEOM)"
+            << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Fills the transition table of the measure automaton, and the mask of the tokens each of its states allows.
+ */
+void TokenGrammar::build_measure_automaton() {
+    transitions_.assign( measureStates_ * vocabularySize_, REJECT );
+    measureMasks_.assign( measureStates_ * words_, 0 );
+    for (uint32_t _state = 0; _state < measureStates_; _state++) {
+        uint16_t* _transitions = &transitions_[_state * vocabularySize_];
+        uint64_t* _mask = &measureMasks_[_state * words_];
+        for (size_t _token = 0; _token < vocabularySize_; _token++) {
+            _transitions[_token] = measure_transition( _state, _token );
+            if (_transitions[_token] != REJECT) {
+                set( _mask, _token );
+            }
+        }
+    }
+}
+
+/**
+ * Fills the mask of the tokens each state of the tie automaton allows: every token with no tied voice, and each
+ *  token whose tied voices all have the pitch (or rest) of the same voice of the state. The tied tokens
+ *  are grouped by their tied voices and the pitches of those voices, so each state looks up one group for each
+ *  combination of tied voices in the vocabulary rather than testing every token.
+ *
+ * @param pitches The pitches of each tie automaton state.
+ * @param tied The tied voices of each token.
+ */
+void TokenGrammar::build_tie_automaton( const std::vector<std::vector<int>>& pitches,
+        const std::vector<uint32_t>& tied ) {
+    pitchStates_ = pitches.size();
+    pitchMasks_.assign( pitchStates_ * words_, 0 );
+
+    // a group is keyed by the voices of the token, its tied voices, and the pitches of those voices
+    auto _key = []( const std::vector<int>& pitches, uint32_t tiedVoices ) {
+        std::vector<int> _key{ static_cast<int>( pitches.size() ), static_cast<int>( tiedVoices ) };
+        for (size_t _voice = 0; _voice < pitches.size(); _voice++) {
+            if ((tiedVoices >> _voice) & 1) {
+                _key.push_back( pitches[_voice] );
+            }
+        }
+        return _key;
+    };
+    std::map<std::vector<int>, std::vector<int32_t>> _groups;
+    std::map<size_t, std::vector<uint32_t>> _tiedVoicesByVoices;
+    std::vector<uint64_t> _untied( words_, 0 );
+    for (size_t _token = 0; _token < vocabularySize_; _token++) {
+        if (!tied[_token]) {
+            set( _untied.data(), _token );
+            continue;
+        }
+        const std::vector<int>& _pitches = pitches[pitchSets_[_token]];
+        _groups[_key( _pitches, tied[_token] )].push_back( _token );
+        auto& _tiedVoices = _tiedVoicesByVoices[_pitches.size()];
+        if (std::find( _tiedVoices.begin(), _tiedVoices.end(), tied[_token] ) == _tiedVoices.end()) {
+            _tiedVoices.push_back( tied[_token] );
+        }
+    }
+
+    for (size_t _state = 0; _state < pitchStates_; _state++) {
+        uint64_t* _mask = &pitchMasks_[_state * words_];
+        std::copy( _untied.begin(), _untied.end(), _mask );
+        if (_state == NO_PITCHES) {
+            continue;
+        }
+
+        const std::vector<int>& _pitches = pitches[_state];
+        for (uint32_t _tiedVoices : _tiedVoicesByVoices[_pitches.size()]) {
+            auto _group = _groups.find( _key( _pitches, _tiedVoices ) );
+            if (_group != _groups.end()) {
+                for (int32_t _token : _group->second) {
+                    set( _mask, _token );
+                }
+            }
+        }
+    }
+}
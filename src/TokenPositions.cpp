@@ -0,0 +1,103 @@
+#include "TokenPositions.h"
+#include "Part.h"
+
+#include <cstring>
+#include <iostream>
+
+/**
+ * Opens the output file and writes a placeholder header, which is completed by close().
+ *
+ * @param path The path of the file to create.
+ * @return `true` if the file was opened, `false` otherwise.
+ */
+bool TokenPositionsWriter::open( const std::string& path ) {
+    file_.open( path, std::ios::out | std::ios::binary );
+    if (!file_) {
+        std::cerr << "Failed to open positions file: " << path << std::endl;
+        return false;
+    }
+
+    FileHeader _header{};
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    pad_to_alignment();
+    return true;
+}
+
+/**
+ * Appends the arrays of a line's token positions to the file and records their place in the offset table.
+ *
+ * @param part The part the line was written for.
+ * @param positions The positions of the line's tokens.
+ * @return `true` if the positions were written, `false` otherwise.
+ */
+bool TokenPositionsWriter::add( const Part& part, const TokenPositions& positions ) {
+    TableEntry _entry{};
+    _entry.offset = file_.tellp();
+    _entry.tokens = positions.size();
+    _entry.subBeatsPerBeat = part.get_sub_beats();
+    std::strncpy( _entry.id, part.get_id().c_str(), sizeof(_entry.id) - 1 );
+    std::strncpy( _entry.part, part.get_part_name().c_str(), sizeof(_entry.part) - 1 );
+
+    write_array( positions.get_measures().data(), positions.size() * sizeof(uint16_t) );
+    write_array( positions.get_beats().data(), positions.size() );
+    write_array( positions.get_sub_beats().data(), positions.size() );
+    write_array( positions.get_voices().data(), positions.size() );
+    write_array( positions.get_tied().data(), positions.size() );
+    if (!file_) {
+        std::cerr << "Failed to write positions for " << part.get_id() << ' ' << part.get_part_name() << std::endl;
+        return false;
+    }
+
+    table_.push_back( _entry );
+    return true;
+}
+
+/**
+ * Writes the offset table after the last line, then rewrites the header to point to it.
+ *
+ * @return `true` if the file was completed (or was not open), `false` otherwise.
+ */
+bool TokenPositionsWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+
+    FileHeader _header{};
+    std::memcpy( _header.magic, MAGIC, sizeof(MAGIC) );
+    _header.version = VERSION;
+    _header.lineCount = table_.size();
+    _header.tableOffset = file_.tellp();
+
+    file_.write( reinterpret_cast<const char*>( table_.data() ), table_.size() * sizeof(TableEntry) );
+    file_.seekp( 0 );
+    file_.write( reinterpret_cast<const char*>( &_header ), sizeof(_header) );
+    file_.close();
+    table_.clear();
+    if (!file_) {
+        std::cerr << "Failed to write positions file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes one array of a line, padded so that the next array starts on an ALIGNMENT boundary.
+ *
+ * @param data The array.
+ * @param bytes Its size in bytes.
+ */
+void TokenPositionsWriter::write_array( const void* data, size_t bytes ) {
+    file_.write( static_cast<const char*>( data ), bytes );
+    pad_to_alignment();
+}
+
+/**
+ * Pads the file with zeros so that the next block starts on an ALIGNMENT boundary.
+ */
+void TokenPositionsWriter::pad_to_alignment() {
+    static const char _zeros[ALIGNMENT] = {};
+    size_t _remainder = static_cast<size_t>( file_.tellp() ) % ALIGNMENT;
+    if (_remainder) {
+        file_.write( _zeros, ALIGNMENT - _remainder );
+    }
+}
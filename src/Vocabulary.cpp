@@ -0,0 +1,64 @@
+#include "Vocabulary.h"
+
+#include <fstream>
+#include <iostream>
+
+void Vocabulary::clear() {
+    tokens_.clear();
+    ids_.clear();
+    add( PAD );
+    add( UNK );
+}
+
+int32_t Vocabulary::add( const std::string& token ) {
+    auto [_it, _added] = ids_.emplace( token, static_cast<int32_t>( tokens_.size() ) );
+    if (_added) {
+        tokens_.push_back( token );
+    }
+    return _it->second;
+}
+
+/**
+ * Reads a vocabulary written by write(). The file must start with the reserved tokens, so that their IDs are the
+ *  same in every vocabulary.
+ *
+ * @param path The path of the vocabulary file.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool Vocabulary::load( const std::string& path ) {
+    std::ifstream _file{ path };
+    if (!_file) {
+        std::cerr << "Error opening vocabulary file: " << path << std::endl;
+        return false;
+    }
+
+    tokens_.clear();
+    ids_.clear();
+    for (std::string _token; std::getline( _file, _token ); ) {
+        if (ids_.contains( _token )) {
+            std::cerr << "Duplicate token in " << path << ": " << _token << std::endl;
+            clear();
+            return false;
+        }
+        add( _token );
+    }
+
+    if (tokens_.size() < 2 || tokens_[PAD_ID] != PAD || tokens_[UNK_ID] != UNK) {
+        std::cerr << "Vocabulary file must start with " << PAD << " and " << UNK << ": " << path << std::endl;
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool Vocabulary::write( const std::string& path ) const {
+    std::ofstream _file{ path };
+    if (!_file) {
+        std::cerr << "Failed to open vocabulary file: " << path << std::endl;
+        return false;
+    }
+    for (const std::string& _token : tokens_) {
+        _file << _token << '\n';
+    }
+    return static_cast<bool>( _file );
+}
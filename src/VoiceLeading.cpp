@@ -0,0 +1,238 @@
+#include "VoiceLeading.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * Checks the chords of a combined part: packs them, then looks for parallels between every pair of voices,
+ *  crossings between adjacent voices, and notes outside the range of each voice.
+ *
+ * @param part The combined part to check.
+ * @return `true` if the part was checked, `false` if it has no chords or its chords have different voices.
+ */
+bool VoiceLeading::check( const Part& part ) {
+    violations_.clear();
+    if (!pack( part )) {
+        return false;
+    }
+
+    flags_.assign( chords_, 0 );
+    for (size_t _upper = 0; _upper < voices_; _upper++) {
+        for (size_t _lower = _upper + 1; _lower < voices_; _lower++) {
+            check_parallels( _upper, _lower );
+        }
+        if (_upper + 1 < voices_) {
+            check_crossing( _upper, _upper + 1 );
+        }
+        Range _range;
+        if (get_range( voices_, _upper, _range )) {
+            check_range( _upper, _range );
+        }
+    }
+
+    std::stable_sort( violations_.begin(), violations_.end(), []( const Violation& a, const Violation& b ) {
+        return a.chord < b.chord;
+    } );
+    return true;
+}
+
+/**
+ * Counts the violations of one rule.
+ *
+ * @param rule The rule.
+ * @return The number of violations.
+ */
+size_t VoiceLeading::count( Rule rule ) const {
+    return std::count_if( violations_.begin(), violations_.end(), [rule]( const Violation& violation ) {
+        return violation.rule == rule;
+    } );
+}
+
+/**
+ * Describes a violation: the rule, the voices and the location of the chord, as Part::location_to_string() gives
+ *  it.
+ *
+ * @param violation The violation.
+ * @return The description.
+ */
+std::string VoiceLeading::to_string( const Violation& violation ) const {
+    std::string _description = std::string{ RULE_NAMES[violation.rule] } + ", "
+        + voice_name( voices_, violation.upper );
+    if (violation.lower != violation.upper) {
+        _description += " and " + voice_name( voices_, violation.lower );
+    }
+    return _description + ' ' + part_->location_to_string( encodings_[violation.chord] );
+}
+
+/**
+ * Names a voice of a chord.
+ *
+ * @param voices The number of voices in the chord.
+ * @param voice The voice (origin 0, highest first).
+ * @return The name of the voice.
+ */
+std::string VoiceLeading::voice_name( size_t voices, size_t voice ) {
+    static const char* _fourVoices[] = { "Soprano", "Alto", "Tenor", "Bass" };
+    static const char* _fiveVoices[] = { "Soprano 1", "Soprano 2", "Alto", "Tenor", "Bass" };
+    if (voices == 4) {
+        return _fourVoices[voice];
+    }
+    else if (voices == 5) {
+        return _fiveVoices[voice];
+    }
+    return "Voice " + std::to_string( voice + 1 );
+}
+
+/**
+ * Packs the chords of a part into the pitch and onset arrays, one row per voice, skipping markers.
+ *
+ * @param part The part.
+ * @return `true` if the part was packed, `false` if it has no chords or its chords have different voices.
+ */
+bool VoiceLeading::pack( const Part& part ) {
+    part_ = &part;
+    encodings_.clear();
+    voices_ = 0;
+    for (const auto& _encoding : part.get_encodings()) {
+        if (!_encoding->is_chord()) {
+            continue;
+        }
+        size_t _voices = static_cast<const Chord&>( *_encoding ).get_notes().size();
+        if (voices_ == 0) {
+            voices_ = _voices;
+        }
+        else if (_voices != voices_) {
+            std::cerr << "Chords of " << _voices << " and " << voices_ << " voices in " << part.get_id()
+                << std::endl;
+            return false;
+        }
+        encodings_.push_back( _encoding.get() );
+    }
+    chords_ = encodings_.size();
+    if (chords_ == 0) {
+        std::cerr << "No chords to check in " << part.get_id() << ' ' << part.get_part_name() << std::endl;
+        return false;
+    }
+
+    pitches_.assign( voices_ * chords_, 0 );
+    onsets_.assign( voices_ * chords_, 0 );
+    for (size_t _chord = 0; _chord < chords_; _chord++) {
+        const auto& _notes = static_cast<const Chord*>( encodings_[_chord] )->get_notes();
+        for (size_t _voice = 0; _voice < voices_; _voice++) {
+            const Note& _note = _notes[_voice];
+            pitches_[_voice * chords_ + _chord] = static_cast<uint8_t>( _note.get_midi_pitch() & 0x7f );
+            onsets_[_voice * chords_ + _chord] = !_note.is_rest() && !_note.get_tied();
+        }
+    }
+    return true;
+}
+
+/**
+ * Flags the chords that a pair of voices moves into in parallel fifths or octaves: both voices sound in both chords,
+ *  both move in the same direction, and the interval between them is a fifth (or an octave or unison), give or take
+ *  octaves, in both chords.
+ *
+ * @param upper The upper voice.
+ * @param lower The lower voice.
+ */
+void VoiceLeading::check_parallels( size_t upper, size_t lower ) {
+    constexpr uint8_t FIFTHS = 1;
+    constexpr uint8_t OCTAVES = 2;
+    const uint8_t* _upper = &pitches_[upper * chords_];
+    const uint8_t* _lower = &pitches_[lower * chords_];
+    uint8_t* _flags = flags_.data();
+
+    for (size_t _i = 1; _i < chords_; _i++) {
+        const int _upperMotion = _upper[_i] - _upper[_i - 1];
+        const int _lowerMotion = _lower[_i] - _lower[_i - 1];
+        const int _before = mod12( std::abs( _upper[_i - 1] - _lower[_i - 1] ) );
+        const int _after = mod12( std::abs( _upper[_i] - _lower[_i] ) );
+        const bool _sounding = (_upper[_i - 1] != 0) & (_lower[_i - 1] != 0) & (_upper[_i] != 0) & (_lower[_i] != 0);
+        const bool _similar = ((_upperMotion > 0) & (_lowerMotion > 0)) | ((_upperMotion < 0) & (_lowerMotion < 0));
+        const bool _parallel = _sounding & _similar & (_before == _after);
+        _flags[_i] = (_parallel & (_after == 7)) * FIFTHS | (_parallel & (_after == 0)) * OCTAVES;
+    }
+    _flags[0] = 0;
+
+    collect( PARALLEL_FIFTHS, upper, lower, FIFTHS );
+    collect( PARALLEL_OCTAVES, upper, lower, OCTAVES );
+}
+
+/**
+ * Flags the chords where an upper voice strikes a note below the adjacent lower voice, or the lower voice strikes
+ *  one above it, so a crossing is reported where it starts or changes rather than for every chord it lasts.
+ *
+ * @param upper The upper voice.
+ * @param lower The lower voice, the one below it.
+ */
+void VoiceLeading::check_crossing( size_t upper, size_t lower ) {
+    const uint8_t* _upper = &pitches_[upper * chords_];
+    const uint8_t* _lower = &pitches_[lower * chords_];
+    const uint8_t* _upperOnsets = &onsets_[upper * chords_];
+    const uint8_t* _lowerOnsets = &onsets_[lower * chords_];
+    uint8_t* _flags = flags_.data();
+
+    for (size_t _i = 0; _i < chords_; _i++) {
+        _flags[_i] = (_upper[_i] != 0) & (_upper[_i] < _lower[_i]) & (_upperOnsets[_i] | _lowerOnsets[_i]);
+    }
+
+    collect( VOICE_CROSSING, upper, lower, 1 );
+}
+
+/**
+ * Flags the chords where a voice strikes a note outside its range.
+ *
+ * @param voice The voice.
+ * @param range Its range.
+ */
+void VoiceLeading::check_range( size_t voice, Range range ) {
+    const uint8_t* _pitches = &pitches_[voice * chords_];
+    const uint8_t* _onsets = &onsets_[voice * chords_];
+    uint8_t* _flags = flags_.data();
+
+    for (size_t _i = 0; _i < chords_; _i++) {
+        _flags[_i] = _onsets[_i] & ((_pitches[_i] < range.low) | (_pitches[_i] > range.high));
+    }
+
+    collect( RANGE, voice, voice, 1 );
+}
+
+/**
+ * Adds a violation for each chord whose flags have the given bit set.
+ *
+ * @param rule The rule violated.
+ * @param upper The upper voice.
+ * @param lower The lower voice.
+ * @param flag The bit of flags_ that marks the rule.
+ */
+void VoiceLeading::collect( Rule rule, size_t upper, size_t lower, uint8_t flag ) {
+    for (size_t _i = 0; _i < chords_; _i++) {
+        if (flags_[_i] & flag) {
+            violations_.push_back( Violation{ rule, static_cast<uint8_t>( upper ), static_cast<uint8_t>( lower ),
+                static_cast<uint32_t>( _i ) } );
+        }
+    }
+}
+
+/**
+ * Looks up the range of a voice of the usual four (Soprano, Alto, Tenor, Bass) or five (with two sopranos).
+ *
+ * @param voices The number of voices.
+ * @param voice The voice (origin 0, highest first).
+ * @param range Set to its range.
+ * @return `true` if the voice has a range, `false` for any other number of voices.
+ */
+bool VoiceLeading::get_range( size_t voices, size_t voice, Range& range ) {
+    static constexpr Range _fourVoices[] = { SOPRANO_RANGE, ALTO_RANGE, TENOR_RANGE, BASS_RANGE };
+    static constexpr Range _fiveVoices[] = { SOPRANO_RANGE, SOPRANO_RANGE, ALTO_RANGE, TENOR_RANGE, BASS_RANGE };
+    if (voices == 4) {
+        range = _fourVoices[voice];
+        return true;
+    }
+    else if (voices == 5) {
+        range = _fiveVoices[voice];
+        return true;
+    }
+    return false;
+}
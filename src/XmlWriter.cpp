@@ -0,0 +1,122 @@
+#include "XmlWriter.h"
+
+/**
+ * Writes the xml declaration and, if given, a doctype line.
+ *
+ * @param doctype The complete doctype line, e.g. "<!DOCTYPE score-partwise ...>", or empty for none.
+ */
+void XmlWriter::declaration( std::string_view doctype ) {
+    os_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    if (!doctype.empty()) {
+        os_ << doctype << '\n';
+    }
+}
+
+/**
+ * Writes the start tag of an element that will contain other elements.
+ *
+ * @param name The element name.
+ * @param attributes The element's attributes, in order.
+ */
+void XmlWriter::open( std::string_view name, Attributes attributes ) {
+    indent();
+    os_ << '<' << name;
+    write_attributes( attributes );
+    os_ << ">\n";
+    openElements_.emplace_back( name );
+}
+
+/**
+ * Writes the end tag of the most recently opened element.
+ */
+void XmlWriter::close() {
+    if (openElements_.empty()) {
+        return;
+    }
+    std::string _name = std::move( openElements_.back() );
+    openElements_.pop_back();
+    indent();
+    os_ << "</" << _name << ">\n";
+}
+
+/**
+ * Writes an element containing only text.
+ *
+ * @param name The element name.
+ * @param text The text, which is escaped as needed.
+ * @param attributes The element's attributes, in order.
+ */
+void XmlWriter::element( std::string_view name, std::string_view text, Attributes attributes ) {
+    indent();
+    os_ << '<' << name;
+    write_attributes( attributes );
+    os_ << '>';
+    write_escaped( text );
+    os_ << "</" << name << ">\n";
+}
+
+/**
+ * Writes an element with no content.
+ *
+ * @param name The element name.
+ * @param attributes The element's attributes, in order.
+ */
+void XmlWriter::empty( std::string_view name, Attributes attributes ) {
+    indent();
+    os_ << '<' << name;
+    write_attributes( attributes );
+    os_ << "/>\n";
+}
+
+/**
+ * Closes every element that is still open.
+ */
+void XmlWriter::finish() {
+    while (!openElements_.empty()) {
+        close();
+    }
+}
+
+void XmlWriter::indent() {
+    for (size_t _level = 0; _level < openElements_.size(); _level++) {
+        os_ << "  ";
+    }
+}
+
+void XmlWriter::write_attributes( Attributes attributes ) {
+    for (const auto& [_name, _value] : attributes) {
+        os_ << ' ' << _name << "=\"";
+        write_escaped( _value );
+        os_ << '"';
+    }
+}
+
+/**
+ * Writes text with the five xml special characters replaced by entities.
+ *
+ * @param text The text to write.
+ */
+void XmlWriter::write_escaped( std::string_view text ) {
+    for (char _c : text) {
+        switch (_c) {
+            case '<':
+                os_ << "&lt;";
+                break;
+            case '>':
+                os_ << "&gt;";
+                break;
+            case '&':
+                os_ << "&amp;";
+                break;
+            case '"':
+                os_ << "&quot;";
+                break;
+            case '\'':
+                os_ << "&apos;";
+                break;
+            default:
+                os_ << _c;
+                break;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "MelodyIndex.h"
+#include "ThreadPool.h"
+
+#include <args.hxx>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * The main entry point of the application. This program builds an index of the melodic n-grams of a file of
+ *  encodings, to be searched by queryMelodyIndex for passages copied from it.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the index was written, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program builds an index of the melodies of a file of encodings", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to index"};
+    args::ValueFlag<size_t> _ngramParm{_parser, "ngram", "Intervals per n-gram (default: 8)", {'n', "ngram"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Index file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched() || !_outputFileParm.Matched()) {
+        std::cerr << "A source and an output file are required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+    size_t _ngram = _ngramParm ? args::get( _ngramParm ) : 8;
+    if (_ngram == 0) {
+        std::cerr << "ngram must be positive" << std::endl;
+        return 1;
+    }
+
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    std::vector<MelodyIndex::Melody> _melodies;
+    if (!MelodyIndex::read_melodies( args::get( _sourceParm ), _pool, _melodies )) {
+        return 1;
+    }
+
+    MelodyIndexWriter _writer;
+    for (auto& _melody : _melodies) {
+        _writer.add( std::move( _melody ) );
+    }
+    if (!_writer.write( args::get( _outputFileParm ), _ngram, _pool )) {
+        return 1;
+    }
+
+    MelodyIndex _index;
+    if (!_index.open( args::get( _outputFileParm ) )) {
+        return 1;
+    }
+    std::cout << "Indexed " << _index.part_count() << " melodies: " << _index.note_count() << " notes, "
+        << _index.key_count() << " distinct " << _ngram << "-interval n-grams" << std::endl;
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "GzipStream.h"
+#include "Part.h"
+#include "ThreadPool.h"
+#include "VoiceLeading.h"
+
+#include <args.hxx>
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// the results for a contiguous range of lines
+struct Partial {
+    std::string rows;
+    size_t checked{0};
+    size_t unreadable{0};
+    size_t chords{0};
+    std::array<size_t, VoiceLeading::RULE_COUNT> violations{};
+};
+
+/**
+ * Checks a contiguous range of lines, each a combined part, and writes a row for each.
+ *
+ * @param first The first line.
+ * @param last One past the last line.
+ * @param verbose If true, each violation is written after the row of its chorale.
+ * @return The rows and the totals for the lines.
+ */
+Partial check_lines( const std::string* first, const std::string* last, bool verbose ) {
+    Partial _partial;
+    std::ostringstream _os;
+    VoiceLeading _checker;
+    for (const std::string* _line = first; _line != last; _line++) {
+        Part _part;
+        if (!_line->starts_with( Part::SOH + Part::ID ) || !_part.parse_encoding( *_line )
+                || !_checker.check( _part )) {
+            _partial.unreadable++;
+            continue;
+        }
+
+        _partial.checked++;
+        _partial.chords += _checker.chord_count();
+        _os << _part.get_id() << '\t' << _checker.chord_count();
+        for (size_t _rule = 0; _rule < VoiceLeading::RULE_COUNT; _rule++) {
+            size_t _count = _checker.count( static_cast<VoiceLeading::Rule>( _rule ) );
+            _partial.violations[_rule] += _count;
+            _os << '\t' << _count;
+        }
+        _os << '\n';
+        if (verbose) {
+            for (const auto& _violation : _checker.get_violations()) {
+                _os << "#\t" << _checker.to_string( _violation ) << '\n';
+            }
+        }
+    }
+    _partial.rows = _os.str();
+    return _partial;
+}
+
+/**
+ * The main entry point of the application. This program checks the chords of a file of combined encodings (e.g.
+ *  generated chorales) for parallel fifths and octaves, voice crossing and notes out of range, to score a set of
+ *  samples.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the file was checked, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program checks the voice leading of a file of combined encodings", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to check"};
+    args::Flag _verboseParm{_parser, "verbose", "List each violation after the row of its chorale", {'v', "verbose"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Output file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    auto _file = GzipStream::open_input( args::get( _sourceParm ) );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << args::get( _sourceParm ) << std::endl;
+        return 1;
+    }
+    std::vector<std::string> _lines;
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        if (!_line.empty()) {
+            _lines.push_back( std::move( _line ) );
+        }
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << args::get( _sourceParm ) << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<std::ostream> _outputFile;
+    if (_outputFileParm) {
+        _outputFile = GzipStream::open_output( args::get( _outputFileParm ) );
+        if (!*_outputFile) {
+            std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& _os = _outputFile ? *_outputFile : std::cout;
+    _os << "# id\tchords";
+    for (const char* _name : VoiceLeading::RULE_NAMES) {
+        _os << '\t' << _name;
+    }
+    _os << '\n';
+
+    // check contiguous ranges of lines on the pool, and write the results in order
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    bool _verbose = args::get( _verboseParm );
+    Partial _total;
+    for (const Partial& _result : _pool.map_ranges( _lines.size(), [&_lines, _verbose]( size_t first, size_t last ) {
+            return check_lines( _lines.data() + first, _lines.data() + last, _verbose );
+        } )) {
+        _os << _result.rows;
+        _total.checked += _result.checked;
+        _total.unreadable += _result.unreadable;
+        _total.chords += _result.chords;
+        for (size_t _rule = 0; _rule < VoiceLeading::RULE_COUNT; _rule++) {
+            _total.violations[_rule] += _result.violations[_rule];
+        }
+    }
+    _os.flush();
+    bool _written = _outputFile ? GzipStream::close_output( *_outputFile, args::get( _outputFileParm ) )
+        : static_cast<bool>( _os );
+
+    // summarize, per thousand chords so sample sets of any size can be compared
+    std::cout << "Checked " << _total.checked << (_total.checked == 1 ? " chorale" : " chorales") << ", "
+        << _total.chords << " chords";
+    if (_total.unreadable) {
+        std::cout << " (" << _total.unreadable << " unreadable)";
+    }
+    std::cout << '\n';
+    for (size_t _rule = 0; _rule < VoiceLeading::RULE_COUNT; _rule++) {
+        std::cout << "  " << std::left << std::setw( 18 ) << VoiceLeading::RULE_NAMES[_rule] << std::right
+            << std::setw( 8 ) << _total.violations[_rule] << std::fixed << std::setprecision( 2 )
+            << std::setw( 10 ) << (_total.chords ? 1000.0 * _total.violations[_rule] / _total.chords : 0.0)
+            << " per 1000 chords\n";
+    }
+    return _written ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include "BatchRing.h"
+#include "Vocabulary.h"
+
+#include <args.hxx>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/**
+ * The main entry point of the application. This program is a stand-in for a trainer: it reads the batches served by
+ *  serveBatches in place, and reports how many it read, how much of them is padding, how fast they came and a
+ *  checksum of their token IDs.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the batches were read, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program reads the batches of token IDs served by serveBatches", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::ValueFlag<std::string> _nameParm{_parser, "name",
+        "Name of the shared memory (default: /choraleGPT-batches)", {"name"}};
+    args::ValueFlag<uint64_t> _batchesParm{_parser, "batches", "Stop after this many batches (default: all)",
+        {'n', "batches"}};
+    args::ValueFlag<std::string> _vocabParm{_parser, "vocabulary", "Vocabulary file to decode the first row with",
+        {'v', "vocab"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    Vocabulary _vocabulary;
+    if (_vocabParm && !_vocabulary.load( args::get( _vocabParm ) )) {
+        return 1;
+    }
+
+    BatchRing _ring;
+    if (!_ring.attach( _nameParm ? args::get( _nameParm ) : "/choraleGPT-batches" )) {
+        return 1;
+    }
+    const BatchRing::Header& _header = _ring.get_header();
+    size_t _ids = static_cast<size_t>( _header.batchSize ) * _header.sequenceLength;
+
+    uint64_t _batches{0};
+    uint64_t _padding{0};
+    uint64_t _checksum{0};
+    auto _start = std::chrono::steady_clock::now();
+    while (!_batchesParm || _batches < args::get( _batchesParm )) {
+        const int32_t* _batch = _ring.next_batch();
+        if (!_batch) {
+            break;
+        }
+        if (_batches == 0 && _vocabParm) {
+            for (size_t _i = 0; _i < _header.sequenceLength && _batch[_i] != Vocabulary::PAD_ID; _i++) {
+                std::cout << (_i ? " " : "") << _vocabulary.get_token( _batch[_i] );
+            }
+            std::cout << std::endl;
+        }
+        for (size_t _i = 0; _i < _ids; _i++) {
+            _padding += _batch[_i] == Vocabulary::PAD_ID;
+            _checksum = _checksum * 1000003 + static_cast<uint32_t>( _batch[_i] );
+        }
+        _ring.release();
+        _batches++;
+    }
+    double _seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - _start ).count();
+
+    std::cout << "Read " << _batches << (_batches == 1 ? " batch" : " batches") << " of " << _header.batchSize
+        << " x " << _header.sequenceLength << " token IDs (" << _header.vocabularySize << " token vocabulary)"
+        << std::endl;
+    std::cout << std::fixed << std::setprecision( 1 ) << "Padding: "
+        << (_batches ? 100.0 * _padding / (_batches * _ids) : 0.0) << "%" << std::endl;
+    std::cout << "Throughput: " << (_seconds > 0 ? _batches / _seconds : 0.0) << " batches per second" << std::endl;
+    std::cout << "Checksum: " << std::hex << std::setw( 16 ) << std::setfill( '0' ) << _checksum << std::endl;
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "Arguments.h"
+#include "Chorale.h"
+#include "EncodingReader.h"
+#include "CorpusStats.h"
+#include "GzipStream.h"
+#include "Part.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using ChoraleLines = EncodingReader::ChoraleLines;
+
+/**
+ * Counts a range of chorales read from a file of encodings.
+ *
+ * @param first The first chorale of the range.
+ * @param last One past the last chorale of the range.
+ * @return The counts for the range.
+ */
+CorpusStats count_encodings( const ChoraleLines* first, const ChoraleLines* last ) {
+    CorpusStats _stats;
+    std::vector<std::unique_ptr<Part>> _parts;
+    for (const ChoraleLines* _chorale = first; _chorale != last; _chorale++) {
+        _parts.clear();
+        for (const std::string& _line : *_chorale) {
+            auto _part = std::make_unique<Part>();
+            if (_part->parse_encoding( _line )) {
+                _parts.push_back( std::move( _part ) );
+            }
+        }
+        _stats.add_chorale( _parts );
+    }
+    return _stats;
+}
+
+/**
+ * Counts a range of chorales read from musicXml, encoding the requested parts the way inputXml does. A part the
+ *  chorale lacks is reported and skipped.
+ *
+ * @param first The first chorale of the range.
+ * @param last One past the last chorale of the range.
+ * @param partsToParse The names of the parts to encode.
+ * @return The counts for the range.
+ */
+CorpusStats count_xml( std::unique_ptr<Chorale>* first, std::unique_ptr<Chorale>* last,
+        const std::vector<std::string>& partsToParse ) {
+    CorpusStats _stats;
+    std::vector<std::unique_ptr<Part>> _parts;
+    for (auto _chorale = first; _chorale != last; _chorale++) {
+        if (!(*_chorale)->load_xml()) {
+            std::cerr << "Failed to load xml source for " << (*_chorale)->get_BWV() << std::endl;
+            continue;
+        }
+        (*_chorale)->load_parts( partsToParse );
+        if (!(*_chorale)->encode_parts()) {
+            std::cerr << "Failed to encode parts for " << (*_chorale)->get_BWV() << std::endl;
+            continue;
+        }
+
+        // a missing part is Chorale's shared null part, which must not be moved from
+        _parts.clear();
+        for (const std::string& _partName : partsToParse) {
+            std::unique_ptr<Part>& _part = (*_chorale)->get_part( _partName );
+            if (!_part) {
+                std::cerr << "Part " << _partName << " not found for " << (*_chorale)->get_BWV() << std::endl;
+                continue;
+            }
+            _parts.push_back( std::move( _part ) );
+        }
+        _stats.add_chorale( _parts );
+
+        // release the xml as soon as the chorale has been counted
+        _chorale->reset();
+    }
+    return _stats;
+}
+
+/**
+ * Splits the items into one contiguous range per thread, counts each range as a separate task, and merges the
+ *  partial counts.
+ *
+ * @param items The items to count.
+ * @param pool The pool to run the tasks on.
+ * @param count The function counting a range of items.
+ * @return The merged counts.
+ */
+template <typename T, typename F>
+CorpusStats count_in_parallel( std::vector<T>& items, ThreadPool& pool, F count ) {
+    CorpusStats _stats;
+    for (CorpusStats& _partial : pool.map_ranges( items.size(), [&items, &count]( size_t first, size_t last ) {
+            return count( items.data() + first, items.data() + last );
+        } )) {
+        _stats.merge( std::move( _partial ) );
+    }
+    return _stats;
+}
+
+/**
+ * The main entry point of the application. This program computes statistics over a corpus, given either as
+ *  musicXml (a file, a url, or a list of them) or as the encodings written by inputXml or inputEncodings, and
+ *  writes them as JSON.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the statistics were written, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program computes statistics over a corpus of chorales", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The musicXml source or encodings file to process"};
+    Arguments::PartFlags _partFlags{_parser};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Output file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+    const std::string _source = args::get( _sourceParm );
+
+    // parts to encode from musicXml; the four standard voices if none are given
+    std::vector<std::string> _partsToParse = _partFlags.get_parts_to_parse();
+
+    // urls may be loaded on every thread, so libcurl is set up before the pool starts
+    Chorale::CurlGlobal _curl;
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    CorpusStats _stats;
+
+    if (EncodingReader::is_encodings_file( _source )) {
+        std::vector<ChoraleLines> _chorales;
+        if (!EncodingReader::read_chorale_lines( _source, _chorales )) {
+            return 1;
+        }
+        _stats = count_in_parallel( _chorales, _pool, count_encodings );
+    }
+    else {
+        // the chorales are built in order, so repeated BWVs get the same modifiers as in inputXml
+        std::vector<std::unique_ptr<Chorale>> _chorales;
+        if (Arguments::get_input_source_type( _source ) == Arguments::TXT) {
+            auto _sourceList = GzipStream::open_input( _source );
+            if (!*_sourceList) {
+                std::cerr << "Error opening xml source list file: " << _source << std::endl;
+                return 1;
+            }
+            for (std::string _xmlSource; std::getline( *_sourceList, _xmlSource ); ) {
+                if (!_xmlSource.empty() && _xmlSource.substr(0,2) != "//") {
+                    _chorales.push_back( std::make_unique<Chorale>( _xmlSource ) );
+                }
+            }
+            if (_sourceList->bad()) {
+                std::cerr << "Error reading xml source list file: " << _source << std::endl;
+                return 1;
+            }
+        }
+        else {
+            _chorales.push_back( std::make_unique<Chorale>( _source ) );
+        }
+
+        _stats = count_in_parallel( _chorales, _pool, [&_partsToParse]( auto first, auto last ) {
+            return count_xml( first, last, _partsToParse );
+        } );
+    }
+
+    // write the statistics
+    if (_outputFileParm) {
+        std::ofstream _outputFile{ args::get( _outputFileParm ) };
+        if (!_outputFile) {
+            std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+            return 1;
+        }
+        _stats.write_json( _outputFile );
+        std::cout << "Counted " << _stats.get_chorale_count()
+            << (_stats.get_chorale_count() == 1 ? " chorale" : " chorales") << std::endl;
+    }
+    else {
+        _stats.write_json( std::cout );
+    }
+    return 0;
+}
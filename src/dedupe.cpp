@@ -0,0 +1,153 @@
+#include "Dedupe.h"
+#include "GzipStream.h"
+#include "Part.h"
+#include "ThreadPool.h"
+
+#include <args.hxx>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Reads a file of encodings into memory and groups its lines into chorales by ID.
+ *
+ * @param source The path of the file of encodings.
+ * @param contents The string to hold the file; the lines point into it.
+ * @param chorales The vector to fill with the lines of each chorale.
+ * @param dedupe The deduplicator, to which each chorale is added.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool read_encodings( const std::string& source, std::string& contents,
+        std::vector<std::vector<std::string_view>>& chorales, Deduplicator& dedupe ) {
+    if (!GzipStream::read_file( source, contents )) {
+        return false;
+    }
+
+    std::string _currentId;
+    std::string_view _remaining{ contents };
+    while (!_remaining.empty()) {
+        size_t _eol = std::min( _remaining.find( '\n' ), _remaining.size() );
+        std::string_view _line = _remaining.substr( 0, _eol );
+        _remaining.remove_prefix( std::min( _eol + 1, _remaining.size() ) );
+
+        Part _header;
+        if (_line.empty() || !_header.parse_header( std::string{ _line } )) {
+            continue;
+        }
+
+        if (chorales.empty() || _header.get_id() != _currentId) {
+            _currentId = _header.get_id();
+            dedupe.add( _currentId );
+            chorales.emplace_back();
+        }
+        chorales.back().push_back( _line );
+    }
+    return true;
+}
+
+/**
+ * The main entry point of the application. This program finds duplicate and near-duplicate chorales in a file of
+ *  encodings and writes a manifest saying which to keep and which to drop.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the manifest was written, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program finds duplicate and near-duplicate chorales", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to process"};
+    args::ValueFlag<size_t> _ngramParm{_parser, "ngram", "Tokens per shingle (default: 4)", {'n', "ngram"}};
+    args::ValueFlag<size_t> _bandsParm{_parser, "bands", "LSH bands (default: 16)", {"bands"}};
+    args::ValueFlag<size_t> _rowsParm{_parser, "rows", "Signature rows per band (default: 4)", {"rows"}};
+    args::ValueFlag<double> _thresholdParm{_parser, "threshold",
+        "Minimum similarity of a near duplicate (default: 0.8)", {"threshold"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Manifest file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    Deduplicator::Options _options;
+    if (_ngramParm) {
+        _options.ngram = args::get( _ngramParm );
+    }
+    if (_bandsParm) {
+        _options.bands = args::get( _bandsParm );
+    }
+    if (_rowsParm) {
+        _options.rows = args::get( _rowsParm );
+    }
+    if (_thresholdParm) {
+        _options.threshold = args::get( _thresholdParm );
+    }
+    if (_options.ngram == 0 || _options.bands == 0 || _options.rows == 0) {
+        std::cerr << "ngram, bands and rows must be positive" << std::endl;
+        return 1;
+    }
+
+    // read the corpus
+    Deduplicator _dedupe{ _options };
+    std::string _contents;
+    std::vector<std::vector<std::string_view>> _chorales;
+    if (!read_encodings( args::get( _sourceParm ), _contents, _chorales, _dedupe )) {
+        return 1;
+    }
+
+    // fingerprint the chorales, one contiguous range per thread
+    {
+        ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+        _pool.map_ranges( _chorales.size(), [&_dedupe, &_chorales]( size_t first, size_t last ) {
+            for (size_t _k = first; _k < last; _k++) {
+                _dedupe.fingerprint( _k, _chorales[_k] );
+            }
+        } );
+    }
+
+    _dedupe.cluster();
+
+    // write the manifest
+    if (!_outputFileParm) {
+        _dedupe.write_manifest( std::cout );
+        return 0;
+    }
+
+    std::ofstream _outputFile{ args::get( _outputFileParm ) };
+    if (!_outputFile) {
+        std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+        return 1;
+    }
+    _dedupe.write_manifest( _outputFile );
+
+    // summarize
+    size_t _exact{0};
+    size_t _near{0};
+    for (size_t _k = 0; _k < _dedupe.size(); _k++) {
+        const auto& _decision = _dedupe.get_decision( _k );
+        if (!_decision.keep) {
+            (_decision.exact ? _exact : _near)++;
+        }
+    }
+    std::cout << "Kept " << _dedupe.size() - _exact - _near << " of " << _dedupe.size() << " chorales; dropped "
+        << _exact << " exact and " << _near << " near duplicates" << std::endl;
+    return 0;
+}
@@ -1,9 +1,18 @@
 #include "Arguments.h"
+#include "Bpe.h"
 #include "Chorale.h"
+#include "CorpusIndex.h"
+#include "EncodingReader.h"
+#include "GzipStream.h"
+#include "Harmony.h"
 #include "Part.h"
+#include "PartSnapshot.h"
+#include "PianoRoll.h"
+#include "TokenPositions.h"
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 /**
@@ -23,78 +32,171 @@ int main( int argc, char** argv )
     }
     PartPrintOptions _printOptions{ _args};
 
-    // open output file if we have one
-    std::ofstream _outputFile{};
+    // open output file if we have one (compressed if its name ends in .gz)
+    std::unique_ptr<std::ostream> _outputFile;
     if (_args.has_output_file()) {
-        _outputFile.open( _args.get_output_file(), std::ios::out );
-        if (!_outputFile) {
+        _outputFile = GzipStream::open_output( _args.get_output_file() );
+        if (!*_outputFile) {
             std::cerr << "Failed to open output file: " << _args.get_output_file() << std::endl;
             return 1;
         }
     }
 
-    // read part encodings
-    std::ifstream _partEncodings{_args.get_input_source()};
-    if (!_partEncodings) {
-        std::cerr << "Error opening input file: " << _args.get_input_source() << std::endl;
-        return 1;
+    // open index if requested
+    CorpusIndexWriter _index;
+    if (_args.writeIndex()) {
+        if (!_args.has_output_file() || GzipStream::is_compressed( _args.get_output_file() )) {
+            std::cerr << "An index can only be written alongside an uncompressed output file" << std::endl;
+            return 1;
+        }
+        if (!_index.open( CorpusIndexWriter::index_path( _args.get_output_file() ) )) {
+            return 1;
+        }
+    }
+
+    // open piano roll file if we have one
+    PianoRollWriter _pianoRollFile;
+    if (_args.has_piano_roll_file()) {
+        if (!_pianoRollFile.open( _args.get_piano_roll_file() )) {
+            return 1;
+        }
+    }
+
+    // open token positions file if we have one
+    TokenPositionsWriter _positionsFile;
+    if (_args.has_positions_file()) {
+        if (!_positionsFile.open( _args.get_positions_file() )) {
+            return 1;
+        }
+    }
+
+    // open chord symbol file if we have one (compressed if its name ends in .gz)
+    std::unique_ptr<std::ostream> _harmonyFile;
+    if (_args.has_harmony_file()) {
+        _harmonyFile = GzipStream::open_output( _args.get_harmony_file() );
+        if (!*_harmonyFile) {
+            std::cerr << "Failed to open chord symbol file: " << _args.get_harmony_file() << std::endl;
+            return 1;
+        }
+    }
+
+    // load the merges to apply to the tokens, if any
+    BpeMerges _merges;
+    if (_args.has_merges_file()) {
+        if (!_merges.load( _args.get_merges_file() )) {
+            return 1;
+        }
     }
 
-    bool _done = false;
-    std::string _line;
+    // read part encodings, or map the snapshot written by inputXml --snapshot
+    PartSnapshotReader _snapshot;
+    std::unique_ptr<std::istream> _partEncodings;
+    std::unique_ptr<EncodingReader> _reader;
+    if (PartSnapshot::is_snapshot( _args.get_input_source() )) {
+        if (!_snapshot.open( _args.get_input_source() )) {
+            return 1;
+        }
+    }
+    else {
+        _partEncodings = GzipStream::open_input( _args.get_input_source() );
+        if (!*_partEncodings) {
+            std::cerr << "Error opening input file: " << _args.get_input_source() << std::endl;
+            return 1;
+        }
+        _reader = std::make_unique<EncodingReader>( *_partEncodings );
+    }
+
+    // the grid to put each chorale on, if one was chosen
+    RhythmGrid _grid = _args.get_grid();
+
     std::vector<std::unique_ptr<Part>> _parts;
 
     unsigned int _successes{0};
     unsigned int _attempts{0};
-    while (!_done) {
-         _parts.clear();
-
-        for (size_t _i = 0; _i < 4; _i++) {
-            if (!std::getline(_partEncodings, _line)) {
-                // if we haven't started a new chorale, we're done
-                if ( _i == 0 ) {
-                    _done = true;
-                    break;
-                }
-                /// otherwise, we have a chorale with fewer than four voices
-                else {
-                    std::cerr << "Missing voices for chorale " << _parts.back()->get_id() << std::endl;
-                    break;
-                }
+    while (_reader ? _reader->read_chorale( _parts ) : _snapshot.read_chorale( _parts )) {
+        if (!_args.get_shard().owns( _parts.back()->get_id() )) {
+            continue;
+        }
+        _attempts++;
+
+        // rescale the parts onto the chosen grid, before anything is built from them
+        if (_args.has_grid()) {
+            std::vector<Part*> _gridParts;
+            for (const auto& _part : _parts) {
+                _gridParts.push_back( _part.get() );
             }
-            _parts.push_back( std::make_unique<Part>() );
+            if (!_grid.apply( _gridParts, _parts.back()->get_sub_beats() )) {
+                std::cerr << "Failed to process " << _parts.back()->get_id() << std::endl;
+                continue;
+            }
+        }
 
-            // build Part object from the input line
-            _parts.back()->parse_encoding( _line );
-        } 
+        // the piano roll is built from the individual parts, before they are combined
+        if (_pianoRollFile.is_open()) {
+            std::vector<const Part*> _rollParts;
+            for (const std::string& _partName : _args.get_parts_to_parse()) {
+                for (const auto& _part : _parts) {
+                    if (_part->get_part_name() == _partName) {
+                        _rollParts.push_back( _part.get() );
+                    }
+                }
+            }
+            PianoRoll _pianoRoll;
+            if (!_pianoRoll.build( _rollParts ) || !_pianoRollFile.add( _pianoRoll )) {
+                std::cerr << "Failed to build piano roll for " << _parts.back()->get_id() << std::endl;
+            }
+        }
 
-        if (!_done) {
-            _attempts++;
+        // create a Chorale object from the parts
+        Chorale _chorale{ "", _parts.back()->get_id()} ; 
+        _chorale.load_parts( _parts );  
 
-            // create a Chorale object from the parts
-            Chorale _chorale{ "", _parts.back()->get_id()} ; 
-            _chorale.load_parts( _parts );  
+        // combine the parts into chords
+        if (_chorale.combine_parts( _args.get_parts_to_parse(), _args.verbose() )) {
 
-            // combine the parts into chords
-            if (_chorale.combine_parts( _args.get_parts_to_parse(), _args.verbose() )) {
+            // label the combined chords, one line per chorale
+            if (_harmonyFile) {
+                if (auto& _part = _chorale.get_combined_part()) {
+                    *_harmonyFile << Harmony::to_string( *_part ) << '\n';
+                }
+            }
 
-                // print the combined part to the output file
-                if (_args.has_output_file()) {
-                    if (auto& _part = _chorale.get_combined_part()) {
-                        _outputFile << _part->to_string( _printOptions ) << std::endl;
+            // print the combined part to the output file
+            if (_args.has_output_file()) {
+                if (auto& _part = _chorale.get_combined_part()) {
+                    size_t _offset = _outputFile->tellp();
+                    std::string _line;
+                    if (_positionsFile.is_open()) {
+                        TokenPositions _positions;
+                        _line = _part->to_string( _printOptions, _positions );
+                        if (!_positionsFile.add( *_part, _positions )) {
+                            return 1;
+                        }
                     }
                     else {
-                        std::cerr << "Combined parts not found for " << _chorale.get_BWV() << std::endl;
-                        return 1;
+                        _line = _merges.apply( _part->to_string( _printOptions ) );
+                    }
+                    *_outputFile << _line << std::endl;
+                    if (_index.is_open()) {
+                        _index.add_entry( *_part, _offset, _line );
                     }
                 }
-
-                _successes++;
-            }
-            else {
-                std::cerr << "Failed to process " << _chorale.get_BWV() << std::endl;
+                else {
+                    std::cerr << "Combined parts not found for " << _chorale.get_BWV() << std::endl;
+                    return 1;
+                }
             }
+
+            _successes++;
         }
+        else {
+            std::cerr << "Failed to process " << _chorale.get_BWV() << std::endl;
+        }
+    }
+
+    if (_partEncodings && _partEncodings->bad()) {
+        std::cerr << "Error reading encodings file: " << _args.get_input_source() << std::endl;
+        return 1;
     }
 
     std::cout << "Successfully processed " << _successes  
@@ -103,8 +205,19 @@ int main( int argc, char** argv )
         std::cout << "Failed to process " << _attempts - _successes 
             << ((_attempts - _successes) == 1 ? " chorale" : " chorales") << std::endl;
     } 
+    _grid.write_report( std::cout );
 
-    _partEncodings.close();
-    _outputFile.close();
+    _reader.reset();
+    _partEncodings.reset();
+    _snapshot.close();
+    if (_outputFile && !GzipStream::close_output( *_outputFile, _args.get_output_file() )) {
+        return 1;
+    }
+    if (_harmonyFile && !GzipStream::close_output( *_harmonyFile, _args.get_harmony_file() )) {
+        return 1;
+    }
+    if (!_index.close() || !_pianoRollFile.close() || !_positionsFile.close()) {
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -1,9 +1,17 @@
 #include "Arguments.h"
+#include "Bpe.h"
 #include "Chorale.h"
+#include "CorpusIndex.h"
+#include "GzipStream.h"
 #include "Part.h"
+#include "PianoRoll.h"
+#include "PartSnapshot.h"
+#include "TokenPositions.h"
+#include "ThreadPool.h"
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
 
@@ -15,17 +23,21 @@
  * @return `true` if at least one XML source was read, `false` otherwise.
  */
 bool read_xml_source_list( const std::string& xmlSource, std::vector<std::string>& xmlSourceList ) {
-    std::ifstream _xmlSourceListFile{xmlSource};
-    if (!_xmlSourceListFile) {
+    auto _xmlSourceListFile = GzipStream::open_input( xmlSource );
+    if (!*_xmlSourceListFile) {
         std::cerr << "Error opening xml source list file: " << xmlSource << std::endl;
         return false;
     }
 
-    for (std::string _xmlSource; std::getline(_xmlSourceListFile, _xmlSource); ) {
+    for (std::string _xmlSource; std::getline(*_xmlSourceListFile, _xmlSource); ) {
         if (!_xmlSource.empty()) {
             xmlSourceList.push_back(_xmlSource);
         }
     }
+    if (_xmlSourceListFile->bad()) {
+        std::cerr << "Error reading xml source list file: " << xmlSource << std::endl;
+        return false;
+    }
     return xmlSourceList.size() > 0;
 }
 
@@ -55,18 +67,51 @@ std::vector<std::string> get_xml_sources( const Arguments& args ) {
     return _xmlSources;
 }
 
+/**
+ * Writes a part's tokens to a string, applying the merges, and appends the position of each token to the positions
+ *  file if it is open (merges are not allowed with it).
+ *
+ * @param part The part to write.
+ * @param printOptions The print options.
+ * @param merges The merges to apply to the tokens (none if empty).
+ * @param positionsFile The token positions writer to append to.
+ * @param line Set to the tokens.
+ * @return `true` if the tokens (and their positions) were written, `false` if the positions could not be.
+ */
+bool part_to_string( const Part& part, const PartPrintOptions& printOptions, const BpeMerges& merges,
+        TokenPositionsWriter& positionsFile, std::string& line ) {
+    if (!positionsFile.is_open()) {
+        line = merges.apply( part.to_string( printOptions ) );
+        return true;
+    }
+
+    TokenPositions _positions;
+    line = part.to_string( printOptions, _positions );
+    return positionsFile.add( part, _positions );
+}
+
 /**
  * Prints the specified parts of a Chorale to the console.
  *
  * @param args The command-line arguments containing the parts to be printed.
  * @param chorale The Chorale object containing the parts to be printed.
+ * @param merges The merges to apply to the tokens (none if empty).
+ * @param positionsFile The token positions writer to append to, if it is open.
  * @return `true` if the printing was successful, `false` otherwise.
  */
-bool print_to_console( const Arguments& args, Chorale& chorale ) {
+bool print_to_console( const Arguments& args, Chorale& chorale, const BpeMerges& merges,
+        TokenPositionsWriter& positionsFile ) {
+    PartPrintOptions _printOptions;
+    _printOptions.printIntervals = args.intervals();
+
     // process each requested part
     for (std::string _partName : args.get_parts_to_parse() ) {
         if (auto& _part = chorale.get_part( _partName )) {
-            std::cout << *_part << '\n';
+            std::string _line;
+            if (!part_to_string( *_part, _printOptions, merges, positionsFile, _line )) {
+                return false;
+            }
+            std::cout << _line << "\n\n";
         }
         else {
             std::cerr << "Part " << _partName << " not found for " << chorale.get_BWV() << std::endl;
@@ -88,13 +133,28 @@ bool print_to_console( const Arguments& args, Chorale& chorale ) {
  * @param args The command-line arguments containing the parts to be exported.
  * @param chorale The Chorale object containing the parts to be exported.
  * @param outputFile The output file stream to write the parts to.
+ * @param index The sidecar index to update, if it is open.
+ * @param merges The merges to apply to the tokens (none if empty).
+ * @param positionsFile The token positions writer to append to, if it is open.
  * @return `true` if the export was successful, `false` otherwise.
  */
-bool export_to_file( const Arguments& args, Chorale& chorale, std::ofstream& outputFile ) {
+bool export_to_file( const Arguments& args, Chorale& chorale, std::ostream& outputFile, CorpusIndexWriter& index,
+        const BpeMerges& merges, TokenPositionsWriter& positionsFile ) {
+    PartPrintOptions _printOptions;
+    _printOptions.printIntervals = args.intervals();
+
     // process each requested part
     for (std::string _partName : args.get_parts_to_parse() ) {
         if (auto& _part = chorale.get_part( _partName )) {
-            outputFile << *_part;
+            size_t _offset = outputFile.tellp();
+            std::string _line;
+            if (!part_to_string( *_part, _printOptions, merges, positionsFile, _line )) {
+                return false;
+            }
+            outputFile << _line << '\n';
+            if (index.is_open()) {
+                index.add_entry( *_part, _offset, _line );
+            }
         }
         else {
             std::cerr << "Part " << _partName << " not found for " << chorale.get_BWV() << std::endl;
@@ -105,6 +165,26 @@ bool export_to_file( const Arguments& args, Chorale& chorale, std::ofstream& out
     return true;
 }
 
+/**
+ * Appends the piano roll for the specified parts of a Chorale to the piano roll file.
+ *
+ * @param args The command-line arguments containing the parts to be exported.
+ * @param chorale The Chorale object containing the parts to be exported.
+ * @param pianoRollFile The piano roll writer to append to.
+ * @return `true` if the export was successful, `false` otherwise.
+ */
+bool export_piano_roll( const Arguments& args, Chorale& chorale, PianoRollWriter& pianoRollFile ) {
+    std::vector<const Part*> _parts;
+    for (std::string _partName : args.get_parts_to_parse() ) {
+        if (auto& _part = chorale.get_part( _partName )) {
+            _parts.push_back( _part.get() );
+        }
+    }
+
+    PianoRoll _pianoRoll;
+    return _pianoRoll.build( _parts ) && pianoRollFile.add( _pianoRoll );
+}
+
 /**
  * The main entry point of the application. This function processes command-line arguments, reads and encodes
  *  MusicXML files, and either prints the encoded parts to the console or exports them to a file.
@@ -120,16 +200,69 @@ int main( int argc, char** argv ) {
             return 1;
         }
 
-        // open output file if we have one
-        std::ofstream _outputFile{};
+        // open output file if we have one (compressed if its name ends in .gz)
+        std::unique_ptr<std::ostream> _outputFile;
         if (_args.has_output_file()) {
-            _outputFile.open( _args.get_output_file(), std::ios::out );
-            if (!_outputFile) {
+            _outputFile = GzipStream::open_output( _args.get_output_file() );
+            if (!*_outputFile) {
                 std::cerr << "Failed to open output file: " << _args.get_output_file() << std::endl;
                 return 1;
             }
         }
 
+        // open index if requested
+        CorpusIndexWriter _index;
+        if (_args.writeIndex()) {
+            if (!_args.has_output_file() || GzipStream::is_compressed( _args.get_output_file() )) {
+                std::cerr << "An index can only be written alongside an uncompressed output file" << std::endl;
+                return 1;
+            }
+            if (!_index.open( CorpusIndexWriter::index_path( _args.get_output_file() ) )) {
+                return 1;
+            }
+        }
+
+        // open piano roll file if we have one
+        PianoRollWriter _pianoRollFile;
+        if (_args.has_piano_roll_file()) {
+            if (!_pianoRollFile.open( _args.get_piano_roll_file() )) {
+                return 1;
+            }
+        }
+
+        // open token positions file if we have one
+        TokenPositionsWriter _positionsFile;
+        if (_args.has_positions_file()) {
+            if (!_positionsFile.open( _args.get_positions_file() )) {
+                return 1;
+            }
+        }
+
+        // open part snapshot file if we have one
+        PartSnapshotWriter _snapshotFile;
+        if (_args.has_snapshot_file()) {
+            if (!_snapshotFile.open( _args.get_snapshot_file() )) {
+                return 1;
+            }
+        }
+
+        // load the merges to apply to the tokens, if any
+        BpeMerges _merges;
+        if (_args.has_merges_file()) {
+            if (!_merges.load( _args.get_merges_file() )) {
+                return 1;
+            }
+        }
+
+        // start a pool shared by all chorales if the parts are to be encoded in parallel
+        std::unique_ptr<ThreadPool> _pool;
+        if (_args.parallelParts()) {
+            _pool = std::make_unique<ThreadPool>( _args.get_parts_to_parse().size() );
+        }
+
+        // the grid to put each chorale on, if one was chosen
+        RhythmGrid _grid = _args.get_grid();
+
         // build list of musicXml files to read
         std::vector<std::string> _xmlSources = get_xml_sources( _args );
         if (_xmlSources.empty()) {
@@ -145,8 +278,13 @@ int main( int argc, char** argv ) {
                 continue;
             }
             
-            _attempts++;
+            // the BWV is assigned for every source, so repeated BWVs get the same modifiers in every shard
             Chorale _chorale{ _xmlSource };
+            if (!_args.get_shard().owns( _chorale.get_BWV() )) {
+                continue;
+            }
+
+            _attempts++;
 
             // load xml for this chorale
             if (!_chorale.load_xml()) {
@@ -156,23 +294,40 @@ int main( int argc, char** argv ) {
 
             // extract the parts and encode them
             _chorale.load_parts( _args.get_parts_to_parse() );
-            if (!_chorale.encode_parts()) {
+            if (!_chorale.encode_parts( _pool.get(), _args.has_grid() ? &_grid : nullptr, _args.verbose() )) {
                 std::cerr << "Failed to encode parts for " << _chorale.get_BWV() << std::endl;
                 continue;
             }
 
             // print or save results
             if (_args.has_output_file()) {
-                if (!export_to_file( _args, _chorale, _outputFile )) {
+                if (!export_to_file( _args, _chorale, *_outputFile, _index, _merges, _positionsFile )) {
                     return 1;
                 }
             }
             else {
-                if (!print_to_console( _args, _chorale )) {
+                if (!print_to_console( _args, _chorale, _merges, _positionsFile )) {
                     return 1;
                 }
             }
 
+            // the snapshot holds the parts as encoded, whatever options they were printed with
+            if (_snapshotFile.is_open()) {
+                for (const std::string& _partName : _args.get_parts_to_parse()) {
+                    if (auto& _part = _chorale.get_part( _partName )) {
+                        if (!_snapshotFile.add( *_part )) {
+                            return 1;
+                        }
+                    }
+                }
+            }
+
+            if (_pianoRollFile.is_open()) {
+                if (!export_piano_roll( _args, _chorale, _pianoRollFile )) {
+                    std::cerr << "Failed to build piano roll for " << _chorale.get_BWV() << std::endl;
+                }
+            }
+
             _successes++;
             std::cout << "Encoded " << _chorale.get_BWV() << std::endl;
         }
@@ -183,7 +338,14 @@ int main( int argc, char** argv ) {
             std::cout << "Failed to encode " << _attempts - _successes 
                 << ((_attempts - _successes) == 1 ? " chorale" : " chorales") << std::endl;
         }
+        _grid.write_report( std::cout );
 
+        if (_outputFile && !GzipStream::close_output( *_outputFile, _args.get_output_file() )) {
+            return 1;
+        }
+        if (!_index.close() || !_pianoRollFile.close() || !_positionsFile.close() || !_snapshotFile.close()) {
+            return 1;
+        }
         return 0;
     }
     catch (const std::exception& e) {
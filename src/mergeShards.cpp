@@ -0,0 +1,229 @@
+#include "Chorale.h"
+#include "CorpusIndex.h"
+#include "GzipStream.h"
+#include "Part.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Splits a BWV identifier such as "BWV 18.5a" into its work number, its sub-group and its modifier, so that
+ *  identifiers can be compared numerically.
+ *
+ * @param bwv The BWV identifier.
+ * @return A tuple of work number, sub-group and modifier.
+ */
+std::tuple<unsigned int, unsigned int, std::string> split_BWV( const std::string& bwv ) {
+    unsigned int _work{0};
+    unsigned int _subGroup{0};
+    std::string _modifier;
+
+    auto _start = bwv.find_first_of( "0123456789" );
+    if (_start != std::string::npos) {
+        std::istringstream _is{ bwv.substr( _start ) };
+        char _period;
+        _is >> _work >> _period >> _subGroup;
+        std::getline( _is, _modifier );
+    }
+    return { _work, _subGroup, _modifier };
+}
+
+/**
+ * Reads a shard output and groups its lines into chorales by ID.
+ *
+ * @param shardFile The path of the shard output.
+ * @param chorales The map from ID to the chorale's lines, to which this shard's chorales are added.
+ * @return `true` if the shard was read, `false` if it could not be opened or repeats a chorale already read.
+ */
+bool read_shard( const std::string& shardFile, std::map<std::string, std::vector<std::string>>& chorales ) {
+    auto _shard = GzipStream::open_input( shardFile );
+    if (!*_shard) {
+        std::cerr << "Error opening shard: " << shardFile << std::endl;
+        return false;
+    }
+
+    std::string _currentId;
+    for (std::string _line; std::getline( *_shard, _line ); ) {
+        if (_line.empty()) {
+            continue;
+        }
+
+        Part _header;
+        if (!_header.parse_header( _line )) {
+            std::cerr << " in " << shardFile << std::endl;
+            return false;
+        }
+
+        // a new ID starts a new chorale, which must not have been seen in any shard
+        if (_header.get_id() != _currentId) {
+            _currentId = _header.get_id();
+            if (chorales.contains( _currentId )) {
+                std::cerr << _currentId << " appears more than once (in " << shardFile << ")" << std::endl;
+                return false;
+            }
+        }
+        chorales[_currentId].push_back( _line );
+    }
+    if (_shard->bad()) {
+        std::cerr << "Error reading shard: " << shardFile << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the canonical order of chorales from either a list of xml sources (as given to inputXml) or a file of
+ *  encodings (as given to inputEncodings).
+ *
+ * For a list of sources, the BWV of each source is built the same way inputXml builds it, so that repeated
+ *  BWVs get the same modifiers.
+ *
+ * @param orderFile The path of the source list or encodings file.
+ * @param order The vector to fill with IDs in canonical order.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool read_canonical_order( const std::string& orderFile, std::vector<std::string>& order ) {
+    auto _orderFile = GzipStream::open_input( orderFile );
+    if (!*_orderFile) {
+        std::cerr << "Error opening order file: " << orderFile << std::endl;
+        return false;
+    }
+
+    for (std::string _line; std::getline( *_orderFile, _line ); ) {
+        if (_line.empty() || _line.substr(0,2) == "//") {
+            continue;
+        }
+
+        // a line of encodings
+        if (_line.starts_with( Part::SOH + Part::ID )) {
+            Part _header;
+            if (_header.parse_header( _line ) && (order.empty() || order.back() != _header.get_id())) {
+                order.push_back( _header.get_id() );
+            }
+        }
+        // an xml source
+        else {
+            Chorale _chorale{ _line };
+            order.push_back( _chorale.get_BWV() );
+        }
+    }
+    if (_orderFile->bad()) {
+        std::cerr << "Error reading order file: " << orderFile << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The main entry point of the application. This program stitches the outputs of inputXml or inputEncodings runs
+ *  made with --shard back into a single output in canonical order, optionally rebuilding its index.
+ *
+ * Without --order, chorales are written in BWV order, which is the order of the source lists in data/.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the merge was successful, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program merges the outputs of sharded runs into canonical order", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::PositionalList<std::string> _shardFiles{_parser, "shards", "The shard outputs to merge"};
+    args::ValueFlag<std::string> _orderFile{_parser, "order",
+        "Source list or encodings file giving the canonical order", {'o', "order"}};
+    args::Flag _index{_parser, "Index", "Write a byte-offset index alongside the output file", {"index"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Output file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_outputFileParm.Matched() || args::get( _shardFiles ).empty()) {
+        std::cerr << "Shard outputs and an output file are required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    // gather the chorales from every shard
+    std::map<std::string, std::vector<std::string>> _chorales;
+    for (const std::string& _shardFile : args::get( _shardFiles )) {
+        if (!read_shard( _shardFile, _chorales )) {
+            return 1;
+        }
+    }
+
+    // put them in canonical order; anything not in the order file follows, in BWV order
+    std::vector<std::string> _order;
+    if (_orderFile.Matched() && !read_canonical_order( args::get( _orderFile ), _order )) {
+        return 1;
+    }
+    std::set<std::string> _ordered{ _order.begin(), _order.end() };
+    std::vector<std::string> _unordered;
+    for (const auto& _it : _chorales) {
+        if (!_ordered.contains( _it.first )) {
+            _unordered.push_back( _it.first );
+        }
+    }
+    if (_orderFile.Matched() && !_unordered.empty()) {
+        std::cerr << _unordered.size() << " chorales not found in " << args::get( _orderFile ) << std::endl;
+    }
+    std::sort( _unordered.begin(), _unordered.end(), []( const std::string& a, const std::string& b ) {
+        return split_BWV( a ) < split_BWV( b );
+    } );
+    _order.insert( _order.end(), _unordered.begin(), _unordered.end() );
+
+    // write the merged output and its index
+    std::ofstream _outputFile{ args::get( _outputFileParm ) };
+    if (!_outputFile) {
+        std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+        return 1;
+    }
+
+    CorpusIndexWriter _indexWriter;
+    if (_index && !_indexWriter.open( CorpusIndexWriter::index_path( args::get( _outputFileParm ) ) )) {
+        return 1;
+    }
+
+    unsigned int _merged{0};
+    for (const std::string& _id : _order) {
+        auto _it = _chorales.find( _id );
+        if (_it == _chorales.end()) {
+            continue;
+        }
+
+        for (const std::string& _line : _it->second) {
+            size_t _offset = _outputFile.tellp();
+            _outputFile << _line << '\n';
+            if (_indexWriter.is_open()) {
+                Part _header;
+                _header.parse_header( _line );
+                _indexWriter.add_entry( _header, _offset, _line );
+            }
+        }
+        _merged++;
+    }
+
+    if (!GzipStream::close_output( _outputFile, args::get( _outputFileParm ) ) || !_indexWriter.close()) {
+        return 1;
+    }
+
+    std::cout << "Merged " << _merged << (_merged == 1 ? " chorale" : " chorales")
+        << " from " << args::get( _shardFiles ).size() << " shards" << std::endl;
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "GzipStream.h"
+#include "MusicXmlRenderer.h"
+#include "Part.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// the lines of one chorale
+using ChoraleLines = std::vector<std::string>;
+
+/**
+ * Builds a header for a line written without one (e.g. a model sample), so that it can be parsed as a part.
+ *
+ * @param line The line of tokens.
+ * @param number The number of the line in the file (origin 1), used as the ID.
+ * @param beats The beats per measure to assume.
+ * @param subBeats The sub-beats per beat to assume.
+ * @return The line with a header in front of it.
+ */
+std::string add_header( const std::string& line, size_t number, size_t beats, size_t subBeats ) {
+    std::ostringstream _os;
+    _os << Part::SOH << Part::ID << "Sample " << number
+        << Part::DELIM << Part::PART << "Sample"
+        << Part::DELIM << Part::KEY << "C-" << Part::MAJOR_STR
+        << Part::DELIM << Part::BEATS << beats
+        << Part::DELIM << Part::SUB_BEATS << subBeats
+        << Part::EOH << ' ' << line;
+    return _os.str();
+}
+
+/**
+ * Reads a file of encodings and groups its lines into chorales by ID. Each line without a header is a chorale of
+ *  its own.
+ *
+ * @param source The path of the file of encodings.
+ * @param beats The beats per measure to assume for lines without a header.
+ * @param subBeats The sub-beats per beat to assume for lines without a header.
+ * @param chorales The vector to fill with the lines of each chorale.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool read_encodings( const std::string& source, size_t beats, size_t subBeats, std::vector<ChoraleLines>& chorales ) {
+    auto _file = GzipStream::open_input( source );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << source << std::endl;
+        return false;
+    }
+
+    std::string _currentId;
+    size_t _lineNumber{0};
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        _lineNumber++;
+        if (_line.empty()) {
+            continue;
+        }
+        if (!_line.starts_with( Part::SOH + Part::ID )) {
+            chorales.push_back( { add_header( _line, _lineNumber, beats, subBeats ) } );
+            _currentId.clear();
+            continue;
+        }
+
+        Part _header;
+        if (!_header.parse_header( _line )) {
+            std::cerr << "Skipping line " << _lineNumber << std::endl;
+            continue;
+        }
+        if (chorales.empty() || _header.get_id() != _currentId) {
+            _currentId = _header.get_id();
+            chorales.emplace_back();
+        }
+        chorales.back().push_back( std::move( _line ) );
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << source << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Builds the name of the MusicXML file for a chorale. A BWV such as "BWV 8.6" is written the way the files in data/
+ *  are named ("806.xml", or "1805a.xml" for "BWV 18.5a"), so that inputXml can read the files back in corpus order 
+ *  and assign the same BWVs; any other ID is used as it is, with spaces replaced.
+ *
+ * @param id The ID of the chorale.
+ * @return The file name.
+ */
+std::string file_name( const std::string& id ) {
+    unsigned int _work{0};
+    unsigned int _subGroup{0};
+    char _period{0};
+    std::string _modifier;
+    std::istringstream _is{ id };
+    std::string _prefix;
+    if (_is >> _prefix >> _work >> _period >> _subGroup && _prefix == "BWV" && _period == '.' && _subGroup < 100) {
+        _is >> _modifier;
+        if (std::all_of( _modifier.begin(), _modifier.end(), ::islower )) {
+            return std::to_string( _work * 100 + _subGroup ) + _modifier + ".xml";
+        }
+    }
+
+    std::string _name{ id };
+    std::replace( _name.begin(), _name.end(), ' ', '_' );
+    std::replace( _name.begin(), _name.end(), '/', '_' );
+    return _name + ".xml";
+}
+
+/**
+ * Renders a range of chorales, each to its own file in the output directory.
+ *
+ * @param first The first chorale of the range.
+ * @param last One past the last chorale of the range.
+ * @param outputDir The directory to write to.
+ * @return The number of chorales rendered.
+ */
+size_t render( const ChoraleLines* first, const ChoraleLines* last, const std::filesystem::path& outputDir ) {
+    size_t _rendered{0};
+    std::vector<std::unique_ptr<Part>> _parts;
+    MusicXmlRenderer _renderer;
+
+    for (const ChoraleLines* _chorale = first; _chorale != last; _chorale++) {
+        _parts.clear();
+        for (const std::string& _line : *_chorale) {
+            auto _part = std::make_unique<Part>();
+            if (_part->parse_encoding( _line )) {
+                _parts.push_back( std::move( _part ) );
+            }
+        }
+        if (_parts.empty() || !_renderer.load( _parts )) {
+            continue;
+        }
+
+        std::filesystem::path _path = outputDir / file_name( _parts[0]->get_id() );
+        std::ofstream _outputFile{ _path };
+        if (!_outputFile) {
+            std::cerr << "Failed to open output file: " << _path.string() << std::endl;
+            continue;
+        }
+        _renderer.write( _outputFile );
+        _rendered++;
+    }
+    return _rendered;
+}
+
+/**
+ * The main entry point of the application. This program turns lines of tokens, as written by inputXml or
+ *  inputEncodings or produced by a model, back into MusicXML files, one per chorale.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if every chorale was rendered, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program turns encodings back into MusicXML", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to process"};
+    args::ValueFlag<std::string> _outputDirParm{_parser, "directory",
+        "Directory for the MusicXML files (default: current directory)", {'o', "outputDir"}};
+    args::ValueFlag<size_t> _beatsParm{_parser, "beats",
+        "Beats per measure for lines without a header (default: 4)", {"beats"}};
+    args::ValueFlag<size_t> _subBeatsParm{_parser, "sub-beats",
+        "Sub-beats per beat for lines without a header (default: 8)", {"subBeats"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    std::filesystem::path _outputDir{ _outputDirParm ? args::get( _outputDirParm ) : "." };
+    std::error_code _error;
+    std::filesystem::create_directories( _outputDir, _error );
+    if (_error) {
+        std::cerr << "Failed to create output directory: " << _outputDir.string() << std::endl;
+        return 1;
+    }
+
+    std::vector<ChoraleLines> _chorales;
+    if (!read_encodings( args::get( _sourceParm ), _beatsParm ? args::get( _beatsParm ) : 4,
+            _subBeatsParm ? args::get( _subBeatsParm ) : 8, _chorales )) {
+        return 1;
+    }
+
+    // render the chorales, one contiguous range per thread
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    size_t _rendered{0};
+    for (size_t _result : _pool.map_ranges( _chorales.size(), [&_chorales, &_outputDir]( size_t first, size_t last ) {
+            return render( _chorales.data() + first, _chorales.data() + last, _outputDir );
+        } )) {
+        _rendered += _result;
+    }
+
+    std::cout << "Rendered " << _rendered << " of " << _chorales.size()
+        << (_chorales.size() == 1 ? " chorale" : " chorales") << " to " << _outputDir.string() << std::endl;
+    return (_rendered == _chorales.size()) ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+#include "GzipStream.h"
+#include "NGramModel.h"
+#include "Part.h"
+#include "Shard.h"
+#include "ThreadPool.h"
+
+#include <args.hxx>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// the result for one source
+struct Result {
+    size_t trainTokens{0};
+    size_t vocabulary{0};
+    NGramModel::Score heldOut;
+    size_t heldOutChorales{0};
+};
+
+/**
+ * Trains a model on one source and scores its held-out chorales. A chorale is held out if its BWV hashes to shard
+ *  0 of heldOut, so every variant of the corpus holds out the same chorales.
+ *
+ * @param source The path of the file of encodings.
+ * @param order The order of the model.
+ * @param heldOut One chorale in this many (on average) is held out.
+ * @param pool The pool to count and score on.
+ * @param result The result to fill.
+ * @return `true` if the source was read and the model trained, `false` otherwise.
+ */
+bool evaluate( const std::string& source, size_t order, size_t heldOut, ThreadPool& pool, Result& result ) {
+    auto _file = GzipStream::open_input( source );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << source << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> _trainLines;
+    std::vector<std::string> _testLines;
+    std::set<std::string> _testIds;
+    size_t _lineNumber{0};
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        _lineNumber++;
+        if (_line.empty()) {
+            continue;
+        }
+        // lines without a header are held out by line number
+        Part _header;
+        std::string _id = (_line.starts_with( Part::SOH + Part::ID ) && _header.parse_header( _line ))
+            ? _header.get_id() : std::to_string( _lineNumber );
+        if (Shard::shard_of( _id, heldOut ) == 0) {
+            _testIds.insert( _id );
+            _testLines.push_back( std::move( _line ) );
+        }
+        else {
+            _trainLines.push_back( std::move( _line ) );
+        }
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << source << std::endl;
+        return false;
+    }
+    if (_trainLines.empty() || _testLines.empty()) {
+        std::cerr << "Too few chorales in " << source << " to hold out one in " << heldOut << std::endl;
+        return false;
+    }
+
+    NGramModel _model{ order };
+    std::vector<NGramModel::Sequence> _train;
+    for (const std::string& _line : _trainLines) {
+        _train.push_back( _model.encode( _line, true ) );
+        result.trainTokens += _train.back().size() + 1;
+    }
+    std::vector<NGramModel::Sequence> _test;
+    for (const std::string& _line : _testLines) {
+        _test.push_back( _model.encode( _line, false ) );
+    }
+    if (!_model.train( _train, pool )) {
+        return false;
+    }
+
+    result.vocabulary = _model.vocabulary_size();
+    result.heldOut = _model.score( _test, pool );
+    result.heldOutChorales = _testIds.size();
+    return true;
+}
+
+/**
+ * The main entry point of the application. This program trains an n-gram model with Kneser-Ney smoothing on each
+ *  of a set of encodings files (e.g. the same corpus tokenized different ways) and reports the perplexity of
+ *  held-out chorales.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if every source was evaluated, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program reports the held-out perplexity of an n-gram model of encodings", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::PositionalList<std::string> _sourcesParm{_parser, "sources", "The encodings files to evaluate"};
+    args::ValueFlag<size_t> _orderParm{_parser, "order", "Order of the model (default: 4)", {'n', "order"}};
+    args::ValueFlag<size_t> _heldOutParm{_parser, "N", "Hold out one chorale in N (default: 10)", {"heldOut"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (args::get( _sourcesParm ).empty()) {
+        std::cerr << "At least one source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+    size_t _order = _orderParm ? args::get( _orderParm ) : 4;
+    size_t _heldOut = _heldOutParm ? args::get( _heldOutParm ) : 10;
+    if (_order == 0 || _heldOut < 2) {
+        std::cerr << "order must be positive and heldOut at least 2" << std::endl;
+        return 1;
+    }
+
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    std::cout << _order << "-gram model, holding out one chorale in " << _heldOut << std::endl;
+    std::cout << std::left << std::setw( 48 ) << "source" << std::right << std::setw( 10 ) << "train"
+        << std::setw( 10 ) << "held out" << std::setw( 8 ) << "vocab" << std::setw( 8 ) << "OOV %"
+        << std::setw( 12 ) << "perplexity" << std::setw( 14 ) << "bits/chorale" << std::endl;
+
+    bool _ok{true};
+    for (const std::string& _source : args::get( _sourcesParm )) {
+        Result _result;
+        if (!evaluate( _source, _order, _heldOut, _pool, _result )) {
+            _ok = false;
+            continue;
+        }
+        const NGramModel::Score& _score = _result.heldOut;
+        std::cout << std::left << std::setw( 48 ) << _source << std::right << std::setw( 10 ) << _result.trainTokens
+            << std::setw( 10 ) << _score.tokens << std::setw( 8 ) << _result.vocabulary << std::fixed
+            << std::setprecision( 2 ) << std::setw( 8 ) << 100.0 * _score.unknown / _score.tokens
+            << std::setw( 12 ) << std::exp2( _score.bits / _score.tokens )
+            << std::setprecision( 1 ) << std::setw( 14 ) << _score.bits / _result.heldOutChorales << std::endl;
+    }
+    return _ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "GzipStream.h"
+#include "MelodyIndex.h"
+#include "ThreadPool.h"
+
+#include <args.hxx>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Formats a location as "m. <measure>, b. <beat>[.<sub-beat>]", the way Part::location_to_string() does.
+ *
+ * @param location The location.
+ * @param subBeats The sub-beats per beat of the melody.
+ * @return The formatted location.
+ */
+std::string location_to_string( const MelodyIndex::Location& location, size_t subBeats ) {
+    std::ostringstream _os;
+    _os << "m. " << location.measure << ", b. " << (location.tick - 1) / subBeats + 1;
+    if ((location.tick - 1) % subBeats) {
+        _os << '.' << (location.tick - 1) % subBeats + 1;
+    }
+    return _os.str();
+}
+
+/**
+ * The main entry point of the application. This program looks up every melody of a file of encodings (e.g.
+ *  generated chorales) in an index built by buildMelodyIndex, and reports the longest span each shares with the
+ *  indexed corpus.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if every melody was looked up, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program finds the longest spans of melodies copied from an indexed corpus", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _indexParm{_parser, "index", "The melody index"};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to check"};
+    args::ValueFlag<size_t> _minParm{_parser, "notes", "Report only spans of at least this many notes (default: 0)",
+        {"min"}};
+    args::Flag _excludeSelfParm{_parser, "excludeSelf", "Ignore matches in chorales with the same ID",
+        {'x', "excludeSelf"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Output file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_indexParm.Matched() || !_sourceParm.Matched()) {
+        std::cerr << "An index and a source are required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    MelodyIndex _index;
+    if (!_index.open( args::get( _indexParm ) )) {
+        return 1;
+    }
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    std::vector<MelodyIndex::Melody> _melodies;
+    if (!MelodyIndex::read_melodies( args::get( _sourceParm ), _pool, _melodies )) {
+        return 1;
+    }
+
+    // look up contiguous ranges of melodies on the pool, and write the results in order
+    size_t _min = _minParm ? args::get( _minParm ) : 0;
+    bool _excludeSelf = args::get( _excludeSelfParm );
+    auto _partials = _pool.map_ranges( _melodies.size(),
+        [&_index, &_melodies, _min, _excludeSelf]( size_t first, size_t last ) {
+            std::ostringstream _os;
+            for (size_t _m = first; _m < last; _m++) {
+                const MelodyIndex::Melody& _melody = _melodies[_m];
+                MelodyIndex::Match _match = _index.longest_match( _melody, _excludeSelf );
+                if (_match.notes < _min) {
+                    continue;
+                }
+                _os << _melody.id << '\t' << _melody.partName << '\t' << _match.notes;
+                if (_match.notes) {
+                    const MelodyIndex::PartEntry& _entry = _index.get_part( _match.part );
+                    _os << '\t' << location_to_string( _melody.locations[_match.queryStart], _melody.subBeats )
+                        << '\t' << _entry.id << '\t' << _entry.part
+                        << '\t' << location_to_string( _index.get_location( _match.part, _match.start ),
+                            _entry.subBeats );
+                }
+                _os << '\n';
+            }
+            return _os.str();
+        } );
+
+    std::unique_ptr<std::ostream> _outputFile;
+    if (_outputFileParm) {
+        _outputFile = GzipStream::open_output( args::get( _outputFileParm ) );
+        if (!*_outputFile) {
+            std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& _os = _outputFile ? *_outputFile : std::cout;
+    _os << "# id\tpart\tnotes\tat\tmatch id\tmatch part\tmatch at\n";
+    for (const std::string& _partial : _partials) {
+        _os << _partial;
+    }
+    _os.flush();
+    if (_outputFile) {
+        return GzipStream::close_output( *_outputFile, args::get( _outputFileParm ) ) ? 0 : 1;
+    }
+    return _os ? 0 : 1;
+}
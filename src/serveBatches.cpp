@@ -0,0 +1,164 @@
+#include "BatchLoader.h"
+#include "BatchRing.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Builds every batch of every epoch into the ring, in order. Batches are built on the pool straight into their slots,
+ *  with up to one batch per slot (or per thread, if fewer) in flight, and published as soon as they and every batch
+ *  before them are built.
+ *
+ * @param loader The loader, with its samples and vocabulary.
+ * @param ring The ring to fill.
+ * @param epochs The number of epochs.
+ * @param pool The pool to build batches on.
+ * @return The number of batches published.
+ */
+uint64_t serve( const BatchLoader& loader, BatchRing& ring, uint64_t epochs, ThreadPool& pool ) {
+    size_t _window = std::max<size_t>( 1, std::min<size_t>( ring.get_header().slots, pool.size() ) );
+    std::deque<std::future<void>> _inFlight;
+    uint64_t _submitted{0};
+    uint64_t _published{0};
+    auto _publish_next = [&] {
+        _inFlight.front().get();
+        _inFlight.pop_front();
+        ring.publish( ++_published );
+    };
+
+    for (uint64_t _epoch = 0; _epoch < epochs; _epoch++) {
+        auto _order = std::make_shared<const std::vector<size_t>>( loader.epoch_order( _epoch ) );
+        for (size_t _batch = 0; _batch < loader.batches_per_epoch(); _batch++) {
+            if (_inFlight.size() == _window) {
+                _publish_next();
+            }
+            int32_t* _slot = ring.wait_for_slot( _submitted++ );
+            _inFlight.push_back( pool.submit( [&loader, _order, _epoch, _batch, _slot] {
+                loader.make_batch( *_order, _epoch, _batch, _slot );
+            } ) );
+        }
+    }
+    while (!_inFlight.empty()) {
+        _publish_next();
+    }
+    return _published;
+}
+
+/**
+ * The main entry point of the application. This program serves shuffled, padded batches of token IDs, built from a
+ *  file of encodings, to a trainer through a ring buffer in shared memory (see consumeBatches for a consumer).
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if every batch was served and consumed, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program serves batches of token IDs from a file of encodings over shared memory",
+        ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to serve"};
+    args::ValueFlag<std::string> _nameParm{_parser, "name",
+        "Name of the shared memory (default: /choraleGPT-batches)", {"name"}};
+    args::ValueFlag<size_t> _batchParm{_parser, "rows", "Rows per batch (default: 32)", {'b', "batch"}};
+    args::ValueFlag<size_t> _lengthParm{_parser, "tokens", "Token IDs per row (default: 512)", {'l', "length"}};
+    args::ValueFlag<uint32_t> _slotsParm{_parser, "slots", "Batches the ring holds (default: 8)", {"slots"}};
+    args::ValueFlag<uint64_t> _epochsParm{_parser, "epochs", "Number of epochs (default: 1)", {'e', "epochs"}};
+    args::ValueFlag<int> _transposeParm{_parser, "accidentals",
+        "Transpose each row by a random number of sharps or flats, up to this many (0-6, default: 0)",
+        {'t', "transpose"}};
+    args::Flag _cropParm{_parser, "crop", "Start each row at a random barline", {"crop"}};
+    args::ValueFlag<uint64_t> _seedParm{_parser, "seed", "Seed for shuffling and augmentation (default: 0)",
+        {"seed"}};
+    args::ValueFlag<std::string> _vocabParm{_parser, "vocabulary",
+        "Vocabulary file to use (default: build one from the source)", {'v', "vocab"}};
+    args::ValueFlag<std::string> _writeVocabParm{_parser, "vocabulary", "Vocabulary file to write",
+        {"writeVocab"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    BatchLoader::Options _options;
+    if (_batchParm) {
+        _options.batchSize = std::max<size_t>( args::get( _batchParm ), 1 );
+    }
+    if (_lengthParm) {
+        _options.sequenceLength = std::max<size_t>( args::get( _lengthParm ), 1 );
+    }
+    if (_transposeParm) {
+        _options.transpose = std::clamp( args::get( _transposeParm ), 0, 6 );
+    }
+    _options.crop = args::get( _cropParm );
+    if (_seedParm) {
+        _options.seed = args::get( _seedParm );
+    }
+
+    BatchLoader _loader{ _options };
+    if (!_loader.load( args::get( _sourceParm ) )) {
+        return 1;
+    }
+    if (_loader.sample_count() == 0) {
+        std::cerr << "No encodings in " << args::get( _sourceParm ) << std::endl;
+        return 1;
+    }
+
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    if (_vocabParm) {
+        if (!_loader.load_vocabulary( args::get( _vocabParm ) )) {
+            return 1;
+        }
+    }
+    else {
+        _loader.build_vocabulary( _pool );
+    }
+    if (_writeVocabParm && !_loader.get_vocabulary().write( args::get( _writeVocabParm ) )) {
+        return 1;
+    }
+
+    std::string _name = _nameParm ? args::get( _nameParm ) : "/choraleGPT-batches";
+    BatchRing _ring;
+    if (!_ring.create( _name, _slotsParm ? args::get( _slotsParm ) : 8, _options.batchSize, _options.sequenceLength,
+            _loader.get_vocabulary().size() )) {
+        return 1;
+    }
+
+    uint64_t _epochs = _epochsParm ? args::get( _epochsParm ) : 1;
+    std::cout << "Serving " << _epochs * _loader.batches_per_epoch() << " batches of " << _options.batchSize << " x "
+        << _options.sequenceLength << " token IDs from " << _loader.sample_count() << " samples ("
+        << _loader.get_vocabulary().size() << " token vocabulary) as " << _name << std::endl;
+
+    auto _start = std::chrono::steady_clock::now();
+    uint64_t _batches = serve( _loader, _ring, _epochs, _pool );
+    _ring.finish();
+    double _seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - _start ).count();
+
+    std::cout << "Served " << _batches << (_batches == 1 ? " batch" : " batches") << " in " << std::fixed
+        << std::setprecision( 2 ) << _seconds << " seconds" << std::endl;
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "Bpe.h"
+#include "GzipStream.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Reads the lines of a file of encodings.
+ *
+ * @param source The path of the file.
+ * @param lines The vector to fill with the non-empty lines.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+bool read_lines( const std::string& source, std::vector<std::string>& lines ) {
+    auto _file = GzipStream::open_input( source );
+    if (!*_file) {
+        std::cerr << "Error opening encodings file: " << source << std::endl;
+        return false;
+    }
+    for (std::string _line; std::getline( *_file, _line ); ) {
+        if (!_line.empty()) {
+            lines.push_back( std::move( _line ) );
+        }
+    }
+    if (_file->bad()) {
+        std::cerr << "Error reading encodings file: " << source << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Counts the words of all lines, one contiguous range of lines per thread, and merges the partial counts.
+ *
+ * @param lines The lines of tokens.
+ * @param pool The pool to count on.
+ * @return The count of every word.
+ */
+BpeTrainer::WordCounts count_words( const std::vector<std::string>& lines, ThreadPool& pool ) {
+    auto _partials = pool.map_ranges( lines.size(), [&lines]( size_t first, size_t last ) {
+        BpeTrainer::WordCounts _counts;
+        for (size_t _l = first; _l < last; _l++) {
+            BpeTrainer::count_words( lines[_l], _counts );
+        }
+        return _counts;
+    } );
+
+    BpeTrainer::WordCounts _counts;
+    for (const auto& _partial : _partials) {
+        for (const auto& [_word, _count] : _partial) {
+            _counts[_word] += _count;
+        }
+    }
+    return _counts;
+}
+
+/**
+ * The main entry point of the application. This program learns byte-pair-encoding style merges of the note and
+ *  chord tokens in a file of encodings, to be applied by inputXml and inputEncodings with --merges.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if the merges were written, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program learns merges of the tokens in a file of encodings", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The encodings file to train on"};
+    args::ValueFlag<size_t> _mergesParm{_parser, "merges", "Maximum number of merges to learn (default: 1000)",
+        {'n', "merges"}};
+    args::ValueFlag<size_t> _minCountParm{_parser, "count",
+        "Stop when the most frequent pair occurs fewer times than this (default: 2)", {"minCount"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+    args::ValueFlag<std::string> _outputFileParm{_parser, "output", "Merges file path", {'f', "file"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    BpeTrainer::Options _options;
+    if (_mergesParm) {
+        _options.merges = args::get( _mergesParm );
+    }
+    if (_minCountParm) {
+        _options.minCount = std::max<size_t>( args::get( _minCountParm ), 1 );
+    }
+
+    std::vector<std::string> _lines;
+    if (!read_lines( args::get( _sourceParm ), _lines )) {
+        return 1;
+    }
+
+    ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+    BpeTrainer _trainer{ _options };
+    _trainer.add_words( count_words( _lines, _pool ) );
+    _lines.clear();
+    BpeMerges _merges = _trainer.train( _pool );
+
+    // write the merges
+    if (_outputFileParm) {
+        std::ofstream _outputFile{ args::get( _outputFileParm ) };
+        if (!_outputFile) {
+            std::cerr << "Failed to open output file: " << args::get( _outputFileParm ) << std::endl;
+            return 1;
+        }
+        _merges.write( _outputFile );
+
+        double _before = static_cast<double>( _trainer.get_tokens_before() );
+        std::cout << "Learned " << _merges.size() << (_merges.size() == 1 ? " merge" : " merges")
+            << " from " << _trainer.get_word_count() << " distinct words: "
+            << _trainer.get_tokens_before() << " tokens become " << _trainer.get_tokens_after() << " ("
+            << std::fixed << std::setprecision( 1 )
+            << (_before ? 100.0 * (_before - _trainer.get_tokens_after()) / _before : 0.0) << "% fewer)" << std::endl;
+    }
+    else {
+        _merges.write( std::cout );
+    }
+    return 0;
+}
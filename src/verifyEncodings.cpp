@@ -0,0 +1,331 @@
+#include "Arguments.h"
+#include "Chorale.h"
+#include "EncodingReader.h"
+#include "EncodingVerifier.h"
+#include "GzipStream.h"
+#include "Part.h"
+#include "ThreadPool.h"
+#include "TokenGrammar.h"
+#include "Vocabulary.h"
+
+#include <algorithm>
+#include <args.hxx>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using ChoraleLines = EncodingReader::ChoraleLines;
+// the token grammar of each meter in a corpus, by beats per measure and sub-beats per beat
+using Grammars = std::map<std::pair<int, int>, TokenGrammar>;
+
+/**
+ * Splits the tokens of a line of encodings, after its header.
+ *
+ * @param line The line.
+ * @return The tokens.
+ */
+std::vector<std::string> line_tokens( const std::string& line ) {
+    std::istringstream _is{ line.substr( line.find( Part::EOH ) + 1 ) };
+    std::vector<std::string> _tokens;
+    for (std::string _token; _is >> _token; ) {
+        _tokens.push_back( std::move( _token ) );
+    }
+    return _tokens;
+}
+
+/**
+ * Builds a vocabulary of every token in a file of encodings, in corpus order, and compiles the token grammar over it
+ *  for each meter the file uses.
+ *
+ * @param chorales The lines of each chorale.
+ * @param tiesKeepPitch If true, the grammars require a tied voice to repeat the pitch it is tied from.
+ * @param vocabulary The vocabulary to fill.
+ * @param grammars The grammars to fill.
+ * @return `true` if every grammar was compiled, `false` otherwise.
+ */
+bool build_grammars( const std::vector<ChoraleLines>& chorales, bool tiesKeepPitch, Vocabulary& vocabulary,
+        Grammars& grammars ) {
+    vocabulary.clear();
+    for (const ChoraleLines& _chorale : chorales) {
+        for (const std::string& _line : _chorale) {
+            Part _header;
+            if (_header.parse_header( _line )) {
+                grammars.try_emplace( { _header.get_beats_per_measure(), _header.get_sub_beats() } );
+            }
+            for (const std::string& _token : line_tokens( _line )) {
+                vocabulary.add( _token );
+            }
+        }
+    }
+
+    for (auto& [_meter, _grammar] : grammars) {
+        if (!_grammar.build( vocabulary, _meter.first, _meter.second, tiesKeepPitch )) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Runs the tokens of each line of a chorale through the token grammar of its meter, as a sampler masking its logits
+ *  with the grammar would: every token must be allowed where it occurs, and the line must end after [EOC].
+ *
+ * @param chorale The lines of the chorale.
+ * @param vocabulary The vocabulary the grammars were compiled over.
+ * @param grammars The grammar of each meter.
+ * @param errors The stream to describe problems on.
+ * @return `true` if the grammar accepts every line, `false` otherwise.
+ */
+bool check_grammar( const ChoraleLines& chorale, const Vocabulary& vocabulary, const Grammars& grammars,
+        std::ostream& errors ) {
+    bool _accepted{true};
+    for (const std::string& _line : chorale) {
+        Part _header;
+        _header.parse_header( _line );
+        auto _grammar = grammars.find( { _header.get_beats_per_measure(), _header.get_sub_beats() } );
+        if (_grammar == grammars.end()) {
+            continue;
+        }
+
+        std::vector<std::string> _tokens = line_tokens( _line );
+        std::vector<int32_t> _ids;
+        for (const std::string& _token : _tokens) {
+            _ids.push_back( vocabulary.get_id( _token ) );
+        }
+        TokenGrammar::State _state = _grammar->second.start();
+        size_t _count = _grammar->second.accept( _ids, _state );
+        if (_count < _ids.size()) {
+            errors << "[" << _header.get_id() << "] " << _header.get_part_name() << ": the grammar rejects token "
+                << _count + 1 << ", " << _tokens[_count] << '\n';
+            _accepted = false;
+        }
+        else if (!_grammar->second.is_accepting( _state )) {
+            errors << "[" << _header.get_id() << "] " << _header.get_part_name() << ": the grammar does not accept "
+                << "the line as a complete chorale" << '\n';
+            _accepted = false;
+        }
+    }
+    return _accepted;
+}
+
+/**
+ * Verifies one chorale read from a file of encodings: each line is parsed, and the part is then printed and
+ *  parsed again.
+ *
+ * @param chorale The lines of the chorale.
+ * @param errors The stream to describe problems on.
+ * @return `true` if every part was verified, `false` otherwise.
+ */
+bool verify_encodings( const ChoraleLines& chorale, std::ostream& errors ) {
+    bool _verified{true};
+    for (const std::string& _line : chorale) {
+        Part _part;
+        if (!_part.parse_encoding( _line )) {
+            errors << "Failed to parse " << _line.substr( 0, _line.find( Part::EOH ) + 1 ) << '\n';
+            _verified = false;
+        }
+        else if (!EncodingVerifier::verify( _part, errors )) {
+            _verified = false;
+        }
+    }
+    return _verified;
+}
+
+/**
+ * Verifies one chorale read from musicXml: the requested parts are encoded the way inputXml does it and, if asked,
+ *  combined the way inputEncodings does it, and each resulting part is printed and parsed back.
+ *
+ * @param chorale The chorale, with its BWV already assigned.
+ * @param partsToParse The names of the parts to encode.
+ * @param combined `true` to verify the combined part as well.
+ * @param errors The stream to describe problems on.
+ * @return `true` if every part was verified, `false` otherwise.
+ */
+bool verify_xml( Chorale& chorale, const std::vector<std::string>& partsToParse, bool combined,
+        std::ostream& errors ) {
+    if (!chorale.load_xml()) {
+        errors << "Failed to load xml source for " << chorale.get_BWV() << '\n';
+        return false;
+    }
+    chorale.load_parts( partsToParse );
+    if (!chorale.encode_parts()) {
+        errors << "Failed to encode parts for " << chorale.get_BWV() << '\n';
+        return false;
+    }
+
+    bool _verified{true};
+    for (const std::string& _partName : partsToParse) {
+        if (auto& _part = chorale.get_part( _partName )) {
+            _verified = EncodingVerifier::verify( *_part, errors ) && _verified;
+        }
+    }
+
+    if (combined) {
+        if (!chorale.combine_parts( partsToParse )) {
+            errors << "Failed to combine parts for " << chorale.get_BWV() << '\n';
+            return false;
+        }
+        _verified = EncodingVerifier::verify( *chorale.get_combined_part(), errors ) && _verified;
+    }
+    return _verified;
+}
+
+/**
+ * Splits the items into one contiguous range per thread and verifies each range as a separate task. The problems
+ *  found for each item are kept in the item's own report, so they can be printed in corpus order.
+ *
+ * @param items The items to verify.
+ * @param reports The reports, one per item; filled by the tasks.
+ * @param pool The pool to run the tasks on.
+ * @param verify The function verifying one item.
+ * @return The number of items verified.
+ */
+template <typename T, typename F>
+size_t verify_in_parallel( std::vector<T>& items, std::vector<std::string>& reports, ThreadPool& pool, F verify ) {
+    reports.assign( items.size(), "" );
+    size_t _verified{0};
+    for (size_t _result : pool.map_ranges( items.size(), [&items, &reports, &verify]( size_t first, size_t last ) {
+            size_t _verified{0};
+            for (size_t _i = first; _i < last; _i++) {
+                std::ostringstream _errors;
+                if (verify( items[_i], _errors )) {
+                    _verified++;
+                }
+                reports[_i] = _errors.str();
+            }
+            return _verified;
+        } )) {
+        _verified += _result;
+    }
+    return _verified;
+}
+
+/**
+ * The main entry point of the application. This program checks that encodings survive a round trip through their
+ *  text form: each part is encoded (from musicXml, or parsed from a file of encodings), printed, parsed back with
+ *  Part::parse_encoding() and compared with the original, and the measures of both are checked for consistency.
+ *  The first difference in each part is reported with its location. With --grammar, each line of a file of
+ *  encodings is also run through the token grammar a sampler masks its logits with.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return 0 if every chorale was verified, 1 otherwise.
+ */
+int main( int argc, char** argv ) {
+    args::ArgumentParser _parser{"This program verifies that encodings survive a round trip through their text form", ""};
+    args::HelpFlag _help{_parser, "help", "Display this help menu", {'h', "help"}};
+    args::Positional<std::string> _sourceParm{_parser, "source", "The musicXml source or encodings file to verify"};
+    Arguments::PartFlags _partFlags{_parser};
+    args::Flag _combined{_parser, "Combined", "Also verify the parts combined into chords", {"combined"}};
+    args::Flag _grammarParm{_parser, "grammar",
+        "Also check each line of a file of encodings against the token grammar", {"grammar"}};
+    args::Flag _grammarTiesParm{_parser, "grammarTies",
+        "With --grammar, also require each tied voice to repeat the pitch it is tied from", {"grammarTies"}};
+    args::ValueFlag<unsigned int> _threadsParm{_parser, "threads",
+        "Number of threads (default: one per hardware thread)", {'j', "threads"}};
+
+    try {
+        _parser.ParseCLI( argc, argv );
+    }
+    catch (args::Help&) {
+        std::cout << _parser;
+        return 0;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+
+    if (!_sourceParm.Matched()) {
+        std::cerr << "A source is required" << std::endl;
+        std::cerr << _parser;
+        return 1;
+    }
+    const std::string _source = args::get( _sourceParm );
+
+    // parts to encode from musicXml; the four standard voices if none are given
+    std::vector<std::string> _partsToParse = _partFlags.get_parts_to_parse();
+
+    try {
+        // urls may be loaded on every thread, so libcurl is set up before the pool starts
+        Chorale::CurlGlobal _curl;
+        ThreadPool _pool{ _threadsParm ? args::get( _threadsParm ) : 0 };
+        std::vector<std::string> _reports;
+        size_t _verified{0};
+        size_t _count{0};
+
+        if (EncodingReader::is_encodings_file( _source )) {
+            std::vector<ChoraleLines> _chorales;
+            if (!EncodingReader::read_chorale_lines( _source, _chorales )) {
+                return 1;
+            }
+            // the grammars are compiled over the tokens of the whole file, before any chorale is checked
+            Vocabulary _vocabulary;
+            Grammars _grammars;
+            bool _checkGrammar = _grammarParm.Get();
+            if (_checkGrammar && !build_grammars( _chorales, _grammarTiesParm.Get(), _vocabulary, _grammars )) {
+                return 1;
+            }
+
+            _count = _chorales.size();
+            _verified = verify_in_parallel( _chorales, _reports, _pool,
+                [&_vocabulary, &_grammars, _checkGrammar]( const ChoraleLines& chorale, std::ostream& errors ) {
+                    bool _result = verify_encodings( chorale, errors );
+                    return (!_checkGrammar || check_grammar( chorale, _vocabulary, _grammars, errors )) && _result;
+                } );
+        }
+        else if (_grammarParm) {
+            std::cerr << "--grammar checks a file of encodings, not musicXml" << std::endl;
+            return 1;
+        }
+        else {
+            // the chorales are built in order, so repeated BWVs get the same modifiers as in inputXml
+            std::vector<std::unique_ptr<Chorale>> _chorales;
+            if (Arguments::get_input_source_type( _source ) == Arguments::TXT) {
+                auto _sourceList = GzipStream::open_input( _source );
+                if (!*_sourceList) {
+                    std::cerr << "Error opening xml source list file: " << _source << std::endl;
+                    return 1;
+                }
+                for (std::string _xmlSource; std::getline( *_sourceList, _xmlSource ); ) {
+                    if (!_xmlSource.empty() && _xmlSource.substr(0,2) != "//") {
+                        _chorales.push_back( std::make_unique<Chorale>( _xmlSource ) );
+                    }
+                }
+                if (_sourceList->bad()) {
+                    std::cerr << "Error reading xml source list file: " << _source << std::endl;
+                    return 1;
+                }
+            }
+            else {
+                _chorales.push_back( std::make_unique<Chorale>( _source ) );
+            }
+
+            _count = _chorales.size();
+            bool _verifyCombined = _combined.Get();
+            _verified = verify_in_parallel( _chorales, _reports, _pool,
+                [&_partsToParse, _verifyCombined]( std::unique_ptr<Chorale>& chorale, std::ostream& errors ) {
+                    bool _result = verify_xml( *chorale, _partsToParse, _verifyCombined, errors );
+                    // release the xml as soon as the chorale has been verified
+                    chorale.reset();
+                    return _result;
+                } );
+        }
+
+        for (const std::string& _report : _reports) {
+            std::cerr << _report;
+        }
+        std::cout << "Verified " << _verified << " of " << _count
+            << (_count == 1 ? " chorale" : " chorales") << std::endl;
+        return (_verified == _count) ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}